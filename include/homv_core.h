@@ -2,6 +2,8 @@
 #define HOMV_CORE_H
 
 #include <homv_matrix.h>
+#include <stdbool.h>
+#include <sys/types.h>
 
 // clang-format off
 extern double matrix_sharpen_values[];
@@ -26,6 +28,126 @@ extern homv_matrix homv_matrices[HOMV_MATRIX_MAX];
 extern char *filenames[FILE_NAMES_MAX_COUNT];
 extern size_t filenames_count;
 
+// Sum of convolution is accumulated and stored once, rounded to nearest and saturated.
+// Truncating would make results depend on order of summation, which differs between 1D passes and direct path
+static inline uint8_t homv_pixel_from_double(double value) {
+  if (value <= 0) {
+    return 0;
+  }
+  if (value >= 255) {
+    return 255;
+  }
+  return (uint8_t)(value + 0.5);
+}
+
+// Index of pixel that is mirrored to index, which is outside of 0..size-1 by less than size.
+// Edge pixel is not repeated: -1 -> 1, size -> size - 2 (see homv_reflect_image)
+static inline ssize_t homv_reflect_index(ssize_t index, ssize_t size) {
+  if (index < 0) {
+    return -index;
+  }
+  if (index >= size) {
+    return 2 * size - index - 2;
+  }
+  return index;
+}
+
+// How output is split between threads
+typedef enum {
+  HOMV_STRATEGY_SEQ = 0,
+  HOMV_STRATEGY_ROWS,
+  HOMV_STRATEGY_COLS,
+  HOMV_STRATEGY_PIXELS,
+  HOMV_STRATEGY_AREA, // blocks of area_width x area_height
+  HOMV_STRATEGY_FFT,  // FFT convolution by tiles with overlap-save, falls back to rows for small kernels
+  HOMV_STRATEGY_MAX
+} homv_strategy;
+
+extern ssize_t area_width;
+extern ssize_t area_height;
+
+// Type of image values. 16-bit values are 0..65535 or -32768..32767 in native byte order, float values are not
+// clamped
+typedef enum {
+  HOMV_TYPE_U8 = 0,
+  HOMV_TYPE_U16,
+  HOMV_TYPE_I16,
+  HOMV_TYPE_F32,
+  HOMV_TYPE_MAX
+} homv_type;
+
+// Bytes of one value of type
+static inline size_t homv_type_size(homv_type type) {
+  static const size_t sizes[HOMV_TYPE_MAX] = {
+      [HOMV_TYPE_U8] = 1, [HOMV_TYPE_U16] = 2, [HOMV_TYPE_I16] = 2, [HOMV_TYPE_F32] = 4};
+  return sizes[type];
+}
+
+// Parse name of value type: u8, u16, i16, f32. Returns HOMV_TYPE_MAX for unknown name
+homv_type homv_type_parse(const char *name);
+
+// Borders are reflected once (see homv_reflect_index), so radius of kernel must be smaller than width and height
+// of image. Entry points below reject larger kernels: they print error and return NULL or false
+static inline bool homv_kernel_fits(size_t size, int width, int height) {
+  return (ssize_t)(size / 2) < width && (ssize_t)(size / 2) < height;
+}
+
+// Convolve original (not padded) image, borders are reflected on the fly like homv_reflect_image does
+uint8_t *homv_apply(homv_strategy strategy, const uint8_t *image_input, int width, int height, int channels,
+                    homv_matrix matrix_input);
+// Same as homv_apply, but output is written to caller's buffer with rows output_stride bytes apart.
+// Plan of kernel and scratch buffers are kept per thread, so repeated calls with the same kernel and
+// image size do not allocate
+bool homv_apply_into(homv_strategy strategy, const uint8_t *image_input, int width, int height, int channels,
+                     homv_matrix matrix_input, uint8_t *output, size_t output_stride);
+
+// How alpha channel, the last of 2 or 4 channels, is filtered by all entry points
+typedef enum {
+  HOMV_ALPHA_CONVOLVE = 0,  // like color channels
+  HOMV_ALPHA_COPY,          // alpha of input is copied, only color channels are convolved
+  HOMV_ALPHA_PREMULTIPLIED, // colors are multiplied by alpha before convolution and divided by convolved alpha after
+  HOMV_ALPHA_MAX
+} homv_alpha;
+
+extern homv_alpha homv_alpha_mode;
+// Parse name of alpha mode: convolve, copy, premultiplied. Returns HOMV_ALPHA_MAX for unknown name
+homv_alpha homv_alpha_parse(const char *name);
+
+// Chain of count kernels in one streaming pass: result is the same as homv_apply of every kernel to output of
+// previous one, but rows pass between kernels through small ring buffers and intermediate images are never stored.
+// HOMV_STRATEGY_SEQ runs in one thread, other strategies split output to strips of rows, and every strip
+// recomputes rows of earlier kernels that later kernels read above it. Chain of one kernel is homv_apply_into.
+// Kernels are planned by homv_plan_chain_create, so blurs may be composed with next kernel, and then the result
+// differs by rounding of intermediate pixels
+bool homv_apply_chain_into(homv_strategy strategy, const uint8_t *image_input, int width, int height, int channels,
+                           const homv_matrix *matrices, size_t count, uint8_t *output, size_t output_stride);
+uint8_t *homv_apply_chain(homv_strategy strategy, const uint8_t *image_input, int width, int height, int channels,
+                          const homv_matrix *matrices, size_t count);
+
+// Fan-out of count kernels: outputs[i] equals homv_apply_into with matrices[i] and strategy other than
+// HOMV_STRATEGY_FFT, but all kernels are applied in one sweep over blocks of input rows, so every input row is loaded
+// to cache once. Borders are reflected on the fly, image is not padded. HOMV_STRATEGY_SEQ runs in one thread,
+// other strategies split image to strips of rows
+bool homv_apply_fanout_into(homv_strategy strategy, const uint8_t *image_input, int width, int height, int channels,
+                            const homv_matrix *matrices, size_t count, uint8_t *const *outputs, size_t output_stride);
+
+// Chain of count kernels from image of input_type values to output of output_type values, rows output_stride bytes
+// apart. 8-bit input and output go through homv_apply_chain_into. Other types are convolved in floats with the same
+// plans and strategies: sums are stored to float output as they are, or rounded and saturated to range of integer
+// output type. Kernels are applied one by one through float intermediate images, so only the last kernel rounds.
+// Float gradient direction is in radians, signed 16-bit direction maps -pi..pi to -32768..32767.
+// Alpha is convolved like colors.
+// With homv_normalize set, 8-bit output is stretched to 0..255: the last kernel writes floats and tracks their
+// min and max while it stores them, then one pass maps min..max to 0..255. Earlier kernels of 8-bit input run as
+// 8-bit chain of homv_apply_chain_into, with intermediate pixels rounded. Other output types are rejected then.
+// Returns false for rejected kernels or output type
+bool homv_apply_typed_into(homv_strategy strategy, homv_type input_type, const void *image_input, int width,
+                           int height, int channels, const homv_matrix *matrices, size_t count, homv_type output_type,
+                           void *output, size_t output_stride);
+// If true, output of homv_apply_typed_into must be 8-bit and it is normalized to 0..255, also for 8-bit input
+extern bool homv_normalize;
+
+// Same strategies for image padded by homv_reflect_image
 typedef uint8_t *(homv_apply_type)(const uint8_t *image_input, int width, int height, int channels,
                                    homv_matrix matrix_input);
 
@@ -33,11 +155,15 @@ homv_apply_type homv_apply_seq;
 homv_apply_type homv_apply_parallel_rows;
 homv_apply_type homv_apply_parallel_cols;
 homv_apply_type homv_apply_parallel_pixels;
-extern ssize_t area_width;
-extern ssize_t area_height;
 homv_apply_type homv_apply_parallel_area;
-void queue_exec(char *filenames[FILE_NAMES_MAX_COUNT], size_t filenames_count, homv_apply_type method_input,
-                homv_matrix matrix_input);
+homv_apply_type homv_apply_fft;
+// If true, queue_exec decodes images to one luminance channel: color JPEGs skip chroma entirely
+// and all kernels run on a third of values of RGB image
+extern bool homv_gray;
+// Every image goes through chain of matrices_count kernels like homv_apply_chain_into. Images are decoded to and
+// saved with 8 bits per channel, callers reject wider images
+void queue_exec(char *filenames[FILE_NAMES_MAX_COUNT], size_t filenames_count, homv_strategy strategy_input,
+                const homv_matrix *matrices_input, size_t matrices_count_input);
 
 // Resize image by reflecting edges of images
 // If we have image
@@ -51,7 +177,7 @@ void queue_exec(char *filenames[FILE_NAMES_MAX_COUNT], size_t filenames_count, h
 // [5 4 5 6 5]
 // [8 7 8 9 8]
 // [5 4 5 6 5]
-// After that we can process image without checking borders
+// After that we can process image without checking borders. Returns NULL if kernel does not fit image
 uint8_t *homv_reflect_image(uint8_t *old_image, int width, int height, int channels, size_t kernel_size);
 
 #endif
@@ -0,0 +1,21 @@
+#ifndef HOMV_FFT_H
+#define HOMV_FFT_H
+
+#include <homv_matrix.h>
+#include <stdbool.h>
+
+// Estimated cost of FFT convolution per output pixel, in multiply-adds like homv_plan_cost
+double homv_fft_cost(size_t kernel_size, size_t tile_size);
+
+// Cheapest FFT tile size (power of two) for kernel and image, 0 if kernel does not fit any tile
+size_t homv_fft_best_tile(size_t kernel_size, int width, int height);
+
+// Overlap-save FFT convolution. Image is padded by homv_reflect_image if padded is true,
+// otherwise borders are reflected while tiles are filled.
+// Padded image is cut to tile_size x tile_size tiles overlapping by kernel size - 1,
+// every tile is convolved in frequency domain and gives tile_size - kernel size + 1 square of output.
+// Output rows are output_stride bytes apart
+void homv_fft_convolve(const uint8_t *image_input, uint8_t *output, size_t output_stride, int width, int height,
+                       int channels, homv_matrix matrix_input, size_t tile_size, bool padded);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef HOMV_IIR_H
+#define HOMV_IIR_H
+
+#include <homv_core.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Recursive filter is used for sigma from 0.5, smaller Gaussians are convolved directly
+#define HOMV_IIR_MIN_SIGMA 0.5
+
+// Gaussian blur by Deriche 4th order recursive filter: sums of causal and anticausal passes along rows,
+// then along columns, so cost per pixel does not depend on sigma. Results are within a level of 8-bit
+// convolution with sampled kernel.
+// Pixels of image are read inside padding pixels wide frame (0 for original image), borders are reflected
+// like homv_reflect_image. Every pass filters many rows or columns at once: rows are transposed to lanes
+// of one vector. With parallel set, threads take strips of rows and then strips of columns.
+// Values of input and output are of their types, output rows are output_stride bytes apart.
+// If range is not NULL, min and max of float output are merged to range[0] and range[1]
+void homv_iir_gauss(const uint8_t *image_input, homv_type input_type, size_t padding, uint8_t *output,
+                    homv_type output_type, size_t output_stride, float *range, int width, int height, int channels,
+                    double sigma, bool parallel);
+
+#endif
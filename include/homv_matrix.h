@@ -4,15 +4,34 @@
 #include <inttypes.h>
 #include <stdlib.h>
 
+// Sobel gradient computed instead of convolution by matrix
+typedef enum {
+  HOMV_MX_GRADIENT_NONE = 0,  // matrix is convolved with image
+  HOMV_MX_GRADIENT_MAGNITUDE, // sqrt(gx^2 + gy^2) of horizontal and vertical Sobel derivatives
+  HOMV_MX_GRADIENT_DIRECTION, // atan2(gy, gx) as 256 steps of full turn, 0 is direction of x axis
+} homv_mx_gradient;
+
 // Kernel for image processing.
 // Matrix must be is square.
 typedef struct {
   size_t size;
   double *values; // size x size array of values of matrix
+  double sigma;   // > 0 if values are sampled Gaussian of this sigma, which planner may filter recursively
+  homv_mx_gradient gradient; // if not HOMV_MX_GRADIENT_NONE, values are vertical Sobel kernel of 3 x 3 gradient
 } homv_matrix;
 
 homv_matrix *homv_mx_init(size_t size, double **input);
 void homv_mx_free(homv_matrix *mx);
 homv_matrix *homv_mx_get_random_matrix(size_t size);
+// Box blur: size x size matrix of 1 / size^2
+homv_matrix *homv_mx_get_box_matrix(size_t size);
+// Gaussian blur: normalized samples of Gaussian within 3 sigma, size 2 * ceil(3 * sigma) + 1
+homv_matrix *homv_mx_get_gauss_matrix(double sigma);
+// Sobel gradient magnitude or direction, size 3
+homv_matrix *homv_mx_get_sobel_matrix(homv_mx_gradient gradient);
+// Kernel of convolution with a followed by convolution with b: full 2D convolution of both, size
+// a->size + b->size - 1. Kernels of even size are centered after their middle, so if both are even the result
+// gets one more zero row and column at the end to stay centered the same way
+homv_matrix *homv_mx_convolve(const homv_matrix *a, const homv_matrix *b);
 
 #endif
@@ -0,0 +1,14 @@
+#ifndef HOMV_NPY_H
+#define HOMV_NPY_H
+
+#include <homv_core.h>
+#include <stdbool.h>
+
+// Write image of values of type to NumPy .npy file (format version 1.0): array of height x width x channels
+// values, or height x width for one channel, in native byte order. Rows are width * channels values.
+// Returns false if file can not be written
+bool homv_npy_write(const char *filename, int width, int height, int channels, homv_type type, const void *image);
+// Write values of image as they are in memory, without header
+bool homv_raw_write(const char *filename, int width, int height, int channels, homv_type type, const void *image);
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef HOMV_PLAN_H
+#define HOMV_PLAN_H
+
+#include <homv_matrix.h>
+#include <homv_simd.h>
+#include <stdbool.h>
+
+// Cost of passing intermediate image between two kernels of chain: pixels are stored to row buffer, read back
+// and their borders are reflected
+#define HOMV_PLAN_STAGE_COST 2
+
+// How convolution with a kernel is executed
+typedef enum {
+  HOMV_PLAN_AUTO = 0,  // let planner choose the cheapest kind
+  HOMV_PLAN_DIRECT,    // size x size multiply-adds per pixel
+  HOMV_PLAN_SEPARABLE, // kernel is col * row: horizontal and vertical 1D passes, 2 * size per pixel
+  HOMV_PLAN_LOW_RANK,  // kernel is approximated by SVD as sum of terms separable kernels, 2 * size * terms per pixel
+  HOMV_PLAN_INTEGER,   // kernel is integers / divisor: exact int16 sums, twice more SIMD lanes than floats
+  HOMV_PLAN_SPARSE,    // integer kernel with zero taps skipped and 1, -1 taps added without multiply
+  HOMV_PLAN_SYMMETRIC, // kernel mirrored about axis or center: mirrored pixels are added before multiply
+  HOMV_PLAN_BOX,       // all coefficients are equal: sliding sums of rows and columns, cost does not depend on size
+  HOMV_PLAN_RECURSIVE, // sampled Gaussian (matrix.sigma > 0) approximated by recursive filter, cost does not depend
+                       // on sigma
+  HOMV_PLAN_WINOGRAD,  // 3x3 kernel by Winograd F(2x2, 3x3): 16 multiplies per 2x2 output tile instead of 36
+  HOMV_PLAN_GRADIENT,  // Sobel gradient (matrix.gradient): both derivatives from one load of every input value
+  HOMV_PLAN_MAX
+} homv_plan_kind;
+
+// How HOMV_PLAN_SYMMETRIC adds mirrored taps before they are multiplied
+typedef enum {
+  HOMV_FOLD_NONE = 0,
+  HOMV_FOLD_X,       // about vertical axis inside blocks of rows like direct path, half of multiplies
+  HOMV_FOLD_Y,       // mirrored rows are added once for all taps of their kernel rows, half of multiplies
+  HOMV_FOLD_POINT,   // pixels mirrored about center are paired in every output row, half of multiplies
+  HOMV_FOLD_QUARTER, // mirrored rows are added, then mirrored values of folded row, quarter of multiplies
+  HOMV_FOLD_MAX
+} homv_plan_fold;
+
+// Execution plan of kernel. Built once per homv_matrix before convolution
+typedef struct {
+  homv_plan_kind kind;
+  homv_matrix matrix;
+  size_t terms; // count of separable terms col * row (HOMV_PLAN_SEPARABLE and HOMV_PLAN_LOW_RANK only)
+  double *rows; // terms x size horizontal 1D kernels
+  double *cols; // terms x size vertical 1D kernels
+  int16_t *weights;   // size x size integer coefficients (HOMV_PLAN_INTEGER only)
+  homv_tap *sparse;   // non-zero integer coefficients in row-major order (HOMV_PLAN_SPARSE only)
+  size_t sparse_count;
+  int32_t divisor;    // kernel is weights / divisor
+  int16_t multiplier; // division by divisor is (sum * multiplier + 2^14) >> 15, 0 if divisor is 1
+  float *taps;        // float rows of taps: size x size kernel (HOMV_PLAN_DIRECT, HOMV_PLAN_SYMMETRIC), rows
+                      // (separable kinds) or 4 x 4 transformed kernel G * M * G^T (HOMV_PLAN_WINOGRAD)
+  // 1 if kernel is symmetric, -1 if antisymmetric, 0 otherwise about vertical axis: M[y][x] = M[y][size - 1 - x],
+  // horizontal axis: M[y][x] = M[size - 1 - y][x] and center: M[y][x] = M[size - 1 - y][size - 1 - x]
+  int symmetry_x;
+  int symmetry_y;
+  int symmetry_point;
+  homv_plan_fold fold; // cheapest fold these symmetries allow (HOMV_PLAN_SYMMETRIC only)
+  double box_scale; // common coefficient of all taps (HOMV_PLAN_BOX only)
+} homv_plan;
+
+// Plans of kernel chain applied one after another. Neighbouring kernels may be composed to one larger kernel
+// when its plan is cheaper than plans of both. Chain owns its kernels, plans point to their values
+typedef struct {
+  size_t count;
+  homv_matrix **matrices;
+  homv_plan **plans;
+} homv_plan_chain;
+
+// If not HOMV_PLAN_AUTO, planner uses this kind whenever kernel allows it
+extern homv_plan_kind homv_plan_force;
+// Allowed relative (Frobenius norm) error of HOMV_PLAN_LOW_RANK approximation.
+// Terms with smallest singular values are dropped while error stays below it
+extern double homv_svd_tolerance;
+// If false, kernels of chain are always applied one by one
+extern bool homv_plan_compose;
+
+homv_plan *homv_plan_create(homv_matrix matrix);
+void homv_plan_free(homv_plan *plan);
+// Multiply-adds per output pixel and channel
+double homv_plan_cost(const homv_plan *plan);
+
+// Chain of count kernels. Kernel is composed with the next one only if it keeps its output in 0..255 range and
+// commutes with reflection of image borders (it is odd, symmetric about both axes, non-negative and its sum is at
+// most 1), so composed kernel gives the same image up to rounding of intermediate pixels
+homv_plan_chain *homv_plan_chain_create(const homv_matrix *matrices, size_t count);
+void homv_plan_chain_free(homv_plan_chain *chain);
+// Sum of plan costs and HOMV_PLAN_STAGE_COST for every intermediate image
+double homv_plan_chain_cost(const homv_plan_chain *chain);
+// Cost of count kernels applied one by one, every kernel planned as a stage of chain without composition
+double homv_plan_chain_separate_cost(const homv_matrix *matrices, size_t count);
+
+#endif
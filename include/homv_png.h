@@ -0,0 +1,13 @@
+#ifndef HOMV_PNG_H
+#define HOMV_PNG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Write image of 16-bit values to PNG file: 1 to 4 channels are gray, gray and alpha, RGB and RGBA.
+// Rows are width * channels values in native byte order. stb_image_write writes only 8-bit PNG,
+// so rows are filtered and chunks are written here, and only deflate is done by stb_image_write.
+// Returns false if file can not be written
+bool homv_png_write_u16(const char *filename, int width, int height, int channels, const uint16_t *image);
+
+#endif
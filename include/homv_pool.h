@@ -0,0 +1,27 @@
+#ifndef HOMV_POOL_H
+#define HOMV_POOL_H
+
+#include <stddef.h>
+
+// Thread-safe pool of image buffers. Sizes are rounded up to size classes (four per power of two),
+// freed buffers are kept in list of their class and given again to next request of the class
+typedef struct {
+  size_t hits;           // requests served by retained buffer
+  size_t misses;         // requests that called malloc
+  size_t retained_bytes; // bytes of free buffers kept by pool
+  size_t peak_bytes;     // maximum of bytes in use and retained
+} homv_pool_stats;
+
+// Upper bound on retained bytes, buffers that do not fit are freed at once
+extern size_t homv_pool_limit;
+
+void *homv_pool_alloc(size_t size);
+// Resize buffer like realloc, buffer stays in place while size fits its class
+void *homv_pool_realloc(void *buffer, size_t size);
+// Return buffer to pool, NULL is ignored
+void homv_pool_free(void *buffer);
+// Free all retained buffers
+void homv_pool_clear(void);
+homv_pool_stats homv_pool_get_stats(void);
+
+#endif
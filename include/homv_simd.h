@@ -0,0 +1,116 @@
+#ifndef HOMV_SIMD_H
+#define HOMV_SIMD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Instruction sets of convolution hot loops
+typedef enum {
+  HOMV_ISA_AUTO = 0, // best supported by CPU
+  HOMV_ISA_SCALAR,
+  HOMV_ISA_SSE41,
+  HOMV_ISA_AVX2,
+  HOMV_ISA_AVX512,
+  HOMV_ISA_MAX
+} homv_isa;
+
+// Non-zero tap of sparse kernel: weight of input pixel (dx, dy) of kernel window
+typedef struct {
+  uint16_t dx;
+  uint16_t dy;
+  int16_t weight;
+} homv_tap;
+
+// Output rows convolved at once by convolve_u8 and convolve_i16
+#define HOMV_SIMD_BLOCK_ROWS 4
+
+// Row operations the convolution engine is built from. Rows are arrays of interleaved channels,
+// so every operation works on count independent values
+typedef struct {
+  homv_isa isa;
+  const char *name;
+  // acc[i] += weight * src[i]
+  void (*madd_u8)(float *acc, const uint8_t *src, float weight, size_t count);
+  // acc[i] += weight * src[i]
+  void (*madd_f32)(float *acc, const float *src, float weight, size_t count);
+  // dst[i] = acc[i] rounded to nearest and saturated to 0..255
+  void (*store_u8)(uint8_t *dst, const float *acc, size_t count);
+  // acc[i] += weight * src[i], sums must fit int16
+  void (*madd_i16)(int16_t *acc, const uint8_t *src, int16_t weight, size_t count);
+  // dst[i] = (acc[i] * multiplier + 2^14) >> 15 saturated to 0..255, or just saturated acc[i] if multiplier is 0
+  void (*store_i16)(uint8_t *dst, const int16_t *acc, int16_t multiplier, size_t count);
+  // acc[i] += weights[tap] * src[i + tap * stride] for every tap < taps: one kernel row of interleaved channels
+  void (*madd_row_u8)(float *acc, const uint8_t *src, const float *weights, size_t taps, size_t stride,
+                      size_t count);
+  // acc[i] += weights[tap] * src[i + tap * stride] for every tap < taps, sums must fit int16
+  void (*madd_row_i16)(int16_t *acc, const uint8_t *src, const int16_t *weights, size_t taps, size_t stride,
+                       size_t count);
+  // Direct convolution of rows <= HOMV_SIMD_BLOCK_ROWS output rows with taps x taps kernel:
+  // dst[row][i] = sum of weights[ky * taps + tap] * src[row + ky][i + tap * stride] stored like store_u8.
+  // Sums of all rows are kept in registers and written once
+  void (*convolve_u8)(uint8_t *const *dst, const uint8_t *const *src, const float *weights, size_t taps, size_t stride,
+                      size_t rows, size_t count);
+  // Same with exact int16 sums stored like store_i16
+  void (*convolve_i16)(uint8_t *const *dst, const uint8_t *const *src, const int16_t *weights, size_t taps,
+                       size_t stride, int16_t multiplier, size_t rows, size_t count);
+  // One output row of sparse integer kernel: dst[i] = sum of taps[t].weight * src[taps[t].dy][i + taps[t].dx * stride]
+  // stored like store_i16. Weights 1 and -1 are added and subtracted without multiply
+  void (*convolve_sparse_i16)(uint8_t *dst, const uint8_t *const *src, const homv_tap *taps, size_t taps_count,
+                              size_t stride, int16_t multiplier, size_t count);
+  // dst[i] = a[i] + sign * b[i], or a[i] if b is NULL. Sign is 1 or -1: mirrored rows of symmetric kernel are folded
+  void (*fold_u8)(float *dst, const uint8_t *a, const uint8_t *b, float sign, size_t count);
+  // acc[i] += weights[tap] * (a[i + tap * stride] + sign * b[i - tap * stride]) for every tap < taps:
+  // b points to last tap of mirrored kernel row, so a and b walk towards each other
+  void (*madd_pair_u8)(float *acc, const uint8_t *a, const uint8_t *b, const float *weights, size_t taps,
+                       size_t stride, float sign, size_t count);
+  // madd_pair_u8 of float rows: rows of kernel symmetric about both axes are folded by fold_u8 first
+  void (*madd_pair_f32)(float *acc, const float *a, const float *b, const float *weights, size_t taps,
+                        size_t stride, float sign, size_t count);
+  // convolve_u8 with kernel symmetric (sign 1) or antisymmetric (sign -1) about vertical axis:
+  // taps (tap, ky) and (taps - 1 - tap, ky) are applied as one tap to sum or difference of their input values.
+  // Only weights[ky * taps + tap] with tap <= taps / 2 are read
+  void (*convolve_fold_u8)(uint8_t *const *dst, const uint8_t *const *src, const float *weights, size_t taps,
+                           size_t stride, float sign, size_t rows, size_t count);
+  // sums[i] += add[i] - sub[i], or add[i] if sub is NULL: column sums of box window move one row down
+  void (*slide_u8)(int32_t *sums, const uint8_t *add, const uint8_t *sub, size_t count);
+  // dst[i] = sums[i] * scale rounded and saturated like store_u8
+  void (*store_i32)(uint8_t *dst, const int32_t *sums, float scale, size_t count);
+  // One step of 4th order recursive filter in every lane, as two 2nd order sections k: rows[k][i] =
+  // coefs[4k] * x0[i] + coefs[4k + 1] * x1[i] + coefs[4k + 2] * prev[2k][i] + coefs[4k + 3] * prev[2k + 1][i]
+  // and dst[i] = base[i] + rows[0][i] + rows[1][i]. base may be NULL for zeros, dst may be base
+  void (*iir_f32)(float *dst, const float *base, float *const *rows, const float *x0, const float *x1,
+                  const float *const *prev, const float *coefs, size_t count);
+  // Winograd F(2x2, 3x3) input transform along a row. even and odd are deinterleaved pixels of input row:
+  // tile i reads d0 = even[i], d1 = odd[i], d2 = even[i + stride], d3 = odd[i + stride] and writes
+  // h[0][i] = d0 - d2, h[1][i] = d1 + d2, h[2][i] = d2 - d1, h[3][i] = d1 - d3
+  void (*winograd_row_f32)(float *const *h, const float *even, const float *odd, size_t stride, size_t count);
+  // Rest of Winograd F(2x2, 3x3) for tiles i < count: h[4 * row + k] are row transforms of 4 input rows,
+  // u is 4 x 4 transformed kernel. out[2 * row + col][i] is output of tile i in column col and row row of tile
+  void (*winograd_tile_f32)(float *const *out, const float *const *h, const float *u, size_t count);
+  // Sobel derivatives of 3 input rows for every value i: gx[i] = right minus left column with weights 1 2 1,
+  // gy[i] = bottom minus top row with weights 1 2 1. Columns are stride apart
+  void (*sobel_i16)(int16_t *gx, int16_t *gy, const uint8_t *const *src, size_t stride, size_t count);
+  // dst[i] = sqrt(gx[i]^2 + gy[i]^2) rounded and saturated like store_u8
+  void (*magnitude_u8)(uint8_t *dst, const int16_t *gx, const int16_t *gy, size_t count);
+  // dst[i] = src[i]: rows of 16-bit images are widened once and convolved by float operations
+  void (*widen_u16)(float *dst, const uint16_t *src, size_t count);
+  // dst[i] = src[i] of signed 16-bit values
+  void (*widen_i16)(float *dst, const int16_t *src, size_t count);
+  // dst[i] = acc[i] rounded to nearest and saturated to 0..65535
+  void (*store_u16)(uint16_t *dst, const float *acc, size_t count);
+  // dst[i] = acc[i] rounded to nearest even and saturated to -32768..32767
+  void (*narrow_i16)(int16_t *dst, const float *acc, size_t count);
+  // bounds[0] = min(bounds[0], src[i]) and bounds[1] = max(bounds[1], src[i]) over all i
+  void (*range_f32)(float *bounds, const float *src, size_t count);
+} homv_simd_ops;
+
+// Operations for the best instruction set of CPU are chosen at startup
+extern const homv_simd_ops *homv_simd;
+
+// Use instruction set isa, returns false if CPU does not support it
+bool homv_simd_select(homv_isa isa);
+// Parse name of instruction set: auto, scalar, sse4.1, avx2, avx512. Returns HOMV_ISA_MAX for unknown name
+homv_isa homv_simd_parse(const char *name);
+
+#endif
@@ -8,11 +8,16 @@
 #include <string.h>
 
 #include "homv_core.h"
+#include "homv_fft.h"
 #include "homv_matrix.h"
+#include "homv_plan.h"
 #include "stb_image.h"
 #include "stb_image_write.h"
 
 #define NUM_RUNS 40
+// Direct convolution with big kernels is slow, so crossover of direct and FFT paths is measured with less runs
+#define CROSSOVER_RUNS 3
+#define CROSSOVER_MAX_KERNEL 31
 
 typedef struct {
   double times[NUM_RUNS];
@@ -26,20 +31,104 @@ double average(bench_results *res) {
   return sum / res->count;
 }
 
-void run_benchmark(uint8_t *img, int width, int height, int channels, homv_matrix matrix, homv_apply_type method,
+void run_benchmark_runs(uint8_t *img, int width, int height, int channels, homv_matrix matrix,
+                        homv_strategy strategy, bench_results *res, size_t runs) {
+  // Output buffer, plan and scratch buffers are reused between runs, so only convolution is measured
+  uint8_t *output = malloc((size_t)width * height * channels);
+  for (size_t i = 0; i < runs; i++) {
+    double start = omp_get_wtime();
+    homv_apply_into(strategy, img, width, height, channels, matrix, output, (size_t)width * channels);
+    double end = omp_get_wtime();
+    res->times[i] = end - start;
+  }
+  free(output);
+  res->count = runs;
+}
+
+void run_benchmark(uint8_t *img, int width, int height, int channels, homv_matrix matrix, homv_strategy strategy,
                    bench_results *res) {
+  run_benchmark_runs(img, width, height, channels, matrix, strategy, res, NUM_RUNS);
+}
+
+// Padding for padded homv_apply_* entry points, it is not part of homv_apply runs
+void run_reflect(uint8_t *img, int width, int height, int channels, size_t kernel_size, bench_results *res) {
   for (size_t i = 0; i < NUM_RUNS; i++) {
     double start = omp_get_wtime();
-    uint8_t *reflected_image = homv_reflect_image(img, width, height, channels, matrix.size);
-    uint8_t *output = method(reflected_image, width, height, channels, matrix);
+    uint8_t *reflected_image = homv_reflect_image(img, width, height, channels, kernel_size);
     double end = omp_get_wtime();
     res->times[i] = end - start;
     free(reflected_image);
-    free(output);
   }
   res->count = NUM_RUNS;
 }
 
+// Kernel through direct and symmetric (folded) plans, shows what folding of mirrored taps gives for this kernel
+void run_symmetry(uint8_t *img, int width, int height, int channels, homv_matrix matrix) {
+  homv_plan_force = HOMV_PLAN_SYMMETRIC;
+  homv_plan *plan = homv_plan_create(matrix);
+  homv_plan_force = HOMV_PLAN_AUTO;
+  if (plan->kind != HOMV_PLAN_SYMMETRIC) {
+    printf("Symmetry: none\n");
+    homv_plan_free(plan);
+    return;
+  }
+
+  bench_results direct, folded;
+  homv_plan_force = HOMV_PLAN_DIRECT;
+  run_benchmark(img, width, height, channels, matrix, HOMV_STRATEGY_ROWS, &direct);
+  homv_plan_force = HOMV_PLAN_SYMMETRIC;
+  run_benchmark(img, width, height, channels, matrix, HOMV_STRATEGY_ROWS, &folded);
+  homv_plan_force = HOMV_PLAN_AUTO;
+
+  printf("Symmetry(x %d, y %d, point %d, fold %d): direct %.4f, folded %.4f\n", plan->symmetry_x, plan->symmetry_y,
+         plan->symmetry_point, plan->fold, average(&direct), average(&folded));
+  homv_plan_free(plan);
+}
+
+// 3x3 kernel through direct and Winograd plans, Winograd saves multiplies but adds transforms
+void run_winograd(uint8_t *img, int width, int height, int channels, homv_matrix matrix) {
+  if (matrix.size != 3) {
+    printf("Winograd: none\n");
+    return;
+  }
+
+  bench_results direct, winograd;
+  homv_plan_force = HOMV_PLAN_DIRECT;
+  run_benchmark(img, width, height, channels, matrix, HOMV_STRATEGY_ROWS, &direct);
+  homv_plan_force = HOMV_PLAN_WINOGRAD;
+  run_benchmark(img, width, height, channels, matrix, HOMV_STRATEGY_ROWS, &winograd);
+  homv_plan_force = HOMV_PLAN_AUTO;
+
+  printf("Winograd(F(2x2, 3x3)): direct %.4f, winograd %.4f\n", average(&direct), average(&winograd));
+}
+
+// Random kernels of growing size through direct (rows) and FFT paths, shows where FFT starts to win
+void run_crossover(uint8_t *img, int width, int height, int channels) {
+  bench_results direct, fft;
+  for (size_t size = 3; size <= CROSSOVER_MAX_KERNEL; size += 4) {
+    homv_matrix *matrix = homv_mx_get_random_matrix(size);
+    homv_plan_force = HOMV_PLAN_DIRECT;
+    run_benchmark_runs(img, width, height, channels, *matrix, HOMV_STRATEGY_ROWS, &direct, CROSSOVER_RUNS);
+    homv_plan_force = HOMV_PLAN_AUTO;
+
+    // HOMV_STRATEGY_FFT would fall back to direct path for small kernels, so FFT is called directly
+    size_t tile_size = homv_fft_best_tile(size, width, height);
+    uint8_t *output = malloc((size_t)width * height * channels);
+    for (size_t i = 0; i < CROSSOVER_RUNS; i++) {
+      double start = omp_get_wtime();
+      homv_fft_convolve(img, output, (size_t)width * channels, width, height, channels, *matrix, tile_size, false);
+      double end = omp_get_wtime();
+      fft.times[i] = end - start;
+    }
+    free(output);
+    fft.count = CROSSOVER_RUNS;
+
+    printf("Crossover(%zux%zu): direct %.4f, fft %.4f (tile %zu)\n", size, size, average(&direct), average(&fft),
+           tile_size);
+    homv_mx_free(matrix);
+  }
+}
+
 int main(int argc, char **argv) {
   if (argc < 3) {
     printf("Usage: %s matrix (queue|noqueue) image1 [image2 ...]\n", argv[0]);
@@ -59,13 +148,17 @@ int main(int argc, char **argv) {
     matrix = homv_matrices[HOMV_MATRIX_OUTLINE];
   } else if (strcmp(argv[1], "random") == 0) {
     matrix = *homv_mx_get_random_matrix(9);
+  } else if (strncmp(argv[1], "box_", 4) == 0 && atoi(argv[1] + 4) > 0) {
+    matrix = *homv_mx_get_box_matrix(atoi(argv[1] + 4));
+  } else if (strncmp(argv[1], "gauss_", 6) == 0 && atof(argv[1] + 6) > 0) {
+    matrix = *homv_mx_get_gauss_matrix(atof(argv[1] + 6));
   } else {
     fprintf(stderr, "Unknown matrix: %s\n", argv[1]);
     return 1;
   }
   printf("Chosen matrix: [%s]\n", argv[1]);
 
-  bench_results seq, rows, cols, area;
+  bench_results seq, rows, cols, area, reflect;
 
   for (int i = 2; i < argc; i++) {
     int width, height, channels;
@@ -77,21 +170,21 @@ int main(int argc, char **argv) {
 
     printf("\nImage %s (%dx%d)\n", argv[i], width, height);
 
-    run_benchmark(img, width, height, channels, matrix, homv_apply_seq, &seq);
+    run_benchmark(img, width, height, channels, matrix, HOMV_STRATEGY_SEQ, &seq);
     printf("Seq: %.4f", seq.times[0]);
     for (size_t i = 1; i < seq.count; i++) {
       printf(",%.4f", seq.times[i]);
     }
     printf("\n");
 
-    run_benchmark(img, width, height, channels, matrix, homv_apply_parallel_rows, &rows);
+    run_benchmark(img, width, height, channels, matrix, HOMV_STRATEGY_ROWS, &rows);
     printf("Rows: %.4f", rows.times[0]);
     for (size_t i = 1; i < rows.count; i++) {
       printf(",%.4f", rows.times[i]);
     }
     printf("\n");
 
-    run_benchmark(img, width, height, channels, matrix, homv_apply_parallel_cols, &cols);
+    run_benchmark(img, width, height, channels, matrix, HOMV_STRATEGY_COLS, &cols);
     printf("Cols: %.4f", cols.times[0]);
     for (size_t i = 1; i < cols.count; i++) {
       printf(",%.4f", cols.times[i]);
@@ -99,13 +192,24 @@ int main(int argc, char **argv) {
     printf("\n");
 
     area_width = area_height = 4;
-    run_benchmark(img, width, height, channels, matrix, homv_apply_parallel_area, &area);
+    run_benchmark(img, width, height, channels, matrix, HOMV_STRATEGY_AREA, &area);
     printf("Area(4x4): %.4f", area.times[0]);
     for (size_t i = 1; i < area.count; i++) {
       printf(",%.4f", area.times[i]);
     }
     printf("\n");
 
+    run_reflect(img, width, height, channels, matrix.size, &reflect);
+    printf("Reflect: %.4f", reflect.times[0]);
+    for (size_t i = 1; i < reflect.count; i++) {
+      printf(",%.4f", reflect.times[i]);
+    }
+    printf("\n");
+
+    run_symmetry(img, width, height, channels, matrix);
+    run_winograd(img, width, height, channels, matrix);
+    run_crossover(img, width, height, channels);
+
     stbi_image_free(img);
   }
 
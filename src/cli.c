@@ -1,9 +1,16 @@
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
+// Decoded images and decoder buffers are taken from buffer pool, so pipeline reuses them between images
+#define STBI_MALLOC(size) homv_pool_alloc(size)
+#define STBI_REALLOC(buffer, size) homv_pool_realloc(buffer, size)
+#define STBI_FREE(buffer) homv_pool_free(buffer)
 #include <ctype.h>
+#include <getopt.h>
 #include <libgen.h>
+#include <math.h>
 #include <omp.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
@@ -12,6 +19,11 @@
 
 #include "homv_core.h"
 #include "homv_matrix.h"
+#include "homv_npy.h"
+#include "homv_plan.h"
+#include "homv_png.h"
+#include "homv_pool.h"
+#include "homv_simd.h"
 #include "stb_image.h"
 #include "stb_image_write.h"
 
@@ -21,9 +33,15 @@ extern ssize_t area_height;
 extern char *filenames[FILE_NAMES_MAX_COUNT];
 extern size_t filenames_count;
 
+// Type of saved values set by --output-type, HOMV_TYPE_MAX keeps type of input. Explicit type or --raw saves
+// values to array file instead of image
+static homv_type output_type = HOMV_TYPE_MAX;
+static bool raw_output = false;
+
 void print_help_message(char **argv) {
-  printf("Usage: %s -p [seq | rows | cols | pixels | area_W_H] -m [blur | sharpen | identity | bottom_sobel | outline "
-         "| random] [-q] ...files\n"
+  printf("Usage: %s -p [seq | rows | cols | pixels | area_W_H | fft] -m [blur | sharpen | identity | bottom_sobel | "
+         "outline | random | box_N | gauss_SIGMA | sobel_mag | sobel_dir][,...][+...] [-t tolerance] [--isa name] [-q] "
+         "[--pool-limit MB] [--alpha mode] [--gray] [--output-type type] [--raw] [--normalize] ...files\n"
          "-   `-p` --- parallelization strategy:\n"
          "    -   `seq` --- sequential mode.\n"
          "    -   `rows` --- parallel by rows.\n"
@@ -31,20 +49,68 @@ void print_help_message(char **argv) {
          "    -   `pixels` --- parallel by individual pixels.\n"
          "    -   `area_W_H` --- splits image into blocks (width W, height H).\n"
          "        Example: `area_64_64`.\n"
+         "    -   `fft` --- FFT convolution by tiles, falls back to `rows` when kernel is too small for FFT.\n"
          "-   `-m` --- convolution matrix:\n"
          "    -   `sharpen`, `blur`, `identity`, `bottom_sobel`, `outline`, `random`.\n"
          "    -   `random` generates a fixed **9×9** matrix in current implementation.\n"
-         "-   `-q` --- enable queue (pipeline) mode. Processing is done via reader/worker/writer threads.\n",
+         "    -   `box_N` --- N×N box blur, its cost does not depend on N. Example: `box_31`.\n"
+         "    -   `gauss_SIGMA` --- Gaussian blur, large sigmas are filtered recursively. Example: `gauss_8.5`.\n"
+         "    -   N and 6 * SIGMA are at most 1024, kernel radius must be smaller than width and height of image.\n"
+         "    -   `sobel_mag`, `sobel_dir` --- magnitude and direction (256 steps of full turn) of Sobel gradient,\n"
+         "        both derivatives are computed in one pass.\n"
+         "    -   Comma separated matrices are applied one after another in one pass, without intermediate\n"
+         "        images. Example: `blur,sharpen,outline`.\n"
+         "    -   Matrices separated by + are applied to one decoded image in one sweep, every result is saved to\n"
+         "        its own file `output/output_<matrix>_<file>`. Example: `blur+outline+sharpen`.\n"
+         "-   `-t` --- allowed relative error of low-rank (SVD) kernel approximation, non-negative, 0.001 by default.\n"
+         "        Kernels that are not separable are applied as sum of few separable ones when it is cheaper.\n"
+         "-   `--isa` --- instruction set of convolution loops: `auto` (default, best supported by CPU), `scalar`,\n"
+         "        `sse4.1`, `avx2`, `avx512`.\n"
+         "-   `-q` --- enable queue (pipeline) mode. Processing is done via reader/worker/writer threads.\n"
+         "-   `--pool-limit` --- megabytes of free image buffers kept for reuse, non-negative, 256 by default.\n"
+         "-   `--alpha` --- filtering of alpha channel of gray and alpha or RGBA images: `convolve` (default, like\n"
+         "        colors), `copy` (alpha is kept, only colors are convolved), `premultiplied` (colors are weighted by\n"
+         "        alpha, so transparent pixels do not bleed into visible ones).\n"
+         "-   `--gray` --- decode images to one luminance channel and save gray results. Color JPEGs skip chroma\n"
+         "        decoding, and every kernel runs on a third of values of RGB image.\n"
+         "-   `--output-type` --- type of saved values: `u8`, `u16`, `i16` (signed, keeps negative responses of\n"
+         "        derivative kernels) or `f32` (not rounded or clamped). Values are saved to NumPy array\n"
+         "        file `output/output_<file>.npy` of height x width x channels values, so next tool reads them as\n"
+         "        they are.\n"
+         "-   `--raw` --- save values to headerless file `.raw` instead of `.npy`, in native byte order.\n"
+         "-   `--normalize` --- stretch 8-bit output from its min..max to 0..255, bounds are found while the last\n"
+         "        kernel stores its output. 16-bit and HDR images need `--output-type u8` with it.\n"
+         "16-bit PNGs are convolved with 16-bit values and saved as 16-bit PNGs, HDR images are convolved in floats\n"
+         "without clamping and saved as HDR images. Queue mode rejects both, and it rejects `--output-type`, `--raw`\n"
+         "and `--normalize`.\n",
          argv[0]);
 }
 
+// Number of option, returns false for empty, negative, not a number or followed by other characters
+bool parse_non_negative(const char *text, double *value) {
+  char *end = NULL;
+  *value = strtod(text, &end);
+  return end != text && *end == '\0' && *value >= 0;
+}
+
 int process_command_line(int argc, char **argv, char **parallel_mode, char **chosen_matrix, bool *q_flag) {
   extern char *optarg;
   extern int optind, opterr, optopt;
 
+  static struct option long_options[] = {
+      {"isa", required_argument, NULL, 'i'},
+      {"pool-limit", required_argument, NULL, 'l'},
+      {"alpha", required_argument, NULL, 'a'},
+      {"gray", no_argument, NULL, 'g'},
+      {"output-type", required_argument, NULL, 'o'},
+      {"raw", no_argument, NULL, 'r'},
+      {"normalize", no_argument, NULL, 'n'},
+      {NULL, 0, NULL, 0},
+  };
+
   int p_flag = 0, m_flag = 0, err_flag = 0;
   int opt = -1;
-  while ((opt = getopt(argc, argv, ":p:m:hq")) != -1) {
+  while ((opt = getopt_long(argc, argv, ":p:m:t:hq", long_options, NULL)) != -1) {
     switch (opt) {
     case 'h':
       print_help_message(argv);
@@ -60,7 +126,54 @@ int process_command_line(int argc, char **argv, char **parallel_mode, char **cho
     case 'q':
       *q_flag = true;
       break;
-    case ':': /* -p or -m without operand */
+    case 't':
+      if (!parse_non_negative(optarg, &homv_svd_tolerance)) {
+        fprintf(stderr, "Invalid tolerance: %s\n", optarg);
+        err_flag++;
+      }
+      break;
+    case 'i': {
+      homv_isa isa = homv_simd_parse(optarg);
+      if (isa == HOMV_ISA_MAX || !homv_simd_select(isa)) {
+        fprintf(stderr, "Unsupported instruction set: %s\n", optarg);
+        err_flag++;
+      }
+      break;
+    }
+    case 'l': {
+      double megabytes = 0;
+      if (!parse_non_negative(optarg, &megabytes) || megabytes >= (double)(SIZE_MAX >> 20)) {
+        fprintf(stderr, "Invalid pool limit: %s\n", optarg);
+        err_flag++;
+      } else {
+        homv_pool_limit = (size_t)(megabytes * (1 << 20));
+      }
+      break;
+    }
+    case 'g':
+      homv_gray = true;
+      break;
+    case 'o':
+      output_type = homv_type_parse(optarg);
+      if (output_type == HOMV_TYPE_MAX) {
+        fprintf(stderr, "Unknown output type: %s\n", optarg);
+        err_flag++;
+      }
+      break;
+    case 'r':
+      raw_output = true;
+      break;
+    case 'n':
+      homv_normalize = true;
+      break;
+    case 'a':
+      homv_alpha_mode = homv_alpha_parse(optarg);
+      if (homv_alpha_mode == HOMV_ALPHA_MAX) {
+        fprintf(stderr, "Unknown alpha mode: %s\n", optarg);
+        err_flag++;
+      }
+      break;
+    case ':': /* -p, -m or -t without operand */
       fprintf(stderr, "Option -%c requires an operand\n", optopt);
       err_flag++;
       break;
@@ -71,6 +184,12 @@ int process_command_line(int argc, char **argv, char **parallel_mode, char **cho
     }
   }
 
+  // Normalization maps values to 0..255, so it needs 8-bit output
+  if (homv_normalize && output_type != HOMV_TYPE_MAX && output_type != HOMV_TYPE_U8) {
+    fprintf(stderr, "--normalize requires 8-bit output, --output-type must be u8\n");
+    err_flag++;
+  }
+
   if (!p_flag || !m_flag) {
     fprintf(stderr, "Options -p and -m required\n");
     return 1;
@@ -89,6 +208,72 @@ int process_command_line(int argc, char **argv, char **parallel_mode, char **cho
   return 0;
 }
 
+// Largest box_N and gauss_SIGMA kernels: N and 2 * ceil(3 * SIGMA) + 1 are at most this
+#define CLI_MAX_KERNEL_SIZE 1025
+
+// Matrix by its name in -m option, returns false for unknown name or too large kernel
+bool parse_matrix(const char *name, homv_matrix *matrix) {
+  if (strcmp(name, "sharpen") == 0) {
+    *matrix = homv_matrices[HOMV_MATRIX_SHARPEN];
+  } else if (strcmp(name, "blur") == 0) {
+    *matrix = homv_matrices[HOMV_MATRIX_BLUR];
+  } else if (strcmp(name, "identity") == 0) {
+    *matrix = homv_matrices[HOMV_MATRIX_IDENTITY];
+  } else if (strcmp(name, "bottom_sobel") == 0) {
+    *matrix = homv_matrices[HOMV_MATRIX_BOTTOM_SOBEL];
+  } else if (strcmp(name, "outline") == 0) {
+    *matrix = homv_matrices[HOMV_MATRIX_OUTLINE];
+  } else if (strcmp(name, "random") == 0) {
+    *matrix = *homv_mx_get_random_matrix(9);
+  } else if (strcmp(name, "sobel_mag") == 0) {
+    *matrix = *homv_mx_get_sobel_matrix(HOMV_MX_GRADIENT_MAGNITUDE);
+  } else if (strcmp(name, "sobel_dir") == 0) {
+    *matrix = *homv_mx_get_sobel_matrix(HOMV_MX_GRADIENT_DIRECTION);
+  } else if (strncmp(name, "box_", 4) == 0 && atoi(name + 4) > 0 && atoi(name + 4) <= CLI_MAX_KERNEL_SIZE) {
+    *matrix = *homv_mx_get_box_matrix(atoi(name + 4));
+  } else if (strncmp(name, "gauss_", 6) == 0 && atof(name + 6) > 0 &&
+             2 * ceil(3 * atof(name + 6)) + 1 <= CLI_MAX_KERNEL_SIZE) {
+    *matrix = *homv_mx_get_gauss_matrix(atof(name + 6));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Count of parts of text separated by separator
+size_t count_parts(const char *text, char separator) {
+  size_t count = 1;
+  for (const char *found = strchr(text, separator); found; found = strchr(found + 1, separator)) {
+    count++;
+  }
+  return count;
+}
+
+// Output of -m option: chain of comma separated matrices applied one after another
+typedef struct {
+  char *name;
+  homv_matrix *matrices;
+  size_t count;
+} cli_output;
+
+// Parse chain of matrices, name is changed by strtok_r. Returns false for unknown matrix
+bool parse_output(char *name, cli_output *output) {
+  output->name = strdup(name);
+  output->count = count_parts(name, ',');
+  output->matrices = malloc(output->count * sizeof(homv_matrix));
+
+  char *save = NULL;
+  char *matrix_name = strtok_r(name, ",", &save);
+  for (size_t i = 0; i < output->count; i++) {
+    if (!matrix_name || !parse_matrix(matrix_name, &output->matrices[i])) {
+      fprintf(stderr, "Unknown or too large matrix: %s\n", matrix_name ? matrix_name : "");
+      return false;
+    }
+    matrix_name = strtok_r(NULL, ",", &save);
+  }
+  return true;
+}
+
 int main(int argc, char **argv) {
   srand(time(NULL));
   char *parallel_mode = NULL;
@@ -103,91 +288,219 @@ int main(int argc, char **argv) {
     printf("Filename: %s\n", filenames[i]);
   }
 
-  uint8_t *(*method)(const uint8_t *, int, int, int, homv_matrix);
+  homv_strategy strategy;
   printf("Chosen mode [%s]\n", parallel_mode);
   if (strcmp(parallel_mode, "seq") == 0) {
-    method = homv_apply_seq;
+    strategy = HOMV_STRATEGY_SEQ;
   } else if (strcmp(parallel_mode, "rows") == 0) {
-    method = homv_apply_parallel_rows;
+    strategy = HOMV_STRATEGY_ROWS;
   } else if (strcmp(parallel_mode, "cols") == 0) {
-    method = homv_apply_parallel_cols;
+    strategy = HOMV_STRATEGY_COLS;
   } else if (strcmp(parallel_mode, "pixels") == 0) {
-    method = homv_apply_parallel_pixels;
+    strategy = HOMV_STRATEGY_PIXELS;
   } else if (strncmp(parallel_mode, "area", 4) == 0) {
     strtok(parallel_mode, "_");
     area_width = atoi(strtok(NULL, "_"));
     area_height = atoi(strtok(NULL, "_"));
-    method = homv_apply_parallel_area;
+    strategy = HOMV_STRATEGY_AREA;
+  } else if (strcmp(parallel_mode, "fft") == 0) {
+    strategy = HOMV_STRATEGY_FFT;
   } else {
     fprintf(stderr, "Unknown mode: %s\n", parallel_mode);
     return 1;
   }
 
-  homv_matrix matrix;
-  if (strcmp(chosen_matrix, "sharpen") == 0) {
-    matrix = homv_matrices[HOMV_MATRIX_SHARPEN];
-  } else if (strcmp(chosen_matrix, "blur") == 0) {
-    matrix = homv_matrices[HOMV_MATRIX_BLUR];
-  } else if (strcmp(chosen_matrix, "identity") == 0) {
-    matrix = homv_matrices[HOMV_MATRIX_IDENTITY];
-  } else if (strcmp(chosen_matrix, "bottom_sobel") == 0) {
-    matrix = homv_matrices[HOMV_MATRIX_BOTTOM_SOBEL];
-  } else if (strcmp(chosen_matrix, "outline") == 0) {
-    matrix = homv_matrices[HOMV_MATRIX_OUTLINE];
-  } else if (strcmp(chosen_matrix, "random") == 0) {
-    matrix = *homv_mx_get_random_matrix(9);
-  } else {
-    fprintf(stderr, "Unknown matrix: %s\n", chosen_matrix);
-    return 1;
-  }
+  // Outputs separated by + are computed from one decoded image
+  size_t outputs_count = count_parts(chosen_matrix, '+');
+  cli_output *outputs = calloc(outputs_count, sizeof(cli_output));
   printf("Chosen matrix: [%s]\n", chosen_matrix);
+  char *save = NULL;
+  char *output_name = strtok_r(chosen_matrix, "+", &save);
+  for (size_t i = 0; i < outputs_count; i++) {
+    if (!output_name || !parse_output(output_name, &outputs[i])) {
+      if (!output_name) {
+        fprintf(stderr, "Empty output in matrix list\n");
+      }
+      return 1;
+    }
+    output_name = strtok_r(NULL, "+", &save);
+  }
+  printf("Instruction set: [%s]\n", homv_simd->name);
+  for (size_t i = 0; i < outputs_count; i++) {
+    if (outputs[i].count > 1) {
+      homv_plan_chain *chain = homv_plan_chain_create(outputs[i].matrices, outputs[i].count);
+      double separate = homv_plan_chain_separate_cost(outputs[i].matrices, outputs[i].count);
+      printf("Chain plan [%s]: %zu of %zu kernels after composition, cost %.2f (%.2f without composition)\n",
+             outputs[i].name, chain->count, outputs[i].count, homv_plan_chain_cost(chain), separate);
+      homv_plan_chain_free(chain);
+    }
+  }
+
+  // Single kernels of fan-out share one sweep over input, chains run one by one
+  bool single_kernels = true;
+  for (size_t i = 0; i < outputs_count; i++) {
+    single_kernels = single_kernels && outputs[i].count == 1;
+  }
+  homv_matrix *fanout = malloc(outputs_count * sizeof(homv_matrix));
+  for (size_t i = 0; i < outputs_count && single_kernels; i++) {
+    fanout[i] = outputs[i].matrices[0];
+  }
 
   if (q_flag) {
-    queue_exec(filenames, filenames_count, method, matrix);
+    if (outputs_count > 1) {
+      fprintf(stderr, "Queue mode supports only one output\n");
+      return 1;
+    }
+    if (output_type != HOMV_TYPE_MAX || raw_output || homv_normalize) {
+      fprintf(stderr, "Queue mode does not support --output-type, --raw and --normalize\n");
+      return 1;
+    }
+    // Queue decodes and saves 8 bits per channel, so wider images are rejected instead of being squashed
+    for (size_t i = 0; i < filenames_count; i++) {
+      if (stbi_is_hdr(filenames[i]) || stbi_is_16_bit(filenames[i])) {
+        fprintf(stderr, "Queue mode does not support %s images, run without -q: %s\n",
+                stbi_is_hdr(filenames[i]) ? "HDR" : "16-bit", filenames[i]);
+        return 1;
+      }
+    }
+    queue_exec(filenames, filenames_count, strategy, outputs[0].matrices, outputs[0].count);
+    homv_pool_stats stats = homv_pool_get_stats();
+    printf("Buffer pool: %zu hits, %zu misses, peak %zu bytes\n", stats.hits, stats.misses, stats.peak_bytes);
     return 0;
   }
 
+  // Output buffers are reused for all images and grow only for bigger one
+  uint8_t **images = calloc(outputs_count, sizeof(uint8_t *));
+  size_t output_size = 0;
   for (size_t filename_i = 0; filename_i < filenames_count; filename_i++) {
     char *filepath = filenames[filename_i];
     char *filename = basename(filepath);
 
+    // 16-bit PNGs and HDR images keep their 16-bit and float values through convolution
+    homv_type type = stbi_is_hdr(filepath)      ? HOMV_TYPE_F32
+                     : stbi_is_16_bit(filepath) ? HOMV_TYPE_U16
+                                                : HOMV_TYPE_U8;
     int width, height, channels;
-    uint8_t *img = stbi_load(filepath, &width, &height, &channels, 0);
+    int components = homv_gray ? 1 : 0;
+    void *img = type == HOMV_TYPE_F32   ? (void *)stbi_loadf(filepath, &width, &height, &channels, components)
+                : type == HOMV_TYPE_U16 ? (void *)stbi_load_16(filepath, &width, &height, &channels, components)
+                                        : (void *)stbi_load(filepath, &width, &height, &channels, components);
+    if (homv_gray) {
+      channels = 1;
+    }
 
     if (!img) {
       printf("Failed to load image: %s\n", filepath);
       continue;
     }
 
-    printf("Loaded image: %dx%d, Channels: %d\n", width, height, channels);
+    printf("Loaded image: %dx%d, Channels: %d%s\n", width, height, channels,
+           type == HOMV_TYPE_F32 ? ", float" : type == HOMV_TYPE_U16 ? ", 16-bit" : "");
+
+    // Borders are reflected once, so image must be wider and higher than radius of every kernel
+    bool fits = true;
+    for (size_t i = 0; i < outputs_count; i++) {
+      for (size_t j = 0; j < outputs[i].count; j++) {
+        fits = fits && homv_kernel_fits(outputs[i].matrices[j].size, width, height);
+      }
+    }
+    if (!fits) {
+      fprintf(stderr, "Kernel is too large for image: %s\n", filepath);
+      stbi_image_free(img);
+      free(filenames[filename_i]);
+      continue;
+    }
+
+    // Values are saved to array file if their type is set explicitly
+    bool array_output = output_type != HOMV_TYPE_MAX || raw_output;
+    homv_type result_type = output_type != HOMV_TYPE_MAX ? output_type : type;
+    if (homv_normalize && result_type != HOMV_TYPE_U8) {
+      fprintf(stderr, "--normalize requires 8-bit output, add --output-type u8 for 16-bit or HDR image: %s\n",
+              filepath);
+      stbi_image_free(img);
+      free(filenames[filename_i]);
+      continue;
+    }
+    size_t output_stride = (size_t)width * channels * homv_type_size(result_type);
+    size_t image_size = height * output_stride;
+    if (output_size < image_size) {
+      for (size_t i = 0; i < outputs_count; i++) {
+        free(images[i]);
+        images[i] = malloc(image_size);
+      }
+      output_size = image_size;
+    }
 
     double start;
     double end;
     start = omp_get_wtime();
-    uint8_t *image_reflected = homv_reflect_image(img, width, height, channels, matrix.size);
-    uint8_t *output = method(image_reflected, width, height, channels, matrix);
+    if (type != HOMV_TYPE_U8 || result_type != HOMV_TYPE_U8 || homv_normalize) {
+      for (size_t i = 0; i < outputs_count; i++) {
+        homv_apply_typed_into(strategy, type, img, width, height, channels, outputs[i].matrices, outputs[i].count,
+                              result_type, images[i], output_stride);
+      }
+    } else if (outputs_count > 1 && single_kernels) {
+      homv_apply_fanout_into(strategy, img, width, height, channels, fanout, outputs_count, images, output_stride);
+    } else {
+      for (size_t i = 0; i < outputs_count; i++) {
+        homv_apply_chain_into(strategy, img, width, height, channels, outputs[i].matrices, outputs[i].count,
+                              images[i], output_stride);
+      }
+    }
     end = omp_get_wtime();
     printf("Work took %f seconds\n", end - start);
-    // uint8_t *output = img;
 
-    char *newfilename = malloc(sizeof(char) * (strlen(filename) + strlen("output/output_") + 1));
+    // Every output of fan-out is saved as output/output_<matrix>_<filename>
+    for (size_t i = 0; i < outputs_count; i++) {
+      char *newfilename = malloc(sizeof(char) * (strlen(filename) + strlen(outputs[i].name) +
+                                                 strlen("output/output__") + strlen(".npy") + 1));
 
-    newfilename[0] = '\0';
-    strcat(newfilename, "output/output_");
-    strcat(newfilename, filename);
+      newfilename[0] = '\0';
+      strcat(newfilename, "output/output_");
+      if (outputs_count > 1) {
+        strcat(newfilename, outputs[i].name);
+        strcat(newfilename, "_");
+      }
+      strcat(newfilename, filename);
 
-    if (stbi_write_jpg(newfilename, width, height, channels, output, 100)) {
-      printf("Image saved as %s\n", newfilename);
-    } else {
-      printf("Failed to save image\n");
+      bool saved;
+      if (array_output) {
+        // Extension of input file is replaced
+        char *extension = strrchr(newfilename, '.');
+        if (extension && extension > strrchr(newfilename, '/')) {
+          *extension = '\0';
+        }
+        strcat(newfilename, raw_output ? ".raw" : ".npy");
+        saved = raw_output ? homv_raw_write(newfilename, width, height, channels, result_type, images[i])
+                           : homv_npy_write(newfilename, width, height, channels, result_type, images[i]);
+      } else if (type == HOMV_TYPE_F32) {
+        saved = stbi_write_hdr(newfilename, width, height, channels, (const float *)images[i]);
+      } else if (type == HOMV_TYPE_U16) {
+        saved = homv_png_write_u16(newfilename, width, height, channels, (const uint16_t *)images[i]);
+      } else {
+        saved = stbi_write_jpg(newfilename, width, height, channels, images[i], 100);
+      }
+      if (saved) {
+        printf("Image saved as %s\n", newfilename);
+      } else {
+        printf("Failed to save image\n");
+      }
+      free(newfilename);
     }
 
     // Освобождаем память
     stbi_image_free(img);
-    free(newfilename);
     free(filenames[filename_i]);
-    free(output);
   }
 
+  for (size_t i = 0; i < outputs_count; i++) {
+    free(images[i]);
+    free(outputs[i].name);
+    free(outputs[i].matrices);
+  }
+  free(images);
+  free(outputs);
+  free(fanout);
+
   return 0;
 }
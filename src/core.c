@@ -1,6 +1,7 @@
 #include <ctype.h>
 #include <homv_matrix.h>
 #include <libgen.h>
+#include <math.h>
 #include <omp.h>
 #include <pthread.h>
 #include <stdbool.h>
@@ -12,6 +13,11 @@
 #include <unistd.h>
 
 #include "homv_core.h"
+#include "homv_fft.h"
+#include "homv_iir.h"
+#include "homv_plan.h"
+#include "homv_pool.h"
+#include "homv_simd.h"
 #include "queue.h"
 #include "stb_image.h"
 #include "stb_image_write.h"
@@ -62,149 +68,1515 @@ ssize_t area_height = 0;
 char *filenames[FILE_NAMES_MAX_COUNT];
 size_t filenames_count;
 
-uint8_t *homv_apply_seq(const uint8_t *image_input, int width, int height, int channels, homv_matrix matrix_input) {
-  uint8_t *output = calloc(width * height * channels, sizeof(uint8_t));
+// Image that is convolved: either padded by homv_reflect_image (padding is kernel size / 2)
+// or original one (padding is 0), then reflected borders are computed on the fly
+typedef struct {
+  const uint8_t *image;
+  int width;
+  int height;
+  int channels;
+  ssize_t padding;
+  homv_type type;
+} homv_input;
 
-  ssize_t mx_size = ((ssize_t)matrix_input.size);
-  for (ssize_t img_x = 0; img_x < width; img_x++) {
-    for (ssize_t img_y = 0; img_y < height; img_y++) {
-      ssize_t input_img_x = img_x + mx_size / 2;
-      ssize_t input_img_y = img_y + mx_size / 2;
-      for (ssize_t mx_x = 0; mx_x < mx_size; mx_x++) {
-        for (ssize_t mx_y = 0; mx_y < mx_size; mx_y++) {
-          ssize_t mx_img_x = input_img_x + (mx_x - (mx_size / 2));
-          ssize_t mx_img_y = input_img_y + (mx_y - (mx_size / 2));
-          for (ssize_t color = 0; color < channels; color++) {
-            output[img_y * width * channels + img_x * channels + color] +=
-                image_input[mx_img_y * (width + mx_size - 1) * channels + mx_img_x * channels + color] *
-                matrix_input.values[mx_y * mx_size + mx_x];
-          }
-        }
+// Output image, its rows are stride bytes apart. If range is not NULL, min and max of float output values
+// are merged to range[0] and range[1] while they are stored
+typedef struct {
+  uint8_t *image;
+  ssize_t stride;
+  homv_type type;
+  float *range;
+} homv_output;
+
+// Scratch buffers of area executors. They are kept per thread and only grow,
+// so convolution of next image of the same size does not allocate
+typedef enum {
+  HOMV_SCRATCH_ROWS = 0, // pointers to input rows of area
+  HOMV_SCRATCH_PATCH,    // reflected border columns
+  HOMV_SCRATCH_ACC,      // accumulated output row
+  HOMV_SCRATCH_RING,     // horizontal pass rows of separable terms
+  HOMV_SCRATCH_FOLD,     // sum or difference of mirrored input rows
+  HOMV_SCRATCH_WINOGRAD, // deinterleaved pixels, row transforms and output tiles of Winograd plan
+  HOMV_SCRATCH_ALPHA,    // packed band and its color output of HOMV_ALPHA_COPY and HOMV_ALPHA_PREMULTIPLIED modes
+  HOMV_SCRATCH_MAX
+} homv_scratch;
+
+static _Thread_local struct {
+  void *data;
+  size_t size;
+} homv_scratch_buffers[HOMV_SCRATCH_MAX];
+
+static void *homv_scratch_get(homv_scratch scratch, size_t size) {
+  if (homv_scratch_buffers[scratch].size < size) {
+    free(homv_scratch_buffers[scratch].data);
+    homv_scratch_buffers[scratch].data = malloc(size);
+    homv_scratch_buffers[scratch].size = size;
+  }
+  return homv_scratch_buffers[scratch].data;
+}
+
+// Area executors get rows of padded image: input_rows[j] points to padded pixel (x0, y0 + j),
+// where (x0, y0) is top left corner of area, so area_height + mx_size - 1 rows are read.
+// Output of area is written to output rows of output_stride bytes, span values in each row
+
+// Direct convolution. Output rows are computed by blocks of HOMV_SIMD_BLOCK_ROWS rows:
+// sums stay in registers, every input row is loaded once per block and every output value is stored once
+static void homv_direct_area(const uint8_t **input_rows, uint8_t *output, ssize_t output_stride, ssize_t span,
+                             ssize_t area_height, int channels, const homv_plan *plan) {
+  ssize_t mx_size = ((ssize_t)plan->matrix.size);
+  uint8_t *output_rows[HOMV_SIMD_BLOCK_ROWS];
+
+  for (ssize_t img_y = 0; img_y < area_height; img_y += HOMV_SIMD_BLOCK_ROWS) {
+    ssize_t rows = area_height - img_y < HOMV_SIMD_BLOCK_ROWS ? area_height - img_y : HOMV_SIMD_BLOCK_ROWS;
+    for (ssize_t row = 0; row < rows; row++) {
+      output_rows[row] = output + (img_y + row) * output_stride;
+    }
+    homv_simd->convolve_u8(output_rows, input_rows + img_y, plan->taps, mx_size, channels, rows, span);
+  }
+}
+
+// Convolution with sum of plan->terms separable kernels.
+// For every term input rows are convolved with its row once and kept in ring of mx_size row buffers,
+// each output row is then sum over terms of mx_size buffered rows multiplied by term col
+static void homv_separable_area(const uint8_t **input_rows, uint8_t *output, ssize_t output_stride, ssize_t span,
+                                ssize_t area_height, int channels, const homv_plan *plan) {
+  ssize_t mx_size = ((ssize_t)plan->matrix.size);
+  ssize_t terms = ((ssize_t)plan->terms);
+  float *ring = homv_scratch_get(HOMV_SCRATCH_RING, terms * mx_size * span * sizeof(float));
+  float *acc = homv_scratch_get(HOMV_SCRATCH_ACC, span * sizeof(float));
+
+  for (ssize_t row = 0; row < area_height + mx_size - 1; row++) {
+    for (ssize_t term = 0; term < terms; term++) {
+      float *horizontal = ring + (term * mx_size + row % mx_size) * span;
+      memset(horizontal, 0, span * sizeof(float));
+      homv_simd->madd_row_u8(horizontal, input_rows[row], plan->taps + term * mx_size, mx_size, channels, span);
+    }
+
+    ssize_t img_y = row - (mx_size - 1);
+    if (img_y < 0) {
+      continue;
+    }
+
+    memset(acc, 0, span * sizeof(float));
+    for (ssize_t term = 0; term < terms; term++) {
+      const double *term_col = plan->cols + term * mx_size;
+      for (ssize_t mx_y = 0; mx_y < mx_size; mx_y++) {
+        homv_simd->madd_f32(acc, ring + (term * mx_size + (img_y + mx_y) % mx_size) * span, (float)term_col[mx_y],
+                            span);
       }
     }
+    homv_simd->store_u8(output + img_y * output_stride, acc, span);
   }
+}
 
-  return (uint8_t *)output;
+// Convolution with integer kernel plan->weights / plan->divisor by blocks of rows like homv_direct_area.
+// Sums are exact in int16 and divided by divisor once per output value
+static void homv_integer_area(const uint8_t **input_rows, uint8_t *output, ssize_t output_stride, ssize_t span,
+                              ssize_t area_height, int channels, const homv_plan *plan) {
+  ssize_t mx_size = ((ssize_t)plan->matrix.size);
+  uint8_t *output_rows[HOMV_SIMD_BLOCK_ROWS];
+
+  for (ssize_t img_y = 0; img_y < area_height; img_y += HOMV_SIMD_BLOCK_ROWS) {
+    ssize_t rows = area_height - img_y < HOMV_SIMD_BLOCK_ROWS ? area_height - img_y : HOMV_SIMD_BLOCK_ROWS;
+    for (ssize_t row = 0; row < rows; row++) {
+      output_rows[row] = output + (img_y + row) * output_stride;
+    }
+    homv_simd->convolve_i16(output_rows, input_rows + img_y, plan->weights, mx_size, channels, plan->multiplier, rows,
+                            span);
+  }
 }
 
-uint8_t *homv_apply_parallel_rows(const uint8_t *image_input, int width, int height, int channels,
-                                  homv_matrix matrix_input) {
-  uint8_t *output = calloc(width * height * channels, sizeof(uint8_t));
-
-  ssize_t mx_size = ((ssize_t)matrix_input.size);
-  ssize_t img_x, img_y, mx_x, mx_y, color;
-#pragma omp parallel for shared(output) private(img_x, img_y, mx_x, mx_y, color)
-  for (img_y = 0; img_y < height; img_y++) {
-    for (img_x = 0; img_x < width; img_x++) {
-      ssize_t input_img_x = img_x + mx_size / 2;
-      ssize_t input_img_y = img_y + mx_size / 2;
-      for (mx_x = 0; mx_x < mx_size; mx_x++) {
-        for (mx_y = 0; mx_y < mx_size; mx_y++) {
-          ssize_t mx_img_x = input_img_x + (mx_x - (mx_size / 2));
-          ssize_t mx_img_y = input_img_y + (mx_y - (mx_size / 2));
-          for (color = 0; color < channels; color++) {
-            output[img_y * width * channels + img_x * channels + color] +=
-                image_input[mx_img_y * (width + mx_size - 1) * channels + mx_img_x * channels + color] *
-                matrix_input.values[mx_y * mx_size + mx_x];
+// Only non-zero taps are summed. Kernel of one unit tap (identity or shift) is a copy of input rows
+static void homv_sparse_area(const uint8_t **input_rows, uint8_t *output, ssize_t output_stride, ssize_t span,
+                             ssize_t area_height, int channels, const homv_plan *plan) {
+  const homv_tap *taps = plan->sparse;
+  bool copy = plan->sparse_count == 1 && taps[0].weight == 1 && plan->multiplier == 0;
+
+  for (ssize_t img_y = 0; img_y < area_height; img_y++) {
+    uint8_t *output_row = output + img_y * output_stride;
+    if (copy) {
+      memcpy(output_row, input_rows[img_y + taps[0].dy] + taps[0].dx * channels, span);
+    } else {
+      homv_simd->convolve_sparse_i16(output_row, input_rows + img_y, taps, plan->sparse_count, channels,
+                                     plan->multiplier, span);
+    }
+  }
+}
+
+// Convolution with kernel symmetric or antisymmetric about its axes or center (plan->symmetry_*).
+// Mirrored input values are added or subtracted first and multiplied by their common tap once, plan->fold says
+// which of them. Kernels symmetric about vertical axis are folded inside blocks of rows like homv_direct_area,
+// otherwise every output row folds mirrored input rows (horizontal axis), pixels (center) or both axes on its own
+static void homv_symmetric_area(const uint8_t **input_rows, uint8_t *output, ssize_t output_stride, ssize_t span,
+                                ssize_t area_height, int channels, const homv_plan *plan) {
+  ssize_t mx_size = ((ssize_t)plan->matrix.size);
+  ssize_t half = mx_size / 2;
+  bool odd = mx_size % 2;
+
+  if (plan->fold == HOMV_FOLD_X) {
+    uint8_t *output_rows[HOMV_SIMD_BLOCK_ROWS];
+    for (ssize_t img_y = 0; img_y < area_height; img_y += HOMV_SIMD_BLOCK_ROWS) {
+      ssize_t rows = area_height - img_y < HOMV_SIMD_BLOCK_ROWS ? area_height - img_y : HOMV_SIMD_BLOCK_ROWS;
+      for (ssize_t row = 0; row < rows; row++) {
+        output_rows[row] = output + (img_y + row) * output_stride;
+      }
+      homv_simd->convolve_fold_u8(output_rows, input_rows + img_y, plan->taps, mx_size, channels, plan->symmetry_x,
+                                  rows, span);
+    }
+    return;
+  }
+
+  float *acc = homv_scratch_get(HOMV_SCRATCH_ACC, span * sizeof(float));
+  float *fold = homv_scratch_get(HOMV_SCRATCH_FOLD, (span + (mx_size - 1) * channels) * sizeof(float));
+  for (ssize_t img_y = 0; img_y < area_height; img_y++) {
+    const uint8_t **rows = input_rows + img_y;
+    memset(acc, 0, span * sizeof(float));
+
+    if (plan->fold == HOMV_FOLD_Y || plan->fold == HOMV_FOLD_QUARTER) {
+      // Middle row of kernel antisymmetric about horizontal axis is zero
+      for (ssize_t mx_y = 0; mx_y < half + (odd && plan->symmetry_y > 0); mx_y++) {
+        const uint8_t *mirror = mx_y < half ? rows[mx_size - 1 - mx_y] : NULL;
+        const float *taps = plan->taps + mx_y * mx_size;
+        homv_simd->fold_u8(fold, rows[mx_y], mirror, plan->symmetry_y, span + (mx_size - 1) * channels);
+        if (plan->fold == HOMV_FOLD_Y) {
+          for (ssize_t mx_x = 0; mx_x < mx_size; mx_x++) {
+            homv_simd->madd_f32(acc, fold + mx_x * channels, taps[mx_x], span);
           }
+          continue;
+        }
+        // Folded row is folded again about vertical axis, middle column of antisymmetric kernel is zero
+        homv_simd->madd_pair_f32(acc, fold, fold + (mx_size - 1) * channels, taps, half, channels,
+                                 plan->symmetry_x, span);
+        if (odd && plan->symmetry_x > 0) {
+          homv_simd->madd_f32(acc, fold + half * channels, taps[half], span);
+        }
+      }
+    } else {
+      // Tap (x, y) is paired with (size - 1 - x, size - 1 - y), middle row of odd kernel with itself
+      for (ssize_t mx_y = 0; mx_y <= (mx_size - 1) / 2; mx_y++) {
+        const float *taps = plan->taps + mx_y * mx_size;
+        const uint8_t *mirror = rows[mx_size - 1 - mx_y] + (mx_size - 1) * channels;
+        bool middle = mx_y == mx_size - 1 - mx_y;
+        homv_simd->madd_pair_u8(acc, rows[mx_y], mirror, taps, middle ? half : mx_size, channels,
+                                plan->symmetry_point, span);
+        if (middle && plan->symmetry_point > 0) {
+          homv_simd->madd_u8(acc, rows[mx_y] + half * channels, taps[half], span);
         }
       }
     }
+
+    homv_simd->store_u8(output + img_y * output_stride, acc, span);
   }
+}
 
-  return (uint8_t *)output;
+// Convolution with kernel of equal coefficients: sums of window are kept while it slides, so cost does not depend
+// on kernel size. Column sums of mx_size input rows slide down by one row per output row,
+// then window sums slide along output row over column sums, which is the only serial loop
+static void homv_box_area(const uint8_t **input_rows, uint8_t *output, ssize_t output_stride, ssize_t span,
+                          ssize_t area_height, int channels, const homv_plan *plan) {
+  ssize_t mx_size = ((ssize_t)plan->matrix.size);
+  ssize_t input_span = span + (mx_size - 1) * channels;
+  int32_t *columns = homv_scratch_get(HOMV_SCRATCH_RING, input_span * sizeof(int32_t));
+  int32_t *sums = homv_scratch_get(HOMV_SCRATCH_ACC, span * sizeof(int32_t));
+  memset(columns, 0, input_span * sizeof(int32_t));
+
+  for (ssize_t row = 0; row < area_height + mx_size - 1; row++) {
+    homv_simd->slide_u8(columns, input_rows[row], row >= mx_size ? input_rows[row - mx_size] : NULL, input_span);
+    ssize_t img_y = row - (mx_size - 1);
+    if (img_y < 0) {
+      continue;
+    }
+
+    // Running sum of every channel stays in register
+    for (ssize_t channel = 0; channel < span && channel < channels; channel++) {
+      int32_t sum = 0;
+      for (ssize_t mx_x = 0; mx_x < mx_size; mx_x++) {
+        sum += columns[channel + mx_x * channels];
+      }
+      sums[channel] = sum;
+      for (ssize_t i = channel + channels; i < span; i += channels) {
+        sum += columns[i + (mx_size - 1) * channels] - columns[i - channels];
+        sums[i] = sum;
+      }
+    }
+    homv_simd->store_i32(output + img_y * output_stride, sums, (float)plan->box_scale, span);
+  }
 }
 
-uint8_t *homv_apply_parallel_cols(const uint8_t *image_input, int width, int height, int channels,
-                                  homv_matrix matrix_input) {
-  uint8_t *output = calloc(width * height * channels, sizeof(uint8_t));
-
-  ssize_t mx_size = ((ssize_t)matrix_input.size);
-  ssize_t img_x, img_y, mx_x, mx_y, color;
-#pragma omp parallel for shared(output) private(img_x, img_y, mx_x, mx_y, color)
-  for (img_x = 0; img_x < width; img_x++) {
-    for (img_y = 0; img_y < height; img_y++) {
-      ssize_t input_img_x = img_x + mx_size / 2;
-      ssize_t input_img_y = img_y + mx_size / 2;
-      for (mx_x = 0; mx_x < mx_size; mx_x++) {
-        for (mx_y = 0; mx_y < mx_size; mx_y++) {
-          ssize_t mx_img_x = input_img_x + (mx_x - (mx_size / 2));
-          ssize_t mx_img_y = input_img_y + (mx_y - (mx_size / 2));
-          for (color = 0; color < channels; color++) {
-            output[img_y * width * channels + img_x * channels + color] +=
-                image_input[mx_img_y * (width + mx_size - 1) * channels + mx_img_x * channels + color] *
-                matrix_input.values[mx_y * mx_size + mx_x];
-          }
-        }
+// Even and odd pixels of input row of pixels + 2 pixels. Odd pixel after last one exists only for even pixels.
+// Channel counts are constants in specialized copies, so loops are unrolled and vectorized
+__attribute__((always_inline)) static inline void homv_winograd_deinterleave(float *even, float *odd,
+                                                                             const uint8_t *src, ssize_t pixels,
+                                                                             int channels) {
+  ssize_t pairs = pixels / 2 + 1;
+  for (ssize_t x = 0; x < pairs; x++) {
+    for (int channel = 0; channel < channels; channel++) {
+      even[x * channels + channel] = src[2 * x * channels + channel];
+      odd[x * channels + channel] = src[(2 * x + 1) * channels + channel];
+    }
+  }
+  if (pixels % 2) {
+    for (int channel = 0; channel < channels; channel++) {
+      even[pairs * channels + channel] = src[2 * pairs * channels + channel];
+      odd[pairs * channels + channel] = 0;
+    }
+  }
+}
+
+__attribute__((always_inline)) static inline void homv_winograd_interleave(float *acc, const float *even,
+                                                                           const float *odd, ssize_t pixels,
+                                                                           int channels) {
+  for (ssize_t x = 0; x < pixels / 2; x++) {
+    for (int channel = 0; channel < channels; channel++) {
+      acc[2 * x * channels + channel] = even[x * channels + channel];
+      acc[(2 * x + 1) * channels + channel] = odd[x * channels + channel];
+    }
+  }
+  if (pixels % 2) {
+    for (int channel = 0; channel < channels; channel++) {
+      acc[(pixels - 1) * channels + channel] = even[pixels / 2 * channels + channel];
+    }
+  }
+}
+
+static void homv_winograd_split(float *even, float *odd, const uint8_t *src, ssize_t pixels, int channels) {
+  switch (channels) {
+  case 1:
+    homv_winograd_deinterleave(even, odd, src, pixels, 1);
+    break;
+  case 3:
+    homv_winograd_deinterleave(even, odd, src, pixels, 3);
+    break;
+  case 4:
+    homv_winograd_deinterleave(even, odd, src, pixels, 4);
+    break;
+  default:
+    homv_winograd_deinterleave(even, odd, src, pixels, channels);
+  }
+}
+
+static void homv_winograd_merge(float *acc, const float *even, const float *odd, ssize_t pixels, int channels) {
+  switch (channels) {
+  case 1:
+    homv_winograd_interleave(acc, even, odd, pixels, 1);
+    break;
+  case 3:
+    homv_winograd_interleave(acc, even, odd, pixels, 3);
+    break;
+  case 4:
+    homv_winograd_interleave(acc, even, odd, pixels, 4);
+    break;
+  default:
+    homv_winograd_interleave(acc, even, odd, pixels, channels);
+  }
+}
+
+// Winograd F(2x2, 3x3) convolution of 3x3 kernel. Pixels of input row are deinterleaved to even and odd ones,
+// so 4 input columns of every 2x2 output tile are contiguous lanes and transforms run across tiles.
+// Row transforms of 4 input rows are kept in ring, every pair of output rows adds 2 new ones.
+// Two pixels of tile are rounded differently, so tiles are anchored to even image coordinates: area starting
+// at odd column (odd_x) or row (odd_y) begins with tile whose first column or row is outside of it. Second
+// pixel of tile does not read input of the first one, so that input is zero and its output is discarded
+static void homv_winograd_area(const uint8_t **input_rows, uint8_t *output, ssize_t output_stride, ssize_t span,
+                               ssize_t area_height, int channels, const homv_plan *plan, bool odd_x, bool odd_y) {
+  ssize_t pixels = span / channels + odd_x;
+  ssize_t tiles = (pixels + 1) / 2;
+  ssize_t lanes = tiles * channels;
+  ssize_t half_span = (tiles + 1) * channels;
+  // Input row of odd area is copied after zero pixel
+  ssize_t shifted_size = (pixels + 2) * channels;
+  float *even = homv_scratch_get(HOMV_SCRATCH_WINOGRAD,
+                                 (2 * half_span + 20 * lanes + pixels * channels) * sizeof(float) + shifted_size);
+  float *odd = even + half_span;
+  float *ring = odd + half_span;
+  float *tile_rows[4] = {ring + 16 * lanes, ring + 17 * lanes, ring + 18 * lanes, ring + 19 * lanes};
+  float *acc = ring + 20 * lanes;
+  uint8_t *shifted = (uint8_t *)(acc + pixels * channels);
+  memset(shifted, 0, channels);
+
+  for (ssize_t img_y = -odd_y; img_y < area_height; img_y += 2) {
+    const float *transforms[16];
+    for (ssize_t row = 0; row < 4; row++) {
+      ssize_t in_y = img_y + row;
+      float *row_transforms[4];
+      for (ssize_t k = 0; k < 4; k++) {
+        row_transforms[k] = ring + (((in_y + 4) % 4) * 4 + k) * lanes;
+        transforms[row * 4 + k] = row_transforms[k];
+      }
+      if (row < 2 && img_y > -odd_y) {
+        continue;
+      }
+      // Tile rows above odd area and below area with odd height are not stored, so their input is zero
+      if (in_y < 0 || in_y >= area_height + 2) {
+        memset(row_transforms[0], 0, 4 * lanes * sizeof(float));
+        continue;
+      }
+
+      const uint8_t *src = input_rows[in_y];
+      if (odd_x) {
+        memcpy(shifted + channels, src, shifted_size - channels);
+        src = shifted;
       }
+      homv_winograd_split(even, odd, src, pixels, channels);
+      homv_simd->winograd_row_f32(row_transforms, even, odd, channels, lanes);
+    }
+
+    homv_simd->winograd_tile_f32(tile_rows, transforms, plan->taps, lanes);
+    for (ssize_t row = img_y < 0; row < 2 && img_y + row < area_height; row++) {
+      homv_winograd_merge(acc, tile_rows[2 * row], tile_rows[2 * row + 1], pixels, channels);
+      homv_simd->store_u8(output + (img_y + row) * output_stride, acc + odd_x * channels, span);
     }
   }
+}
 
-  return (uint8_t *)output;
+// Sobel gradient: both derivatives of output row come from one load of every input value.
+// Direction is rare and computed with atan2f, magnitude is vectorized
+static void homv_gradient_area(const uint8_t **input_rows, uint8_t *output, ssize_t output_stride, ssize_t span,
+                               ssize_t area_height, int channels, const homv_plan *plan) {
+  int16_t *gx = homv_scratch_get(HOMV_SCRATCH_ACC, 2 * span * sizeof(int16_t));
+  int16_t *gy = gx + span;
+
+  for (ssize_t img_y = 0; img_y < area_height; img_y++) {
+    uint8_t *output_row = output + img_y * output_stride;
+    homv_simd->sobel_i16(gx, gy, input_rows + img_y, channels, span);
+    if (plan->matrix.gradient == HOMV_MX_GRADIENT_MAGNITUDE) {
+      homv_simd->magnitude_u8(output_row, gx, gy, span);
+      continue;
+    }
+    for (ssize_t i = 0; i < span; i++) {
+      output_row[i] = (uint8_t)(lrintf(atan2f(gy[i], gx[i]) * (float)(128 / M_PI)) & 255);
+    }
+  }
 }
 
-uint8_t *homv_apply_parallel_pixels(const uint8_t *image_input, int width, int height, int channels,
-                                    homv_matrix matrix_input) {
-  uint8_t *output = calloc(width * height * channels, sizeof(uint8_t));
-
-  ssize_t mx_size = ((ssize_t)matrix_input.size);
-  ssize_t pixel_id, mx_x, mx_y, color;
-#pragma omp parallel for shared(output) private(pixel_id, mx_x, mx_y, color)
-  for (pixel_id = 0; pixel_id < width * height; pixel_id++) {
-    ssize_t img_x = pixel_id % width;
-    ssize_t img_y = pixel_id / width;
-    ssize_t input_img_x = img_x + mx_size / 2;
-    ssize_t input_img_y = img_y + mx_size / 2;
-    for (mx_x = 0; mx_x < mx_size; mx_x++) {
-      for (mx_y = 0; mx_y < mx_size; mx_y++) {
-        ssize_t mx_img_x = input_img_x + (mx_x - (mx_size / 2));
-        ssize_t mx_img_y = input_img_y + (mx_y - (mx_size / 2));
-        for (color = 0; color < channels; color++) {
-          output[img_y * width * channels + img_x * channels + color] +=
-              image_input[mx_img_y * (width + mx_size - 1) * channels + mx_img_x * channels + color] *
-              matrix_input.values[mx_y * mx_size + mx_x];
+// Row of count values of type as floats. Float rows are read in place, other ones are widened to dst
+__attribute__((always_inline)) static inline const float *homv_wide_load(float *dst, const uint8_t *src,
+                                                                         size_t count, homv_type type) {
+  switch (type) {
+  case HOMV_TYPE_F32:
+    return (const float *)src;
+  case HOMV_TYPE_U16:
+    homv_simd->widen_u16(dst, (const uint16_t *)src, count);
+    return dst;
+  case HOMV_TYPE_I16:
+    homv_simd->widen_i16(dst, (const int16_t *)src, count);
+    return dst;
+  default:
+    homv_simd->fold_u8(dst, src, NULL, 1, count);
+    return dst;
+  }
+}
+
+// Sums as they are to floats, rounded and saturated to range of integer type.
+// Bounds of float values are updated if bounds is not NULL
+static void homv_wide_store(uint8_t *dst, const float *acc, size_t count, homv_type type, float *bounds) {
+  switch (type) {
+  case HOMV_TYPE_F32:
+    memcpy(dst, acc, count * sizeof(float));
+    if (bounds) {
+      homv_simd->range_f32(bounds, acc, count);
+    }
+    break;
+  case HOMV_TYPE_I16:
+    homv_simd->narrow_i16((int16_t *)dst, acc, count);
+    break;
+  case HOMV_TYPE_U16:
+    homv_simd->store_u16((uint16_t *)dst, acc, count);
+    break;
+  default:
+    homv_simd->store_u8(dst, acc, count);
+  }
+}
+
+// Gradient magnitude or direction of values of type. Direction is in radians for floats,
+// integer types map -pi..pi to their whole range
+static void homv_wide_gradient(uint8_t *dst, float *gx, const float *gy, size_t count, homv_mx_gradient gradient,
+                               homv_type type, float *bounds) {
+  bool magnitude = gradient == HOMV_MX_GRADIENT_MAGNITUDE;
+  if (magnitude || type == HOMV_TYPE_F32) {
+    for (size_t i = 0; i < count; i++) {
+      gx[i] = magnitude ? sqrtf(gx[i] * gx[i] + gy[i] * gy[i]) : atan2f(gy[i], gx[i]);
+    }
+    homv_wide_store(dst, gx, count, type, bounds);
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    long step = lrintf(atan2f(gy[i], gx[i]) * (float)(type == HOMV_TYPE_U8 ? 128 / M_PI : 32768 / M_PI));
+    if (type == HOMV_TYPE_U8) {
+      dst[i] = (uint8_t)(step & 255);
+    } else {
+      // Signed direction wraps pi to -pi like unsigned one wraps it to 0
+      ((uint16_t *)dst)[i] = (uint16_t)(step & 65535);
+    }
+  }
+}
+
+// Convolution of values wider than 8 bits, or stored to wider values, in floats. Input rows are widened once:
+// separable kinds keep horizontal pass rows in ring like homv_separable_area (box kernel is one term of unit row
+// and box_scale column), other kinds keep mx_size widened input rows in ring and add every non-zero tap of kernel.
+// Float input rows are not copied. Input type is constant in specialized copies.
+// Bounds of float output of area are merged to range once
+__attribute__((always_inline)) static inline void homv_wide_rows(const uint8_t **input_rows, uint8_t *output,
+                                                                 ssize_t output_stride, ssize_t span,
+                                                                 ssize_t area_height, int channels,
+                                                                 const homv_plan *plan, homv_type input_type,
+                                                                 homv_type output_type, float *range) {
+  static const double sobel_x[9] = {-1, 0, 1, -2, 0, 2, -1, 0, 1};
+  static const double sobel_y[9] = {-1, -2, -1, 0, 0, 0, 1, 2, 1};
+  ssize_t mx_size = ((ssize_t)plan->matrix.size);
+  ssize_t input_span = span + (mx_size - 1) * channels;
+  bool box = plan->kind == HOMV_PLAN_BOX;
+  bool gradient = plan->kind == HOMV_PLAN_GRADIENT;
+  ssize_t terms = box ? 1 : plan->kind == HOMV_PLAN_SEPARABLE || plan->kind == HOMV_PLAN_LOW_RANK ? plan->terms : 0;
+  const double *values = gradient ? sobel_x : plan->matrix.values;
+  ssize_t ring_size = terms ? terms * mx_size * span + input_span : mx_size * input_span;
+  float *ring = homv_scratch_get(HOMV_SCRATCH_RING, ring_size * sizeof(float));
+  float *acc = homv_scratch_get(HOMV_SCRATCH_ACC, 2 * span * sizeof(float));
+  float area_range[2] = {INFINITY, -INFINITY};
+  float *bounds = range ? area_range : NULL;
+
+  for (ssize_t row = 0; row < area_height + mx_size - 1; row++) {
+    if (terms) {
+      const float *widened = homv_wide_load(ring + terms * mx_size * span, input_rows[row], input_span, input_type);
+      for (ssize_t term = 0; term < terms; term++) {
+        float *horizontal = ring + (term * mx_size + row % mx_size) * span;
+        memset(horizontal, 0, span * sizeof(float));
+        for (ssize_t mx_x = 0; mx_x < mx_size; mx_x++) {
+          homv_simd->madd_f32(horizontal, widened + mx_x * channels, box ? 1 : plan->taps[term * mx_size + mx_x],
+                              span);
         }
       }
+    } else {
+      homv_wide_load(ring + (row % mx_size) * input_span, input_rows[row], input_span, input_type);
+    }
+
+    ssize_t img_y = row - (mx_size - 1);
+    if (img_y < 0) {
+      continue;
+    }
+
+    memset(acc, 0, (gradient ? 2 : 1) * span * sizeof(float));
+    for (ssize_t mx_y = 0; mx_y < mx_size; mx_y++) {
+      for (ssize_t term = 0; term < terms; term++) {
+        homv_simd->madd_f32(acc, ring + (term * mx_size + (img_y + mx_y) % mx_size) * span,
+                            box ? (float)plan->box_scale : (float)plan->cols[term * mx_size + mx_y], span);
+      }
+      const float *window_row = input_type == HOMV_TYPE_F32 ? (const float *)input_rows[img_y + mx_y]
+                                                            : ring + ((img_y + mx_y) % mx_size) * input_span;
+      for (ssize_t mx_x = 0; !terms && mx_x < mx_size; mx_x++) {
+        if (values[mx_y * mx_size + mx_x] != 0) {
+          homv_simd->madd_f32(acc, window_row + mx_x * channels, (float)values[mx_y * mx_size + mx_x], span);
+        }
+        if (gradient && sobel_y[mx_y * mx_size + mx_x] != 0) {
+          homv_simd->madd_f32(acc + span, window_row + mx_x * channels, (float)sobel_y[mx_y * mx_size + mx_x], span);
+        }
+      }
+    }
+
+    if (gradient) {
+      homv_wide_gradient(output + img_y * output_stride, acc, acc + span, span, plan->matrix.gradient, output_type,
+                         bounds);
+    } else {
+      homv_wide_store(output + img_y * output_stride, acc, span, output_type, bounds);
     }
   }
 
-  return (uint8_t *)output;
+  if (range) {
+#pragma omp critical(homv_range)
+    {
+      range[0] = area_range[0] < range[0] ? area_range[0] : range[0];
+      range[1] = area_range[1] > range[1] ? area_range[1] : range[1];
+    }
+  }
 }
 
-// global variables for type compability
-uint8_t *homv_apply_parallel_area(const uint8_t *image_input, int width, int height, int channels,
-                                  homv_matrix matrix_input) {
-  uint8_t *output = calloc(width * height * channels, sizeof(uint8_t));
-  ssize_t mx_size = ((ssize_t)matrix_input.size);
+static void homv_wide_area(const uint8_t **input_rows, uint8_t *output, ssize_t output_stride, ssize_t span,
+                           ssize_t area_height, int channels, const homv_plan *plan, homv_type input_type,
+                           homv_type output_type, float *range) {
+  switch (input_type) {
+  case HOMV_TYPE_F32:
+    homv_wide_rows(input_rows, output, output_stride, span, area_height, channels, plan, HOMV_TYPE_F32, output_type,
+                   range);
+    break;
+  case HOMV_TYPE_I16:
+    homv_wide_rows(input_rows, output, output_stride, span, area_height, channels, plan, HOMV_TYPE_I16, output_type,
+                   range);
+    break;
+  case HOMV_TYPE_U16:
+    homv_wide_rows(input_rows, output, output_stride, span, area_height, channels, plan, HOMV_TYPE_U16, output_type,
+                   range);
+    break;
+  default:
+    homv_wide_rows(input_rows, output, output_stride, span, area_height, channels, plan, HOMV_TYPE_U8, output_type,
+                   range);
+  }
+}
+
+// Rows of input_type values to output_type values, range is homv_output.range. First output pixel is (x0, y0)
+// of image. Executors of plan kinds are 8-bit only
+static void homv_execute_area(const uint8_t **input_rows, uint8_t *output, ssize_t output_stride, ssize_t span,
+                              ssize_t area_height, int channels, const homv_plan *plan, homv_type input_type,
+                              homv_type output_type, float *range, ssize_t x0, ssize_t y0) {
+  if (input_type != HOMV_TYPE_U8 || output_type != HOMV_TYPE_U8) {
+    homv_wide_area(input_rows, output, output_stride, span, area_height, channels, plan, input_type, output_type,
+                   range);
+    return;
+  }
+
+  switch (plan->kind) {
+  case HOMV_PLAN_SEPARABLE:
+  case HOMV_PLAN_LOW_RANK:
+    homv_separable_area(input_rows, output, output_stride, span, area_height, channels, plan);
+    break;
+  case HOMV_PLAN_INTEGER:
+    homv_integer_area(input_rows, output, output_stride, span, area_height, channels, plan);
+    break;
+  case HOMV_PLAN_SPARSE:
+    homv_sparse_area(input_rows, output, output_stride, span, area_height, channels, plan);
+    break;
+  case HOMV_PLAN_SYMMETRIC:
+    homv_symmetric_area(input_rows, output, output_stride, span, area_height, channels, plan);
+    break;
+  case HOMV_PLAN_BOX:
+    homv_box_area(input_rows, output, output_stride, span, area_height, channels, plan);
+    break;
+  case HOMV_PLAN_WINOGRAD:
+    homv_winograd_area(input_rows, output, output_stride, span, area_height, channels, plan, x0 % 2, y0 % 2);
+    break;
+  case HOMV_PLAN_GRADIENT:
+    homv_gradient_area(input_rows, output, output_stride, span, area_height, channels, plan);
+    break;
+  default:
+    homv_direct_area(input_rows, output, output_stride, span, area_height, channels, plan);
+    break;
+  }
+}
+
+// Columns [x0, x1) near left or right border of original image. Their input is copied to small patch
+// with reflected columns, then convolved as padded image
+static void homv_convolve_border(const homv_input *input, const homv_output *output, const homv_plan *plan, ssize_t x0,
+                                 ssize_t y0, ssize_t x1, ssize_t y1) {
+  if (x0 >= x1) {
+    return;
+  }
+
+  ssize_t mx_size = (ssize_t)plan->matrix.size;
+  ssize_t channels = input->channels;
+  // Pixel sizes in bytes
+  ssize_t pixel = channels * homv_type_size(input->type);
+  ssize_t output_pixel = channels * homv_type_size(output->type);
+  ssize_t patch_stride = (x1 - x0 + mx_size - 1) * pixel;
+  ssize_t rows_count = y1 - y0 + mx_size - 1;
+  uint8_t *patch = homv_scratch_get(HOMV_SCRATCH_PATCH, rows_count * patch_stride);
+  const uint8_t **input_rows = homv_scratch_get(HOMV_SCRATCH_ROWS, rows_count * sizeof(uint8_t *));
+
+  for (ssize_t row = 0; row < rows_count; row++) {
+    const uint8_t *image_row =
+        input->image + homv_reflect_index(y0 + row - mx_size / 2, input->height) * input->width * pixel;
+    for (ssize_t col = 0; col < x1 - x0 + mx_size - 1; col++) {
+      ssize_t image_col = homv_reflect_index(x0 + col - mx_size / 2, input->width);
+      memcpy(patch + row * patch_stride + col * pixel, image_row + image_col * pixel, pixel);
+    }
+    input_rows[row] = patch + row * patch_stride;
+  }
+
+  homv_execute_area(input_rows, output->image + y0 * output->stride + x0 * output_pixel, output->stride,
+                    (x1 - x0) * channels, y1 - y0, channels, plan, input->type, output->type, output->range, x0, y0);
+}
+
+// Convolve output area [x0, x1) x [y0, y1) the way plan says.
+// Every pixel is computed the same way whatever area it belongs to, so all strategies give equal results.
+// Original image is read in place except columns within kernel radius of left and right borders:
+// rows above and below image are just pointers to reflected rows
+static void homv_convolve_area(const homv_input *input, const homv_output *output, const homv_plan *plan, ssize_t x0,
+                               ssize_t y0, ssize_t x1, ssize_t y1) {
+  if (x0 >= x1 || y0 >= y1) {
+    return;
+  }
+
+  ssize_t mx_size = (ssize_t)plan->matrix.size;
+  ssize_t radius = mx_size / 2;
+  ssize_t channels = input->channels;
+  // Pixel sizes in bytes
+  ssize_t pixel = channels * homv_type_size(input->type);
+  ssize_t output_pixel = channels * homv_type_size(output->type);
+  ssize_t input_stride = (ssize_t)input->width * pixel;
+  ssize_t rows_count = y1 - y0 + mx_size - 1;
+  const uint8_t **input_rows = homv_scratch_get(HOMV_SCRATCH_ROWS, rows_count * sizeof(uint8_t *));
+
+  if (input->padding) {
+    ssize_t padded_stride = (input->width + mx_size - 1) * pixel;
+    for (ssize_t row = 0; row < rows_count; row++) {
+      input_rows[row] = input->image + (y0 + row) * padded_stride + x0 * pixel;
+    }
+    homv_execute_area(input_rows, output->image + y0 * output->stride + x0 * output_pixel, output->stride,
+                      (x1 - x0) * channels, y1 - y0, channels, plan, input->type, output->type, output->range, x0,
+                      y0);
+    return;
+  }
+
+  ssize_t inner_x0 = x0 > radius ? x0 : radius < x1 ? radius : x1;
+  ssize_t inner_x1 = x1 < input->width - radius ? x1 : input->width - radius;
+  if (inner_x1 < inner_x0) {
+    inner_x1 = inner_x0;
+  }
+
+  if (inner_x0 < inner_x1) {
+    for (ssize_t row = 0; row < rows_count; row++) {
+      input_rows[row] = input->image + homv_reflect_index(y0 + row - radius, input->height) * input_stride +
+                        (inner_x0 - radius) * pixel;
+    }
+    homv_execute_area(input_rows, output->image + y0 * output->stride + inner_x0 * output_pixel, output->stride,
+                      (inner_x1 - inner_x0) * channels, y1 - y0, channels, plan, input->type, output->type,
+                      output->range, inner_x0, y0);
+  }
+
+  homv_convolve_border(input, output, plan, x0, y0, inner_x0, y1);
+  homv_convolve_border(input, output, plan, inner_x1, y0, x1, y1);
+}
+
+// Bounds of part number `index` when `total` is split to `parts` contiguous parts
+static inline ssize_t homv_split(ssize_t total, ssize_t parts, ssize_t index) { return total * index / parts; }
+
+// Strategies differ only in how output is split to areas between threads
+typedef void(homv_run_type)(const homv_input *input, const homv_output *output, const homv_plan *plan);
+
+static void homv_run_seq(const homv_input *input, const homv_output *output, const homv_plan *plan) {
+  homv_convolve_area(input, output, plan, 0, 0, input->width, input->height);
+}
+
+// Every thread gets contiguous strip of rows, so separable passes reuse their line buffers
+static void homv_run_rows(const homv_input *input, const homv_output *output, const homv_plan *plan) {
+#pragma omp parallel
+  {
+    ssize_t strips = omp_get_num_threads();
+    ssize_t strip = omp_get_thread_num();
+    homv_convolve_area(input, output, plan, 0, homv_split(input->height, strips, strip), input->width,
+                       homv_split(input->height, strips, strip + 1));
+  }
+}
+
+static void homv_run_cols(const homv_input *input, const homv_output *output, const homv_plan *plan) {
+#pragma omp parallel
+  {
+    ssize_t strips = omp_get_num_threads();
+    ssize_t strip = omp_get_thread_num();
+    homv_convolve_area(input, output, plan, homv_split(input->width, strips, strip), 0,
+                       homv_split(input->width, strips, strip + 1), input->height);
+  }
+}
+
+// Every thread gets contiguous range of pixels. Range is processed as its head and tail row parts
+// and block of full rows between them
+static void homv_run_pixels(const homv_input *input, const homv_output *output, const homv_plan *plan) {
+  ssize_t width = input->width;
+#pragma omp parallel
+  {
+    ssize_t ranges = omp_get_num_threads();
+    ssize_t range = omp_get_thread_num();
+    ssize_t pixel_begin = homv_split(width * input->height, ranges, range);
+    ssize_t pixel_end = homv_split(width * input->height, ranges, range + 1);
+
+    ssize_t head_y = pixel_begin / width;
+    ssize_t tail_y = pixel_end / width;
+    if (head_y == tail_y) {
+      homv_convolve_area(input, output, plan, pixel_begin % width, head_y, pixel_end % width, head_y + 1);
+    } else {
+      ssize_t full_y = head_y;
+      if (pixel_begin % width != 0) {
+        homv_convolve_area(input, output, plan, pixel_begin % width, head_y, width, head_y + 1);
+        full_y++;
+      }
+      homv_convolve_area(input, output, plan, 0, full_y, width, tail_y);
+      homv_convolve_area(input, output, plan, 0, tail_y, pixel_end % width, tail_y + 1);
+    }
+  }
+}
 
-  ssize_t img_x, img_y, mx_x, mx_y, color;
+static void homv_run_area(const homv_input *input, const homv_output *output, const homv_plan *plan) {
+  ssize_t width = input->width;
+  ssize_t height = input->height;
   ssize_t area_row_counts = (height + area_height - 1) / area_height; // module with ceil
   ssize_t area_col_counts = (width + area_width - 1) / area_width;
   ssize_t area_index = 0;
-#pragma omp parallel for shared(output) private(area_index, img_x, img_y, mx_x, mx_y, color)
+#pragma omp parallel for private(area_index)
   for (area_index = 0; area_index < area_row_counts * area_col_counts; area_index++) {
     ssize_t area_x = area_index % area_col_counts;
     ssize_t area_y = area_index / area_col_counts;
-    for (img_y = area_y * area_height; img_y < (area_y + 1) * area_height && img_y < height; img_y++) {
-      for (img_x = area_x * area_width; img_x < (area_x + 1) * area_width && img_x < width; img_x++) {
-        ssize_t input_img_x = img_x + mx_size / 2;
-        ssize_t input_img_y = img_y + mx_size / 2;
-        for (mx_x = 0; mx_x < mx_size; mx_x++) {
-          for (mx_y = 0; mx_y < mx_size; mx_y++) {
-            ssize_t mx_img_x = input_img_x + (mx_x - (mx_size / 2));
-            ssize_t mx_img_y = input_img_y + (mx_y - (mx_size / 2));
-            for (color = 0; color < channels; color++) {
-              output[img_y * width * channels + img_x * channels + color] +=
-                  image_input[mx_img_y * (width + mx_size - 1) * channels + mx_img_x * channels + color] *
-                  matrix_input.values[mx_y * mx_size + mx_x];
-            }
-          }
+    ssize_t x1 = (area_x + 1) * area_width < width ? (area_x + 1) * area_width : width;
+    ssize_t y1 = (area_y + 1) * area_height < height ? (area_y + 1) * area_height : height;
+    homv_convolve_area(input, output, plan, area_x * area_width, area_y * area_height, x1, y1);
+  }
+}
+
+// Direct path is taken when FFT is not cheaper for this kernel and image, kernel is not linear or values are not 8-bit
+static void homv_run_fft(const homv_input *input, const homv_output *output, const homv_plan *plan) {
+  size_t mx_size = plan->matrix.size;
+  size_t tile_size = homv_fft_best_tile(mx_size, input->width, input->height);
+  double fft_cost = tile_size ? homv_fft_cost(mx_size, tile_size) : INFINITY;
+  if (plan->kind == HOMV_PLAN_GRADIENT || input->type != HOMV_TYPE_U8 || output->type != HOMV_TYPE_U8 ||
+      homv_plan_cost(plan) <= fft_cost) {
+    homv_run_rows(input, output, plan);
+    return;
+  }
+
+  homv_fft_convolve(input->image, output->image, output->stride, input->width, input->height, input->channels,
+                    plan->matrix, tile_size, input->padding > 0);
+}
+
+static homv_run_type *const homv_runs[HOMV_STRATEGY_MAX] = {
+    [HOMV_STRATEGY_SEQ] = homv_run_seq,       [HOMV_STRATEGY_ROWS] = homv_run_rows,
+    [HOMV_STRATEGY_COLS] = homv_run_cols,     [HOMV_STRATEGY_PIXELS] = homv_run_pixels,
+    [HOMV_STRATEGY_AREA] = homv_run_area,     [HOMV_STRATEGY_FFT] = homv_run_fft,
+};
+
+// Plan of kernel that was convolved last by this thread. Kernel is compared by values,
+// so plan is built again only when kernel, planner settings or instruction set change
+static _Thread_local struct {
+  homv_plan *plan;
+  double *values;
+  homv_plan_kind force;
+  double svd_tolerance;
+  const homv_simd_ops *simd;
+} homv_plan_cache;
+
+static const homv_plan *homv_plan_cached(homv_matrix matrix_input) {
+  size_t values_size = matrix_input.size * matrix_input.size * sizeof(double);
+  homv_plan *plan = homv_plan_cache.plan;
+  if (plan && plan->matrix.size == matrix_input.size && plan->matrix.sigma == matrix_input.sigma &&
+      plan->matrix.gradient == matrix_input.gradient &&
+      homv_plan_cache.force == homv_plan_force && homv_plan_cache.simd == homv_simd &&
+      homv_plan_cache.svd_tolerance == homv_svd_tolerance &&
+      memcmp(homv_plan_cache.values, matrix_input.values, values_size) == 0) {
+    plan->matrix = matrix_input;
+    return plan;
+  }
+
+  homv_plan_free(plan);
+  free(homv_plan_cache.values);
+  homv_plan_cache.plan = homv_plan_create(matrix_input);
+  homv_plan_cache.values = malloc(values_size);
+  memcpy(homv_plan_cache.values, matrix_input.values, values_size);
+  homv_plan_cache.force = homv_plan_force;
+  homv_plan_cache.svd_tolerance = homv_svd_tolerance;
+  homv_plan_cache.simd = homv_simd;
+  return homv_plan_cache.plan;
+}
+
+// Convolution of all channels like color ones
+static void homv_convolve_into(homv_strategy strategy, const homv_input *input, homv_matrix matrix_input,
+                               const homv_output *output) {
+  const homv_plan *plan = homv_plan_cached(matrix_input);
+  // Recursive filter needs whole rows and columns, so it is not split to areas:
+  // strategy only chooses whether rows and columns are filtered in parallel
+  if (plan->kind == HOMV_PLAN_RECURSIVE) {
+    homv_iir_gauss(input->image, input->type, input->padding, output->image, output->type, output->stride,
+                   output->range, input->width, input->height, input->channels, plan->matrix.sigma,
+                   strategy != HOMV_STRATEGY_SEQ);
+    return;
+  }
+  homv_runs[strategy](input, output, plan);
+}
+
+homv_alpha homv_alpha_mode = HOMV_ALPHA_CONVOLVE;
+
+homv_alpha homv_alpha_parse(const char *name) {
+  static const char *const names[HOMV_ALPHA_MAX] = {
+      [HOMV_ALPHA_CONVOLVE] = "convolve", [HOMV_ALPHA_COPY] = "copy", [HOMV_ALPHA_PREMULTIPLIED] = "premultiplied"};
+  for (homv_alpha mode = HOMV_ALPHA_CONVOLVE; mode < HOMV_ALPHA_MAX; mode++) {
+    if (strcmp(name, names[mode]) == 0) {
+      return mode;
+    }
+  }
+  return HOMV_ALPHA_MAX;
+}
+
+// Gray and alpha or RGB and alpha images have alpha in last channel
+static inline bool homv_alpha_separate(int channels) {
+  return homv_alpha_mode != HOMV_ALPHA_CONVOLVE && (channels == 2 || channels == 4);
+}
+
+// Convolution of whole image by one of entry points, its context is arguments of entry point
+typedef void(homv_alpha_body)(const homv_input *input, uint8_t *output, size_t output_stride, const void *context);
+
+// Row helpers below get channel count as constant from their dispatchers, so inner loops are unrolled
+
+// Color channels of count pixels, multiplied by alpha and followed by alpha if premultiplied.
+// (t + (t >> 8)) >> 8 with t = value * alpha + 128 is value * alpha / 255 rounded to nearest
+__attribute__((always_inline)) static inline void homv_alpha_pack_row(uint8_t *restrict dst,
+                                                                      const uint8_t *restrict src, size_t count,
+                                                                      int channels, bool premultiplied) {
+  int colors = channels - 1;
+  if (premultiplied) {
+    for (size_t x = 0; x < count; x++) {
+      uint32_t alpha = src[x * channels + colors];
+      for (int color = 0; color < colors; color++) {
+        uint32_t product = src[x * channels + color] * alpha + 128;
+        dst[x * channels + color] = (product + (product >> 8)) >> 8;
+      }
+      dst[x * channels + colors] = alpha;
+    }
+    return;
+  }
+
+  // Whole pixel is stored and its alpha is overwritten by next pixel
+  size_t x = 0;
+  for (; channels == 4 && x + 1 < count; x++) {
+    uint32_t pixel;
+    memcpy(&pixel, src + x * channels, sizeof(pixel));
+    memcpy(dst + x * colors, &pixel, sizeof(pixel));
+  }
+  for (; x < count; x++) {
+    memcpy(dst + x * colors, src + x * channels, colors);
+  }
+}
+
+// Colors of count pixels divided by their alpha in place. reciprocals[alpha] is 2^32 / alpha rounded up,
+// so division by multiply is exact for dividends below 2^24
+__attribute__((always_inline)) static inline void homv_alpha_unpremultiply_row(uint8_t *restrict row, size_t count,
+                                                                               int channels,
+                                                                               const uint64_t *reciprocals) {
+  int colors = channels - 1;
+  for (size_t x = 0; x < count; x++) {
+    uint32_t alpha = row[x * channels + colors];
+    uint64_t reciprocal = reciprocals[alpha];
+    for (int color = 0; color < colors; color++) {
+      uint32_t value = (uint32_t)(((row[x * channels + color] * 255 + alpha / 2) * reciprocal) >> 32);
+      row[x * channels + color] = value > 255 ? 255 : value;
+    }
+  }
+}
+
+// Convolved colors of count pixels followed by alpha of input pixels
+__attribute__((always_inline)) static inline void homv_alpha_merge_row(uint8_t *restrict dst,
+                                                                       const uint8_t *restrict colors_src,
+                                                                       const uint8_t *restrict alpha_src,
+                                                                       size_t count, int channels) {
+  int colors = channels - 1;
+  // Colors of next pixel are read with colors of this one and then covered by alpha
+  size_t x = 0;
+  for (; channels == 4 && x + 1 < count; x++) {
+    uint32_t pixel;
+    memcpy(&pixel, colors_src + x * colors, sizeof(pixel));
+    memcpy(dst + x * channels, &pixel, sizeof(pixel));
+    dst[x * channels + colors] = alpha_src[x * channels + colors];
+  }
+  for (; x < count; x++) {
+    memcpy(dst + x * channels, colors_src + x * colors, colors);
+    dst[x * channels + colors] = alpha_src[x * channels + colors];
+  }
+}
+
+static void homv_alpha_pack(uint8_t *dst, const uint8_t *src, size_t count, int channels, bool premultiplied) {
+  if (channels == 4) {
+    premultiplied ? homv_alpha_pack_row(dst, src, count, 4, true) : homv_alpha_pack_row(dst, src, count, 4, false);
+  } else {
+    premultiplied ? homv_alpha_pack_row(dst, src, count, 2, true) : homv_alpha_pack_row(dst, src, count, 2, false);
+  }
+}
+
+static void homv_alpha_unpremultiply(uint8_t *row, size_t count, int channels, const uint64_t *reciprocals) {
+  channels == 4 ? homv_alpha_unpremultiply_row(row, count, 4, reciprocals)
+                : homv_alpha_unpremultiply_row(row, count, 2, reciprocals);
+}
+
+static void homv_alpha_reciprocals(uint64_t reciprocals[256]) {
+  reciprocals[0] = 0;
+  for (uint64_t alpha = 1; alpha < 256; alpha++) {
+    reciprocals[alpha] = ((1ULL << 32) + alpha - 1) / alpha;
+  }
+}
+
+static void homv_alpha_merge(uint8_t *dst, const uint8_t *colors_src, const uint8_t *alpha_src, size_t count,
+                             int channels) {
+  channels == 4 ? homv_alpha_merge_row(dst, colors_src, alpha_src, count, 4)
+                : homv_alpha_merge_row(dst, colors_src, alpha_src, count, 2);
+}
+
+// Alpha of count output pixels is replaced by alpha of input pixels. Eight bytes are blended at once by mask of
+// their alpha bytes, pixels of 2 and 4 channels never straddle them
+static void homv_alpha_restore(uint8_t *restrict dst, const uint8_t *restrict src, size_t count, int channels) {
+  uint64_t mask = channels == 4 ? 0xFF000000FF000000u : 0xFF00FF00FF00FF00u;
+  size_t size = count * channels;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t colors, alpha;
+    memcpy(&colors, dst + i, sizeof(colors));
+    memcpy(&alpha, src + i, sizeof(alpha));
+    colors = (colors & ~mask) | (alpha & mask);
+    memcpy(dst + i, &colors, sizeof(colors));
+  }
+  for (i += channels - 1; i < size; i += channels) {
+    dst[i] = src[i];
+  }
+}
+
+// Plan cost from which HOMV_ALPHA_COPY packs colors without alpha. Cheaper kernels convolve alpha with colors,
+// which are convolved independently of it, and then overwrite it by input alpha: packing and merging cost more
+// than convolution of alpha they save. Measured on RGBA image, packing loses with integer 3x3 and direct 5x5
+// kernels and wins from direct 7x7
+#define HOMV_ALPHA_PACK_COST 36
+
+static inline bool homv_alpha_in_place(const homv_plan *plan) {
+  return homv_alpha_mode == HOMV_ALPHA_COPY && homv_plan_cost(plan) < HOMV_ALPHA_PACK_COST;
+}
+
+// Alpha channel by homv_alpha_mode. HOMV_ALPHA_COPY packs color channels to image without alpha, so SIMD lanes
+// hold only colors, convolves it and puts alpha of input back. HOMV_ALPHA_PREMULTIPLIED multiplies colors by alpha,
+// convolves all channels and divides colors by convolved alpha
+static void homv_alpha_run(const homv_input *input, uint8_t *output, size_t output_stride, bool parallel,
+                           homv_alpha_body *body, const void *context) {
+  int channels = input->channels;
+  int colors = channels - 1;
+  bool premultiplied = homv_alpha_mode == HOMV_ALPHA_PREMULTIPLIED;
+  int packed_channels = premultiplied ? channels : colors;
+  ssize_t input_width = input->width + 2 * input->padding;
+  ssize_t input_height = input->height + 2 * input->padding;
+  uint8_t *packed = homv_pool_alloc(input_width * input_height * packed_channels);
+
+  ssize_t y = 0;
+#pragma omp parallel for if (parallel) private(y)
+  for (y = 0; y < input_height; y++) {
+    homv_alpha_pack(packed + y * input_width * packed_channels, input->image + y * input_width * channels, input_width,
+                    channels, premultiplied);
+  }
+
+  homv_input packed_input = {packed, input->width, input->height, packed_channels, input->padding, HOMV_TYPE_U8};
+  if (premultiplied) {
+    uint64_t reciprocals[256];
+    homv_alpha_reciprocals(reciprocals);
+    body(&packed_input, output, output_stride, context);
+#pragma omp parallel for if (parallel) private(y)
+    for (y = 0; y < input->height; y++) {
+      homv_alpha_unpremultiply(output + y * output_stride, input->width, channels, reciprocals);
+    }
+    homv_pool_free(packed);
+    return;
+  }
+
+  size_t colors_stride = input->width * colors;
+  uint8_t *colors_output = homv_pool_alloc(input->height * colors_stride);
+  body(&packed_input, colors_output, colors_stride, context);
+#pragma omp parallel for if (parallel) private(y)
+  for (y = 0; y < input->height; y++) {
+    homv_alpha_merge(output + y * output_stride, colors_output + y * colors_stride,
+                     input->image + ((y + input->padding) * input_width + input->padding) * channels, input->width,
+                     channels);
+  }
+  homv_pool_free(colors_output);
+  homv_pool_free(packed);
+}
+
+// Output rows of one band of kernel with separate alpha. Band is at least twice higher than kernel,
+// so packing of its halo rows adds at most half of packing work
+#define HOMV_ALPHA_BAND_ROWS 16
+
+// One kernel with separate alpha: image is split to bands of rows, every band is packed with reflected
+// borders, convolved and merged while it stays in cache. Kernels cheaper than HOMV_ALPHA_PACK_COST convolve
+// bands of original image and restore their alpha instead. Bands are convolved in parallel unless strategy is
+// sequential, all area strategies give the same output
+static void homv_alpha_bands(homv_strategy strategy, const homv_input *input, const homv_plan *plan,
+                             uint8_t *output, size_t output_stride) {
+  int channels = input->channels;
+  int colors = channels - 1;
+  bool premultiplied = homv_alpha_mode == HOMV_ALPHA_PREMULTIPLIED;
+  int packed_channels = premultiplied ? channels : colors;
+  ssize_t width = input->width;
+  ssize_t height = input->height;
+  ssize_t mx_size = (ssize_t)plan->matrix.size;
+  ssize_t radius = mx_size / 2;
+  ssize_t packed_width = width + mx_size - 1;
+  ssize_t packed_stride = packed_width * packed_channels;
+  ssize_t colors_stride = width * colors;
+  ssize_t band_rows = HOMV_ALPHA_BAND_ROWS > 2 * mx_size ? HOMV_ALPHA_BAND_ROWS : 2 * mx_size;
+  ssize_t bands = (height + band_rows - 1) / band_rows;
+  bool in_place = homv_alpha_in_place(plan);
+  uint64_t reciprocals[256];
+  homv_alpha_reciprocals(reciprocals);
+
+  ssize_t band = 0;
+#pragma omp parallel for schedule(dynamic) if (strategy != HOMV_STRATEGY_SEQ) private(band)
+  for (band = 0; band < bands; band++) {
+    ssize_t y0 = band * band_rows;
+    ssize_t rows = y0 + band_rows < height ? band_rows : height - y0;
+    if (in_place) {
+      homv_output image_output = {output, (ssize_t)output_stride, HOMV_TYPE_U8, NULL};
+      homv_convolve_area(input, &image_output, plan, 0, y0, width, y0 + rows);
+      for (ssize_t row = y0; row < y0 + rows; row++) {
+        homv_alpha_restore(output + row * output_stride, input->image + row * width * channels, width, channels);
+      }
+      continue;
+    }
+    ssize_t rows_count = rows + mx_size - 1;
+    uint8_t *packed = homv_scratch_get(HOMV_SCRATCH_ALPHA, rows_count * packed_stride + rows * colors_stride);
+    uint8_t *colors_output = packed + rows_count * packed_stride;
+
+    for (ssize_t row = 0; row < rows_count; row++) {
+      const uint8_t *src = input->image + homv_reflect_index(y0 + row - radius, height) * width * channels;
+      uint8_t *dst = packed + row * packed_stride;
+      homv_alpha_pack(dst + radius * packed_channels, src, width, channels, premultiplied);
+      // Reflected border columns, radius on the left and the rest on the right
+      for (ssize_t border = 0; border < mx_size - 1; border++) {
+        ssize_t x = border < radius ? border : border + width;
+        memcpy(dst + x * packed_channels, dst + (radius + homv_reflect_index(x - radius, width)) * packed_channels,
+               packed_channels);
+      }
+    }
+
+    homv_input band_input = {packed, width, rows, packed_channels, radius, HOMV_TYPE_U8};
+    homv_output band_output = {premultiplied ? output + y0 * output_stride : colors_output,
+                               premultiplied ? (ssize_t)output_stride : colors_stride, HOMV_TYPE_U8, NULL};
+    homv_convolve_area(&band_input, &band_output, plan, 0, 0, width, rows);
+
+    for (ssize_t row = 0; row < rows; row++) {
+      uint8_t *dst = output + (y0 + row) * output_stride;
+      if (premultiplied) {
+        homv_alpha_unpremultiply(dst, width, channels, reciprocals);
+      } else {
+        homv_alpha_merge(dst, colors_output + row * colors_stride, input->image + (y0 + row) * width * channels,
+                         width, channels);
+      }
+    }
+  }
+}
+
+typedef struct {
+  homv_strategy strategy;
+  homv_matrix matrix;
+} homv_alpha_single;
+
+static void homv_alpha_convolve(const homv_input *input, uint8_t *output, size_t output_stride, const void *context) {
+  const homv_alpha_single *single = context;
+  homv_output convolved = {output, (ssize_t)output_stride, HOMV_TYPE_U8, NULL};
+  homv_convolve_into(single->strategy, input, single->matrix, &convolved);
+}
+
+static void homv_run_into(homv_strategy strategy, const homv_input *input, homv_matrix matrix_input,
+                          uint8_t *output_image, size_t output_stride) {
+  if (homv_alpha_separate(input->channels)) {
+    const homv_plan *plan = homv_plan_cached(matrix_input);
+    // Recursive filter and FFT need whole image
+    if (plan->kind != HOMV_PLAN_RECURSIVE && strategy != HOMV_STRATEGY_FFT && input->padding == 0) {
+      homv_alpha_bands(strategy, input, plan, output_image, output_stride);
+      return;
+    }
+    if (homv_alpha_in_place(plan)) {
+      homv_output output = {output_image, (ssize_t)output_stride, HOMV_TYPE_U8, NULL};
+      homv_convolve_into(strategy, input, matrix_input, &output);
+      ssize_t input_width = input->width + 2 * input->padding;
+      ssize_t y = 0;
+#pragma omp parallel for if (strategy != HOMV_STRATEGY_SEQ) private(y)
+      for (y = 0; y < input->height; y++) {
+        homv_alpha_restore(output_image + y * output_stride,
+                           input->image + ((y + input->padding) * input_width + input->padding) * input->channels,
+                           input->width, input->channels);
+      }
+      return;
+    }
+    homv_alpha_single single = {strategy, matrix_input};
+    homv_alpha_run(input, output_image, output_stride, strategy != HOMV_STRATEGY_SEQ, homv_alpha_convolve, &single);
+    return;
+  }
+  homv_output output = {output_image, (ssize_t)output_stride, HOMV_TYPE_U8, NULL};
+  homv_convolve_into(strategy, input, matrix_input, &output);
+}
+
+// Kernels of entry point must fit image, see homv_kernel_fits
+static bool homv_check_kernels(const homv_matrix *matrices, size_t count, int width, int height) {
+  for (size_t i = 0; i < count; i++) {
+    if (!homv_kernel_fits(matrices[i].size, width, height)) {
+      fprintf(stderr, "Kernel %zux%zu is too large for %dx%d image\n", matrices[i].size, matrices[i].size, width,
+              height);
+      return false;
+    }
+  }
+  return true;
+}
+
+static uint8_t *homv_run(homv_strategy strategy, const homv_input *input, homv_matrix matrix_input) {
+  if (!homv_check_kernels(&matrix_input, 1, input->width, input->height)) {
+    return NULL;
+  }
+  size_t output_stride = (size_t)input->width * input->channels;
+  uint8_t *output = malloc(input->height * output_stride);
+  homv_run_into(strategy, input, matrix_input, output, output_stride);
+  return output;
+}
+
+bool homv_apply_into(homv_strategy strategy, const uint8_t *image_input, int width, int height, int channels,
+                     homv_matrix matrix_input, uint8_t *output, size_t output_stride) {
+  if (!homv_check_kernels(&matrix_input, 1, width, height)) {
+    return false;
+  }
+  homv_input input = {image_input, width, height, channels, 0, HOMV_TYPE_U8};
+  homv_run_into(strategy, &input, matrix_input, output, output_stride);
+  return true;
+}
+
+uint8_t *homv_apply(homv_strategy strategy, const uint8_t *image_input, int width, int height, int channels,
+                    homv_matrix matrix_input) {
+  homv_input input = {image_input, width, height, channels, 0, HOMV_TYPE_U8};
+  return homv_run(strategy, &input, matrix_input);
+}
+
+// Output rows of one chain stage computed at once
+#define HOMV_CHAIN_BLOCK_ROWS 8
+
+// Stage of kernel chain. Stage 0 copies rows of source image, stage i > 0 convolves rows of stage i - 1 with
+// kernel i - 1. Every stage but the last keeps its rows in ring of HOMV_CHAIN_BLOCK_ROWS + next kernel size - 1
+// rows, padded by reflected pixels for next kernel. Stages produce rows only when next stage asks for them,
+// so ring always holds every row next stage reads
+typedef struct {
+  const homv_plan *plan; // NULL for source stage
+  ssize_t padding;       // pixels reflected on both sides of ring rows, radius of next kernel
+  ssize_t capacity;      // rows in ring
+  ssize_t row_size;      // bytes in padded ring row
+  uint8_t *ring;
+  ssize_t produced; // rows before it are in ring
+} homv_chain_stage;
+
+typedef struct {
+  const uint8_t *image;
+  ssize_t width;
+  ssize_t height;
+  ssize_t channels;
+  homv_chain_stage *stages;
+} homv_chain;
+
+// Padded row y of ring, it starts at reflected pixel -padding
+static inline uint8_t *homv_chain_row(const homv_chain_stage *stage, ssize_t y) {
+  return stage->ring + (y % stage->capacity) * stage->row_size;
+}
+
+static void homv_chain_pull(const homv_chain *chain, size_t index, ssize_t last_row);
+
+// Rows [y0, y1) of stage to output rows of output_stride bytes
+static void homv_chain_produce(const homv_chain *chain, size_t index, ssize_t y0, ssize_t y1, uint8_t *output,
+                               ssize_t output_stride) {
+  ssize_t span = chain->width * chain->channels;
+  if (index == 0) {
+    for (ssize_t y = y0; y < y1; y++) {
+      memcpy(output + (y - y0) * output_stride, chain->image + y * span, span);
+    }
+    return;
+  }
+
+  const homv_plan *plan = chain->stages[index].plan;
+  ssize_t mx_size = (ssize_t)plan->matrix.size;
+  ssize_t radius = mx_size / 2;
+  homv_chain_pull(chain, index - 1, y1 - 1 + mx_size - 1 - radius);
+
+  ssize_t rows_count = y1 - y0 + mx_size - 1;
+  const uint8_t **input_rows = homv_scratch_get(HOMV_SCRATCH_ROWS, rows_count * sizeof(uint8_t *));
+  for (ssize_t row = 0; row < rows_count; row++) {
+    input_rows[row] = homv_chain_row(&chain->stages[index - 1], homv_reflect_index(y0 + row - radius, chain->height));
+  }
+  homv_execute_area(input_rows, output, output_stride, span, y1 - y0, chain->channels, plan, HOMV_TYPE_U8,
+                    HOMV_TYPE_U8, NULL, 0, y0);
+}
+
+// Make rows of stage up to last_row available in its ring. Rows are produced by blocks that do not wrap
+// around the ring, so they are written with constant stride
+static void homv_chain_pull(const homv_chain *chain, size_t index, ssize_t last_row) {
+  homv_chain_stage *stage = &chain->stages[index];
+  ssize_t channels = chain->channels;
+  if (last_row >= chain->height) {
+    last_row = chain->height - 1;
+  }
+
+  while (stage->produced <= last_row) {
+    ssize_t y0 = stage->produced;
+    ssize_t y1 = last_row + 1;
+    if (y1 > y0 + HOMV_CHAIN_BLOCK_ROWS) {
+      y1 = y0 + HOMV_CHAIN_BLOCK_ROWS;
+    }
+    if (y1 > (y0 / stage->capacity + 1) * stage->capacity) {
+      y1 = (y0 / stage->capacity + 1) * stage->capacity;
+    }
+    homv_chain_produce(chain, index, y0, y1, homv_chain_row(stage, y0) + stage->padding * channels,
+                       stage->row_size);
+
+    for (ssize_t y = y0; y < y1; y++) {
+      uint8_t *row = homv_chain_row(stage, y) + stage->padding * channels;
+      for (ssize_t x = 1; x <= stage->padding; x++) {
+        memcpy(row - x * channels, row + x * channels, channels);
+        memcpy(row + (chain->width - 1 + x) * channels, row + (chain->width - 1 - x) * channels, channels);
+      }
+    }
+    stage->produced = y1;
+  }
+}
+
+static void homv_chain_into(homv_strategy strategy, const homv_input *input, const homv_matrix *matrices,
+                            size_t count, uint8_t *output, size_t output_stride) {
+  homv_output single = {output, (ssize_t)output_stride, HOMV_TYPE_U8, NULL};
+  if (count == 1) {
+    homv_convolve_into(strategy, input, matrices[0], &single);
+    return;
+  }
+
+  homv_plan_chain *plans = homv_plan_chain_create(matrices, count);
+  if (plans->count == 1) {
+    homv_convolve_into(strategy, input, *plans->matrices[0], &single);
+    homv_plan_chain_free(plans);
+    return;
+  }
+  count = plans->count;
+  const uint8_t *image_input = input->image;
+  ssize_t width = input->width;
+  ssize_t height = input->height;
+  ssize_t channels = input->channels;
+
+#pragma omp parallel if (strategy != HOMV_STRATEGY_SEQ)
+  {
+    ssize_t strips = omp_get_num_threads();
+    ssize_t strip = omp_get_thread_num();
+    ssize_t strip_y0 = homv_split(height, strips, strip);
+    ssize_t strip_y1 = homv_split(height, strips, strip + 1);
+
+    // Strip recomputes rows of earlier stages that kernels of later stages read above it
+    homv_chain_stage *stages = calloc(count + 1, sizeof(homv_chain_stage));
+    ssize_t halo = 0;
+    for (size_t index = count + 1; index-- > 0;) {
+      homv_chain_stage *stage = &stages[index];
+      stage->plan = index > 0 ? plans->plans[index - 1] : NULL;
+      stage->produced = strip_y0 - halo > 0 ? strip_y0 - halo : 0;
+      if (index < count) {
+        ssize_t next_size = (ssize_t)plans->plans[index]->matrix.size;
+        stage->padding = next_size / 2;
+        stage->capacity = HOMV_CHAIN_BLOCK_ROWS + next_size - 1;
+        stage->row_size = (width + 2 * stage->padding) * channels;
+        stage->ring = malloc(stage->capacity * stage->row_size);
+      }
+      if (index > 0) {
+        halo += (ssize_t)stage->plan->matrix.size / 2;
+      }
+    }
+
+    homv_chain chain = {image_input, width, height, channels, stages};
+    for (ssize_t y = strip_y0; y < strip_y1; y += HOMV_CHAIN_BLOCK_ROWS) {
+      ssize_t y1 = y + HOMV_CHAIN_BLOCK_ROWS < strip_y1 ? y + HOMV_CHAIN_BLOCK_ROWS : strip_y1;
+      homv_chain_produce(&chain, count, y, y1, output + y * output_stride, output_stride);
+    }
+
+    for (size_t index = 0; index < count; index++) {
+      free(stages[index].ring);
+    }
+    free(stages);
+  }
+
+  homv_plan_chain_free(plans);
+}
+
+typedef struct {
+  homv_strategy strategy;
+  const homv_matrix *matrices;
+  size_t count;
+} homv_alpha_chain;
+
+static void homv_alpha_chain_into(const homv_input *input, uint8_t *output, size_t output_stride,
+                                  const void *context) {
+  const homv_alpha_chain *chain = context;
+  homv_chain_into(chain->strategy, input, chain->matrices, chain->count, output, output_stride);
+}
+
+bool homv_apply_chain_into(homv_strategy strategy, const uint8_t *image_input, int width, int height, int channels,
+                           const homv_matrix *matrices, size_t count, uint8_t *output, size_t output_stride) {
+  if (!homv_check_kernels(matrices, count, width, height)) {
+    return false;
+  }
+  homv_input input = {image_input, width, height, channels, 0, HOMV_TYPE_U8};
+  if (homv_alpha_separate(channels)) {
+    homv_alpha_chain chain = {strategy, matrices, count};
+    homv_alpha_run(&input, output, output_stride, strategy != HOMV_STRATEGY_SEQ, homv_alpha_chain_into, &chain);
+    return true;
+  }
+  homv_chain_into(strategy, &input, matrices, count, output, output_stride);
+  return true;
+}
+
+uint8_t *homv_apply_chain(homv_strategy strategy, const uint8_t *image_input, int width, int height, int channels,
+                          const homv_matrix *matrices, size_t count) {
+  size_t output_stride = (size_t)width * channels;
+  uint8_t *output = malloc(height * output_stride);
+  if (!homv_apply_chain_into(strategy, image_input, width, height, channels, matrices, count, output,
+                             output_stride)) {
+    free(output);
+    return NULL;
+  }
+  return output;
+}
+
+// Output rows computed with every kernel of fan-out before next rows, so their input rows are still in cache
+#define HOMV_FANOUT_BLOCK_ROWS 16
+
+bool homv_apply_fanout_into(homv_strategy strategy, const uint8_t *image_input, int width, int height, int channels,
+                            const homv_matrix *matrices, size_t count, uint8_t *const *outputs, size_t output_stride) {
+  if (!homv_check_kernels(matrices, count, width, height)) {
+    return false;
+  }
+  homv_input input = {image_input, width, height, channels, 0, HOMV_TYPE_U8};
+  // Alpha is handled on whole images, so every kernel makes its own sweep
+  if (homv_alpha_separate(channels)) {
+    for (size_t i = 0; i < count; i++) {
+      homv_apply_into(strategy, image_input, width, height, channels, matrices[i], outputs[i], output_stride);
+    }
+    return true;
+  }
+  homv_plan **plans = malloc(count * sizeof(homv_plan *));
+  for (size_t i = 0; i < count; i++) {
+    plans[i] = homv_plan_create(matrices[i]);
+    // Recursive filter needs whole columns, so it makes its own sweep
+    if (plans[i]->kind == HOMV_PLAN_RECURSIVE) {
+      homv_iir_gauss(image_input, HOMV_TYPE_U8, 0, outputs[i], HOMV_TYPE_U8, output_stride, NULL, width, height,
+                     channels, matrices[i].sigma, strategy != HOMV_STRATEGY_SEQ);
+    }
+  }
+
+#pragma omp parallel if (strategy != HOMV_STRATEGY_SEQ)
+  {
+    ssize_t strips = omp_get_num_threads();
+    ssize_t strip = omp_get_thread_num();
+    ssize_t strip_y1 = homv_split(height, strips, strip + 1);
+    for (ssize_t y = homv_split(height, strips, strip); y < strip_y1; y += HOMV_FANOUT_BLOCK_ROWS) {
+      ssize_t y1 = y + HOMV_FANOUT_BLOCK_ROWS < strip_y1 ? y + HOMV_FANOUT_BLOCK_ROWS : strip_y1;
+      for (size_t i = 0; i < count; i++) {
+        if (plans[i]->kind != HOMV_PLAN_RECURSIVE) {
+          homv_output output = {outputs[i], (ssize_t)output_stride, HOMV_TYPE_U8, NULL};
+          homv_convolve_area(&input, &output, plans[i], 0, y, width, y1);
         }
       }
     }
   }
 
-  return (uint8_t *)output;
+  for (size_t i = 0; i < count; i++) {
+    homv_plan_free(plans[i]);
+  }
+  free(plans);
+  return true;
+}
+
+bool homv_normalize = false;
+
+homv_type homv_type_parse(const char *name) {
+  static const char *const names[HOMV_TYPE_MAX] = {
+      [HOMV_TYPE_U8] = "u8", [HOMV_TYPE_U16] = "u16", [HOMV_TYPE_I16] = "i16", [HOMV_TYPE_F32] = "f32"};
+  for (homv_type type = HOMV_TYPE_U8; type < HOMV_TYPE_MAX; type++) {
+    if (strcmp(name, names[type]) == 0) {
+      return type;
+    }
+  }
+  return HOMV_TYPE_MAX;
+}
+
+// Float rows of stage, count values each, are mapped from range[0]..range[1] to 0..255 and stored to 8-bit output.
+// Values of flat image are all 0
+static void homv_normalize_rows(homv_strategy strategy, float *stage, size_t count, int height, const float range[2],
+                                uint8_t *output, size_t output_stride) {
+  float scale = range[1] > range[0] ? 255 / (range[1] - range[0]) : 0;
+  float offset = -range[0] * scale;
+
+  ssize_t y = 0;
+#pragma omp parallel for if (strategy != HOMV_STRATEGY_SEQ) private(y)
+  for (y = 0; y < height; y++) {
+    float *row = stage + y * count;
+    for (size_t i = 0; i < count; i++) {
+      row[i] = row[i] * scale + offset;
+    }
+    homv_simd->store_u8(output + y * output_stride, row, count);
+  }
+}
+
+bool homv_apply_typed_into(homv_strategy strategy, homv_type input_type, const void *image_input, int width,
+                           int height, int channels, const homv_matrix *matrices, size_t count, homv_type output_type,
+                           void *output, size_t output_stride) {
+  if (homv_normalize && output_type != HOMV_TYPE_U8) {
+    fprintf(stderr, "Only 8-bit output can be normalized\n");
+    return false;
+  }
+  bool normalize = homv_normalize;
+  if (input_type == HOMV_TYPE_U8 && output_type == HOMV_TYPE_U8 && !normalize) {
+    return homv_apply_chain_into(strategy, image_input, width, height, channels, matrices, count, output,
+                                 output_stride);
+  }
+  if (!homv_check_kernels(matrices, count, width, height)) {
+    return false;
+  }
+
+  // Kernels but the last write to one of two float intermediate images in turn. Normalized output is written
+  // by the last kernel to float image too, bounds of its values are found while they are stored. Only the last
+  // kernel of normalized 8-bit image needs floats, earlier ones run as 8-bit chain
+  size_t stage_stride = (size_t)width * channels * sizeof(float);
+  uint8_t *stages[2] = {NULL, NULL};
+  float range[2] = {INFINITY, -INFINITY};
+  homv_input input = {image_input, width, height, channels, 0, input_type};
+  uint8_t *chained = NULL;
+  size_t first = 0;
+  if (normalize && input_type == HOMV_TYPE_U8 && count > 1) {
+    chained = homv_pool_alloc((size_t)height * width * channels);
+    homv_chain_into(strategy, &input, matrices, count - 1, chained, (size_t)width * channels);
+    input.image = chained;
+    first = count - 1;
+  }
+  for (size_t i = first; i < count; i++) {
+    homv_output stage = {output, (ssize_t)output_stride, output_type, NULL};
+    if (i + 1 < count || normalize) {
+      if (!stages[i % 2]) {
+        stages[i % 2] = homv_pool_alloc(height * stage_stride);
+      }
+      stage = (homv_output){stages[i % 2], (ssize_t)stage_stride, HOMV_TYPE_F32, i + 1 < count ? NULL : range};
+    }
+    homv_convolve_into(strategy, &input, matrices[i], &stage);
+    input.image = stage.image;
+    input.type = HOMV_TYPE_F32;
+  }
+
+  if (normalize && count > 0) {
+    homv_normalize_rows(strategy, (float *)stages[(count - 1) % 2], (size_t)width * channels, height, range, output,
+                        output_stride);
+  }
+  homv_pool_free(stages[0]);
+  homv_pool_free(stages[1]);
+  homv_pool_free(chained);
+  return true;
+}
+
+#define HOMV_PADDED_INPUT(image_input)                                                                                 \
+  {image_input, width, height, channels, (ssize_t)matrix_input.size / 2, HOMV_TYPE_U8}
+
+uint8_t *homv_apply_seq(const uint8_t *image_input, int width, int height, int channels, homv_matrix matrix_input) {
+  homv_input input = HOMV_PADDED_INPUT(image_input);
+  return homv_run(HOMV_STRATEGY_SEQ, &input, matrix_input);
+}
+
+uint8_t *homv_apply_parallel_rows(const uint8_t *image_input, int width, int height, int channels,
+                                  homv_matrix matrix_input) {
+  homv_input input = HOMV_PADDED_INPUT(image_input);
+  return homv_run(HOMV_STRATEGY_ROWS, &input, matrix_input);
+}
+
+uint8_t *homv_apply_parallel_cols(const uint8_t *image_input, int width, int height, int channels,
+                                  homv_matrix matrix_input) {
+  homv_input input = HOMV_PADDED_INPUT(image_input);
+  return homv_run(HOMV_STRATEGY_COLS, &input, matrix_input);
+}
+
+uint8_t *homv_apply_parallel_pixels(const uint8_t *image_input, int width, int height, int channels,
+                                    homv_matrix matrix_input) {
+  homv_input input = HOMV_PADDED_INPUT(image_input);
+  return homv_run(HOMV_STRATEGY_PIXELS, &input, matrix_input);
+}
+
+// global variables for type compability
+uint8_t *homv_apply_parallel_area(const uint8_t *image_input, int width, int height, int channels,
+                                  homv_matrix matrix_input) {
+  homv_input input = HOMV_PADDED_INPUT(image_input);
+  return homv_run(HOMV_STRATEGY_AREA, &input, matrix_input);
+}
+
+uint8_t *homv_apply_fft(const uint8_t *image_input, int width, int height, int channels, homv_matrix matrix_input) {
+  homv_input input = HOMV_PADDED_INPUT(image_input);
+  return homv_run(HOMV_STRATEGY_FFT, &input, matrix_input);
 }
 
 // Resize image by reflecting edges of images
@@ -225,6 +1597,10 @@ uint8_t *homv_reflect_image(uint8_t *old_image, int width, int height, int chann
     fprintf(stderr, "Kernel size must be odd number\n");
     return NULL;
   }
+  homv_matrix kernel = {.size = kernel_size};
+  if (!homv_check_kernels(&kernel, 1, width, height)) {
+    return NULL;
+  }
 
   ssize_t new_width = (ssize_t)(width + (kernel_size - 1));
   ssize_t new_heigth = (ssize_t)(height + (kernel_size - 1));
@@ -241,30 +1617,20 @@ uint8_t *homv_reflect_image(uint8_t *old_image, int width, int height, int chann
   // [( 2 -1) ( 2 0) ( 2 1) ( 2 2)]
   // if coordinate below zero we just multiply by -1 for reflected index (-1 -1) -> (1 1)
   // if coordinate above max coordinate of initial image we must subtract double difference (2 2) -> (0 0)
-  for (ssize_t col = -(kernel_size / 2); col < (ssize_t)(width + (kernel_size / 2)); col++) {
-    for (ssize_t row = -(kernel_size / 2); row < (ssize_t)(height + kernel_size / 2); row++) {
-      for (ssize_t color = 0; color < channels; color++) {
-        ssize_t reflected_col;
-        if (col < 0) {
-          reflected_col = -col;
-        } else if (col < width) {
-          reflected_col = col;
-        } else {
-          reflected_col = 2 * width - col - 2;
-        }
-
-        ssize_t reflected_row;
-        if (row < 0) {
-          reflected_row = -row;
-        } else if (row < height) {
-          reflected_row = row;
-        } else {
-          reflected_row = 2 * height - row - 2;
-        }
+  // Padded rows are written one by one: interior of row is copied from reflected row as is,
+  // only kernel_size / 2 pixels on each side are reflected
+  ssize_t radius = (ssize_t)kernel_size / 2;
+  ssize_t row_size = (ssize_t)width * channels;
+  ssize_t row = 0;
+#pragma omp parallel for private(row)
+  for (row = 0; row < new_heigth; row++) {
+    const uint8_t *old_row = old_image + homv_reflect_index(row - radius, height) * row_size;
+    uint8_t *new_row = new_image + row * new_width * channels;
 
-        new_image[(row + kernel_size / 2) * new_width * channels + (col + kernel_size / 2) * channels + color] =
-            old_image[reflected_row * width * channels + reflected_col * channels + color];
-      }
+    memcpy(new_row + radius * channels, old_row, row_size);
+    for (ssize_t col = 0; col < radius; col++) {
+      memcpy(new_row + (radius - 1 - col) * channels, old_row + (col + 1) * channels, channels);
+      memcpy(new_row + (radius + width + col) * channels, old_row + (width - 2 - col) * channels, channels);
     }
   }
 
@@ -280,10 +1646,12 @@ pthread_t readers[READERS_COUNT], workers[WORKERS_COUNT], writers[WRITERS_COUNT]
 queue_t *queue_readers;
 queue_t *queue_workers;
 queue_t *queue_writers;
-homv_apply_type *method;
-homv_matrix matrix;
+homv_strategy strategy;
+const homv_matrix *matrices;
+size_t matrices_count;
 size_t read_count, work_count;
 bool read_ready = false, write_ready = false;
+bool homv_gray = false;
 
 typedef struct {
   uint8_t *image;
@@ -306,7 +1674,10 @@ void *thread_func_reader(void *params_input) {
     pthread_mutex_unlock(&queue_mutex);
 
     int width, height, channels;
-    uint8_t *img = stbi_load(filename, &width, &height, &channels, 0);
+    uint8_t *img = stbi_load(filename, &width, &height, &channels, homv_gray ? 1 : 0);
+    if (homv_gray) {
+      channels = 1;
+    }
 
     if (!img) {
       printf("Failed to load image: %s\n", filename);
@@ -347,13 +1718,25 @@ void *thread_func_worker(void *params_input) {
     node_image_data *data = queue_pop(queue_workers);
     pthread_mutex_unlock(&queue_mutex);
 
-    uint8_t *image_reflected = homv_reflect_image(data->image, data->width, data->height, data->channels, matrix.size);
-    uint8_t *output = method(image_reflected, data->width, data->height, data->channels, matrix);
-    printf("Convolution applied to %s\n", data->filename);
+    size_t output_stride = (size_t)data->width * data->channels;
+    uint8_t *output = homv_pool_alloc(data->height * output_stride);
+    bool applied = homv_apply_chain_into(strategy, data->image, data->width, data->height, data->channels, matrices,
+                                         matrices_count, output, output_stride);
+    stbi_image_free(data->image);
+    if (applied) {
+      printf("Convolution applied to %s\n", data->filename);
+      data->image = output;
+    } else {
+      fprintf(stderr, "Image skipped: %s\n", data->filename);
+      homv_pool_free(output);
+      free(data);
+      data = NULL;
+    }
 
-    data->image = output;
     pthread_mutex_lock(&queue_mutex);
-    queue_add(queue_writers, (void *)data);
+    if (data) {
+      queue_add(queue_writers, (void *)data);
+    }
     if (queue_workers->size == 0) {
       write_ready = true;
     }
@@ -392,13 +1775,18 @@ void *thread_func_writer(void *params_input) {
       printf("Failed to save image\n");
       printf("%s, %d, %d, %d", newfilename, data->width, data->height, data->channels);
     }
+
+    free(newfilename);
+    homv_pool_free(data->image);
+    free(data);
   }
 }
 
-void queue_exec(char *filenames[FILE_NAMES_MAX_COUNT], size_t filenames_count, homv_apply_type method_input,
-                homv_matrix matrix_input) {
-  method = method_input;
-  matrix = matrix_input;
+void queue_exec(char *filenames[FILE_NAMES_MAX_COUNT], size_t filenames_count, homv_strategy strategy_input,
+                const homv_matrix *matrices_input, size_t matrices_count_input) {
+  strategy = strategy_input;
+  matrices = matrices_input;
+  matrices_count = matrices_count_input;
   read_count = filenames_count;
   work_count = 0;
 
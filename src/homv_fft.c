@@ -0,0 +1,183 @@
+#include "homv_fft.h"
+
+#include <complex.h>
+#include <math.h>
+#include <omp.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "homv_core.h"
+
+// Tiles above 256 x 256 complex values do not fit in L2 cache and are slower per pixel
+#define HOMV_FFT_MIN_TILE 16
+#define HOMV_FFT_MAX_TILE 256
+// Cost of radix-2 butterfly (complex multiply and two adds with strided memory access)
+// relative to one multiply-add of direct path, measured with benchmark crossover
+#define HOMV_FFT_BUTTERFLY_COST 10
+
+typedef double complex homv_complex;
+
+// Radix-2 in-place FFT of size n (power of two), twiddles[k] = exp(-2 pi i k / n) for k < n / 2
+static void homv_fft_1d(homv_complex *data, size_t n, const homv_complex *twiddles, bool inverse) {
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      homv_complex tmp = data[i];
+      data[i] = data[j];
+      data[j] = tmp;
+    }
+  }
+
+  for (size_t len = 2; len <= n; len <<= 1) {
+    size_t step = n / len;
+    for (size_t start = 0; start < n; start += len) {
+      for (size_t k = 0; k < len / 2; k++) {
+        homv_complex w = inverse ? conj(twiddles[k * step]) : twiddles[k * step];
+        homv_complex even = data[start + k];
+        homv_complex odd = data[start + k + len / 2] * w;
+        data[start + k] = even + odd;
+        data[start + k + len / 2] = even - odd;
+      }
+    }
+  }
+}
+
+// 2D FFT of n x n tile: rows in place, then columns through column buffer of n values
+static void homv_fft_2d(homv_complex *tile, homv_complex *column, size_t n, const homv_complex *twiddles,
+                        bool inverse) {
+  for (size_t row = 0; row < n; row++) {
+    homv_fft_1d(tile + row * n, n, twiddles, inverse);
+  }
+
+  for (size_t col = 0; col < n; col++) {
+    for (size_t row = 0; row < n; row++) {
+      column[row] = tile[row * n + col];
+    }
+    homv_fft_1d(column, n, twiddles, inverse);
+    for (size_t row = 0; row < n; row++) {
+      tile[row * n + col] = column[row];
+    }
+  }
+}
+
+// Two forward and one inverse 2D FFT per two real planes, plus spectrum multiplication
+double homv_fft_cost(size_t kernel_size, size_t tile_size) {
+  if (tile_size < kernel_size) {
+    return INFINITY;
+  }
+
+  double valid = (double)(tile_size - kernel_size + 1);
+  double points = (double)tile_size * tile_size;
+  double butterflies = points / 2 * log2(points);
+  return (2 * butterflies * HOMV_FFT_BUTTERFLY_COST + points) / 2 / (valid * valid);
+}
+
+size_t homv_fft_best_tile(size_t kernel_size, int width, int height) {
+  size_t padded = (size_t)(width > height ? width : height) + kernel_size - 1;
+  size_t best = 0;
+  for (size_t tile = HOMV_FFT_MIN_TILE; tile <= HOMV_FFT_MAX_TILE; tile <<= 1) {
+    if (tile >= kernel_size && (best == 0 || homv_fft_cost(kernel_size, tile) < homv_fft_cost(kernel_size, best))) {
+      best = tile;
+    }
+    // Larger tiles only add zeros
+    if (tile >= padded) {
+      break;
+    }
+  }
+
+  return best;
+}
+
+void homv_fft_convolve(const uint8_t *image_input, uint8_t *output, size_t output_stride, int width, int height,
+                       int channels, homv_matrix matrix_input, size_t tile_size, bool padded) {
+  ssize_t n = (ssize_t)tile_size;
+  ssize_t mx_size = (ssize_t)matrix_input.size;
+  ssize_t valid = n - mx_size + 1;
+  ssize_t radius = mx_size / 2;
+  ssize_t input_width = width + mx_size - 1;
+  ssize_t input_height = height + mx_size - 1;
+
+  homv_complex *twiddles = malloc(n / 2 * sizeof(homv_complex));
+  for (ssize_t k = 0; k < n / 2; k++) {
+    twiddles[k] = cexp(-2 * M_PI * I * k / n);
+  }
+
+  // Output is correlation of image with kernel, so tile spectrum is multiplied by conjugated kernel spectrum
+  homv_complex *kernel = calloc(n * n, sizeof(homv_complex));
+  homv_complex *column = malloc(n * sizeof(homv_complex));
+  for (ssize_t mx_y = 0; mx_y < mx_size; mx_y++) {
+    for (ssize_t mx_x = 0; mx_x < mx_size; mx_x++) {
+      kernel[mx_y * n + mx_x] = matrix_input.values[mx_y * mx_size + mx_x];
+    }
+  }
+  homv_fft_2d(kernel, column, n, twiddles, false);
+  for (ssize_t i = 0; i < n * n; i++) {
+    kernel[i] = conj(kernel[i]) / (double)(n * n);
+  }
+  free(column);
+
+  // Real planes are convolved in pairs: one goes to real part and another to imaginary part of tile.
+  // Kernel is real, so both convolutions stay separated in real and imaginary parts of result
+  ssize_t tiles_x = (width + valid - 1) / valid;
+  ssize_t tiles_y = (height + valid - 1) / valid;
+  ssize_t pairs = (channels + 1) / 2;
+  ssize_t job = 0;
+#pragma omp parallel
+  {
+    homv_complex *tile = malloc(n * n * sizeof(homv_complex));
+    homv_complex *tile_column = malloc(n * sizeof(homv_complex));
+
+#pragma omp for schedule(dynamic) private(job)
+    for (job = 0; job < tiles_x * tiles_y * pairs; job++) {
+      ssize_t pair = job % pairs;
+      ssize_t origin_x = (job / pairs) % tiles_x * valid;
+      ssize_t origin_y = (job / pairs) / tiles_x * valid;
+      ssize_t color = pair * 2;
+      bool has_second = color + 1 < channels;
+
+      for (ssize_t y = 0; y < n; y++) {
+        for (ssize_t x = 0; x < n; x++) {
+          ssize_t in_x = origin_x + x;
+          ssize_t in_y = origin_y + y;
+          if (in_x >= input_width || in_y >= input_height) {
+            tile[y * n + x] = 0;
+            continue;
+          }
+          const uint8_t *pixel =
+              padded ? image_input + (in_y * input_width + in_x) * channels + color
+                     : image_input + (homv_reflect_index(in_y - radius, height) * width +
+                                      homv_reflect_index(in_x - radius, width)) *
+                                         channels +
+                           color;
+          tile[y * n + x] = pixel[0] + (has_second ? pixel[1] * I : 0);
+        }
+      }
+
+      homv_fft_2d(tile, tile_column, n, twiddles, false);
+      for (ssize_t i = 0; i < n * n; i++) {
+        tile[i] *= kernel[i];
+      }
+      homv_fft_2d(tile, tile_column, n, twiddles, true);
+
+      for (ssize_t y = 0; y < valid && origin_y + y < height; y++) {
+        for (ssize_t x = 0; x < valid && origin_x + x < width; x++) {
+          uint8_t *pixel = output + (origin_y + y) * output_stride + (origin_x + x) * channels + color;
+          pixel[0] = homv_pixel_from_double(creal(tile[y * n + x]));
+          if (has_second) {
+            pixel[1] = homv_pixel_from_double(cimag(tile[y * n + x]));
+          }
+        }
+      }
+    }
+
+    free(tile);
+    free(tile_column);
+  }
+
+  free(twiddles);
+  free(kernel);
+}
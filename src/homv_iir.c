@@ -0,0 +1,286 @@
+#include "homv_iir.h"
+
+#include <math.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "homv_core.h"
+#include "homv_simd.h"
+
+// Floats filtered at once by one thread: tile and extended lanes of a chunk stay in L2 cache between
+// causal and anticausal passes. Multiple of 1, 3 and 4 channels and of 16 floats of AVX-512 register
+#define HOMV_IIR_LANES 48
+// Pixels of a row transposed at once, so writes to tile rows stay in few cache lines
+#define HOMV_IIR_BLOCK 32
+// Rows of filter state after extended lanes: 3 last rows of causal and anticausal sections and their steady rows
+#define HOMV_IIR_STATE_ROWS 16
+
+// Deriche 4th order approximation of Gaussian, accurate to a level of 8-bit output: sum of two sections
+// e^(-b t) * (a * cos(w t) + c * sin(w t)) of distance t in sigmas, {a, c, b, w} of each
+static const double homv_iir_deriche[2][4] = {{1.68, 3.735, 1.783, 0.6318}, {-0.6803, -0.2598, 1.723, 1.997}};
+
+// Sections are applied causally from distance 0 and anticausally from distance 1. coefs[0] are iir_f32
+// coefficients of causal step for x[n], x[n - 1], y[n - 1], y[n - 2] of each section, coefs[1] of anticausal
+// step for x[n + 1], x[n + 2], y[n + 1], y[n + 2]. gains are outputs of sections for constant signal 1,
+// causal then anticausal, all together they are 1
+static void homv_iir_coefficients(double sigma, float coefs[2][8], float gains[4]) {
+  double values[2][8];
+  double total = 0;
+  for (int k = 0; k < 2; k++) {
+    double a = homv_iir_deriche[k][0], c = homv_iir_deriche[k][1];
+    double r = exp(-homv_iir_deriche[k][2] / sigma), w = homv_iir_deriche[k][3] / sigma;
+    double d1 = 2 * r * cos(w), d2 = -r * r;
+    double n1 = r * (c * sin(w) - a * cos(w));
+    double causal[4] = {a, n1, d1, d2}, anticausal[4] = {n1 + a * d1, a * d2, d1, d2};
+    memcpy(values[0] + 4 * k, causal, sizeof(causal));
+    memcpy(values[1] + 4 * k, anticausal, sizeof(anticausal));
+    total += (a + n1 + n1 + a * d1 + a * d2) / (1 - d1 - d2);
+  }
+  for (int side = 0; side < 2; side++) {
+    for (int k = 0; k < 2; k++) {
+      const double *section = values[side] + 4 * k;
+      gains[2 * side + k] = (float)((section[0] + section[1]) / total / (1 - section[2] - section[3]));
+      coefs[side][4 * k] = (float)(section[0] / total);
+      coefs[side][4 * k + 1] = (float)(section[1] / total);
+      coefs[side][4 * k + 2] = (float)section[2];
+      coefs[side][4 * k + 3] = (float)section[3];
+    }
+  }
+}
+
+// Filter count lanes of n source rows, src_stride floats apart. Source is extended by pad reflected rows
+// on both sides, so filter state is settled when it reaches first and last rows. ext holds 2 blocks of
+// n + 2 * pad rows count floats each and HOMV_IIR_STATE_ROWS more. Causal pass copies extended source to first
+// block, so anticausal pass reads it contiguously, and stores causal sums to second one. Anticausal sums are added
+// there backwards and first filtered row is returned. Sections keep their 3 last rows in state rows and start
+// from steady state of constant signal
+static const float *homv_iir_lanes(const float *src, size_t src_stride, float *ext, ssize_t n, ssize_t pad,
+                                   size_t count, float coefs[2][8], const float gains[4]) {
+  ssize_t total = n + 2 * pad;
+  float *source = ext, *sums = ext + total * count;
+  float *state = ext + 2 * total * count;
+  float *steady = state + 12 * count;
+  const float *edges[2] = {src + homv_reflect_index(-pad, n) * src_stride,
+                           src + homv_reflect_index(n + pad - 1, n) * src_stride};
+  for (int k = 0; k < 4; k++) {
+    for (size_t i = 0; i < count; i++) {
+      steady[k * count + i] = gains[k] * edges[k / 2][i];
+    }
+  }
+
+  for (int side = 0; side < 2; side++) {
+    const float *x1 = edges[side], *x2 = edges[side];
+    float *ring = state + 6 * side * count;
+    for (ssize_t step = 0; step < total; step++) {
+      ssize_t k = side ? total - 1 - step : step;
+      float *rows[2] = {ring + step % 3 * count, ring + (3 + step % 3) * count};
+      const float *prev[4];
+      for (int section = 0; section < 2; section++) {
+        const float *init = steady + (2 * side + section) * count;
+        prev[2 * section] = step >= 1 ? ring + (3 * section + (step + 2) % 3) * count : init;
+        prev[2 * section + 1] = step >= 2 ? ring + (3 * section + (step + 1) % 3) * count : init;
+      }
+      float *x = source + k * count, *dst = sums + k * count;
+      // Causal step reads x[n] and x[n - 1], anticausal one x[n + 1] and x[n + 2]
+      if (side) {
+        homv_simd->iir_f32(dst, dst, rows, x1, x2, prev, coefs[1], count);
+      } else {
+        memcpy(x, src + homv_reflect_index(k - pad, n) * src_stride, count * sizeof(float));
+        homv_simd->iir_f32(dst, NULL, rows, x, x1, prev, coefs[0], count);
+      }
+      x2 = x1;
+      x1 = x;
+    }
+  }
+  return sums + pad * count;
+}
+
+static inline ssize_t homv_iir_split(ssize_t total, ssize_t parts, ssize_t index) { return total * index / parts; }
+
+// Grow-only buffers like scratch buffers of core.c. Plane is shared by threads of one call,
+// tile and ext are private to every thread
+typedef enum { HOMV_IIR_PLANE = 0, HOMV_IIR_TILE_BUFFER, HOMV_IIR_EXT, HOMV_IIR_BUFFERS } homv_iir_buffer;
+
+static _Thread_local struct {
+  float *data;
+  size_t size;
+} homv_iir_buffers[HOMV_IIR_BUFFERS];
+
+static float *homv_iir_buffer_get(homv_iir_buffer buffer, size_t count) {
+  if (homv_iir_buffers[buffer].size < count) {
+    free(homv_iir_buffers[buffer].data);
+    homv_iir_buffers[buffer].data = malloc(count * sizeof(float));
+    homv_iir_buffers[buffer].size = count;
+  }
+  return homv_iir_buffers[buffer].data;
+}
+
+// Pixel x of image rows y_chunk.. is written to row x of tile. Channel counts and value types are constants in
+// specialized copies, so inner loop is unrolled
+__attribute__((always_inline)) static inline void homv_iir_gather(float *tile, const uint8_t *origin,
+                                                                        size_t input_stride, ssize_t y_chunk,
+                                                                        ssize_t rows, ssize_t width, int channels,
+                                                                        homv_type type) {
+  size_t count = rows * channels;
+  for (ssize_t x_block = 0; x_block < width; x_block += HOMV_IIR_BLOCK) {
+    ssize_t x_end = x_block + HOMV_IIR_BLOCK < width ? x_block + HOMV_IIR_BLOCK : width;
+    for (ssize_t y = 0; y < rows; y++) {
+      size_t src = (y_chunk + y) * input_stride;
+      float *dst = tile + y * channels;
+      for (ssize_t x = x_block; x < x_end; x++) {
+        for (int color = 0; color < channels; color++) {
+          size_t index = src + x * channels + color;
+          dst[x * count + color] = type == HOMV_TYPE_F32   ? ((const float *)origin)[index]
+                                   : type == HOMV_TYPE_U16 ? ((const uint16_t *)origin)[index]
+                                   : type == HOMV_TYPE_I16 ? ((const int16_t *)origin)[index]
+                                                           : origin[index];
+        }
+      }
+    }
+  }
+}
+
+// Row x of filtered tile goes back to pixel x of image rows y_chunk.. of plane
+__attribute__((always_inline)) static inline void homv_iir_scatter(float *plane, size_t plane_stride,
+                                                                         const float *tile, ssize_t y_chunk,
+                                                                         ssize_t rows, ssize_t width, int channels) {
+  size_t count = rows * channels;
+  for (ssize_t x_block = 0; x_block < width; x_block += HOMV_IIR_BLOCK) {
+    ssize_t x_end = x_block + HOMV_IIR_BLOCK < width ? x_block + HOMV_IIR_BLOCK : width;
+    for (ssize_t y = 0; y < rows; y++) {
+      float *dst = plane + (y_chunk + y) * plane_stride;
+      const float *src = tile + y * channels;
+      for (ssize_t x = x_block; x < x_end; x++) {
+        for (int color = 0; color < channels; color++) {
+          dst[x * channels + color] = src[x * count + color];
+        }
+      }
+    }
+  }
+}
+
+__attribute__((always_inline)) static inline void homv_iir_gather_channels(float *tile, const uint8_t *origin,
+                                                                                 size_t input_stride, ssize_t y_chunk,
+                                                                                 ssize_t rows, ssize_t width,
+                                                                                 int channels, homv_type type) {
+  switch (channels) {
+  case 1:
+    homv_iir_gather(tile, origin, input_stride, y_chunk, rows, width, 1, type);
+    break;
+  case 3:
+    homv_iir_gather(tile, origin, input_stride, y_chunk, rows, width, 3, type);
+    break;
+  case 4:
+    homv_iir_gather(tile, origin, input_stride, y_chunk, rows, width, 4, type);
+    break;
+  default:
+    homv_iir_gather(tile, origin, input_stride, y_chunk, rows, width, channels, type);
+  }
+}
+
+static void homv_iir_transpose_in(float *tile, const uint8_t *origin, size_t input_stride, ssize_t y_chunk,
+                                  ssize_t rows, ssize_t width, int channels, homv_type type) {
+  switch (type) {
+  case HOMV_TYPE_F32:
+    homv_iir_gather_channels(tile, origin, input_stride, y_chunk, rows, width, channels, HOMV_TYPE_F32);
+    break;
+  case HOMV_TYPE_U16:
+    homv_iir_gather_channels(tile, origin, input_stride, y_chunk, rows, width, channels, HOMV_TYPE_U16);
+    break;
+  case HOMV_TYPE_I16:
+    homv_iir_gather_channels(tile, origin, input_stride, y_chunk, rows, width, channels, HOMV_TYPE_I16);
+    break;
+  default:
+    homv_iir_gather_channels(tile, origin, input_stride, y_chunk, rows, width, channels, HOMV_TYPE_U8);
+  }
+}
+
+static void homv_iir_transpose_out(float *plane, size_t plane_stride, const float *tile, ssize_t y_chunk,
+                                   ssize_t rows, ssize_t width, int channels) {
+  switch (channels) {
+  case 1:
+    homv_iir_scatter(plane, plane_stride, tile, y_chunk, rows, width, 1);
+    break;
+  case 3:
+    homv_iir_scatter(plane, plane_stride, tile, y_chunk, rows, width, 3);
+    break;
+  case 4:
+    homv_iir_scatter(plane, plane_stride, tile, y_chunk, rows, width, 4);
+    break;
+  default:
+    homv_iir_scatter(plane, plane_stride, tile, y_chunk, rows, width, channels);
+  }
+}
+
+void homv_iir_gauss(const uint8_t *image_input, homv_type input_type, size_t padding, uint8_t *output,
+                    homv_type output_type, size_t output_stride, float *range, int width, int height, int channels,
+                    double sigma, bool parallel) {
+  float coefs[2][8], gains[4];
+  homv_iir_coefficients(sigma, coefs, gains);
+
+  // Reflection mirrors only inner pixels, so extension is limited by image size
+  ssize_t radius = (ssize_t)ceil(3 * sigma);
+  ssize_t pad_x = radius < width ? radius : width - 1;
+  ssize_t pad_y = radius < height ? radius : height - 1;
+  size_t col_lanes = (size_t)width * channels;
+  size_t input_stride = (width + 2 * padding) * channels;
+  const uint8_t *origin = image_input + (padding * input_stride + padding * channels) * homv_type_size(input_type);
+  ssize_t chunk_rows = HOMV_IIR_LANES / channels;
+
+  // Image after pass along rows, rows of width * channels floats
+  float *plane = homv_iir_buffer_get(HOMV_IIR_PLANE, (size_t)height * col_lanes);
+
+#pragma omp parallel if (parallel)
+  {
+    ssize_t strips = omp_get_num_threads();
+    ssize_t strip = omp_get_thread_num();
+    ssize_t ext_rows = (width + 2 * pad_x > height + 2 * pad_y ? width + 2 * pad_x : height + 2 * pad_y);
+    float *tile = homv_iir_buffer_get(HOMV_IIR_TILE_BUFFER, (size_t)width * HOMV_IIR_LANES);
+    float *ext = homv_iir_buffer_get(HOMV_IIR_EXT, (size_t)(2 * ext_rows + HOMV_IIR_STATE_ROWS) * HOMV_IIR_LANES);
+    float bounds[2] = {INFINITY, -INFINITY};
+
+    // Pass along rows: chunk of image rows is transposed, so row x of tile holds pixel x of every row of chunk
+    ssize_t y_end = homv_iir_split(height, strips, strip + 1);
+    for (ssize_t y_chunk = homv_iir_split(height, strips, strip); y_chunk < y_end; y_chunk += chunk_rows) {
+      ssize_t rows = y_chunk + chunk_rows < y_end ? chunk_rows : y_end - y_chunk;
+      size_t count = rows * channels;
+      homv_iir_transpose_in(tile, origin, input_stride, y_chunk, rows, width, channels, input_type);
+      const float *filtered = homv_iir_lanes(tile, count, ext, width, pad_x, count, coefs, gains);
+      homv_iir_transpose_out(plane, col_lanes, filtered, y_chunk, rows, width, channels);
+    }
+#pragma omp barrier
+
+    // Pass along columns: lanes of chunk are neighbouring columns, filtered output is stored row by row
+    ssize_t lanes_end = homv_iir_split(width, strips, strip + 1) * channels;
+    for (ssize_t lane = homv_iir_split(width, strips, strip) * channels; lane < lanes_end; lane += HOMV_IIR_LANES) {
+      size_t count = lane + HOMV_IIR_LANES < lanes_end ? HOMV_IIR_LANES : lanes_end - lane;
+      const float *filtered_rows = homv_iir_lanes(plane + lane, col_lanes, ext, height, pad_y, count, coefs, gains);
+      for (ssize_t y = 0; y < height; y++) {
+        uint8_t *dst = output + y * output_stride + lane * homv_type_size(output_type);
+        const float *filtered = filtered_rows + y * count;
+        if (output_type == HOMV_TYPE_F32) {
+          memcpy(dst, filtered, count * sizeof(float));
+          if (range) {
+            homv_simd->range_f32(bounds, filtered, count);
+          }
+        } else if (output_type == HOMV_TYPE_I16) {
+          homv_simd->narrow_i16((int16_t *)dst, filtered, count);
+        } else if (output_type == HOMV_TYPE_U16) {
+          homv_simd->store_u16((uint16_t *)dst, filtered, count);
+        } else {
+          homv_simd->store_u8(dst, filtered, count);
+        }
+      }
+    }
+
+    if (range) {
+#pragma omp critical(homv_range)
+      {
+        range[0] = bounds[0] < range[0] ? bounds[0] : range[0];
+        range[1] = bounds[1] > range[1] ? bounds[1] : range[1];
+      }
+    }
+  }
+}
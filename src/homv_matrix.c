@@ -1,4 +1,5 @@
 #include "homv_matrix.h"
+#include <math.h>
 #include <stdio.h>
 
 homv_matrix *homv_mx_init(size_t size, double **input) {
@@ -10,6 +11,8 @@ homv_matrix *homv_mx_init(size_t size, double **input) {
   homv_matrix *result = malloc(sizeof(homv_matrix));
   result->size = size;
   result->values = calloc(size * size, sizeof(double));
+  result->sigma = 0;
+  result->gradient = HOMV_MX_GRADIENT_NONE;
 
   return result;
 }
@@ -32,3 +35,65 @@ homv_matrix *homv_mx_get_random_matrix(size_t size) {
 
   return result;
 }
+
+homv_matrix *homv_mx_get_box_matrix(size_t size) {
+  homv_matrix *result = homv_mx_init(size, NULL);
+
+  for (size_t i = 0; i < size * size; i++) {
+    result->values[i] = 1.0 / (double)(size * size);
+  }
+
+  return result;
+}
+
+homv_matrix *homv_mx_get_gauss_matrix(double sigma) {
+  size_t radius = (size_t)ceil(3 * sigma);
+  size_t size = 2 * radius + 1;
+  homv_matrix *result = homv_mx_init(size, NULL);
+  result->sigma = sigma;
+
+  double *samples = malloc(size * sizeof(double));
+  double sum = 0;
+  for (size_t i = 0; i < size; i++) {
+    double x = (double)i - (double)radius;
+    samples[i] = exp(-x * x / (2 * sigma * sigma));
+    sum += samples[i];
+  }
+  for (size_t y = 0; y < size; y++) {
+    for (size_t x = 0; x < size; x++) {
+      result->values[y * size + x] = samples[y] * samples[x] / (sum * sum);
+    }
+  }
+  free(samples);
+
+  return result;
+}
+
+homv_matrix *homv_mx_get_sobel_matrix(homv_mx_gradient gradient) {
+  static const double sobel[] = {-1, -2, -1, 0, 0, 0, 1, 2, 1};
+  homv_matrix *result = homv_mx_init(3, NULL);
+  result->gradient = gradient;
+  for (size_t i = 0; i < 9; i++) {
+    result->values[i] = sobel[i];
+  }
+
+  return result;
+}
+
+homv_matrix *homv_mx_convolve(const homv_matrix *a, const homv_matrix *b) {
+  size_t size = a->size + b->size - 1 + (a->size % 2 == 0 && b->size % 2 == 0);
+  homv_matrix *result = homv_mx_init(size, NULL);
+
+  for (size_t a_y = 0; a_y < a->size; a_y++) {
+    for (size_t a_x = 0; a_x < a->size; a_x++) {
+      double value = a->values[a_y * a->size + a_x];
+      for (size_t b_y = 0; b_y < b->size; b_y++) {
+        for (size_t b_x = 0; b_x < b->size; b_x++) {
+          result->values[(a_y + b_y) * size + a_x + b_x] += value * b->values[b_y * b->size + b_x];
+        }
+      }
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,58 @@
+#include "homv_npy.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Header of .npy file is padded with spaces and ends with newline, so data starts at multiple of this
+#define HOMV_NPY_ALIGN 64
+
+static bool homv_npy_data(FILE *file, int width, int height, int channels, homv_type type, const void *image) {
+  size_t size = (size_t)width * height * channels * homv_type_size(type);
+  return fwrite(image, 1, size, file) == size;
+}
+
+bool homv_npy_write(const char *filename, int width, int height, int channels, homv_type type, const void *image) {
+  static const char *const descrs[HOMV_TYPE_MAX] = {
+      [HOMV_TYPE_U8] = "u1", [HOMV_TYPE_U16] = "u2", [HOMV_TYPE_I16] = "i2", [HOMV_TYPE_F32] = "f4"};
+  uint16_t probe = 1;
+  char order = type == HOMV_TYPE_U8 ? '|' : *(const uint8_t *)&probe ? '<' : '>';
+
+  // Magic string, version, little-endian length of header and header itself: dictionary of Python literals
+  char header[HOMV_NPY_ALIGN * 2];
+  int dict_size = 0;
+  if (channels == 1) {
+    dict_size = snprintf(header + 10, sizeof(header) - 10,
+                         "{'descr': '%c%s', 'fortran_order': False, 'shape': (%d, %d), }", order, descrs[type], height,
+                         width);
+  } else {
+    dict_size = snprintf(header + 10, sizeof(header) - 10,
+                         "{'descr': '%c%s', 'fortran_order': False, 'shape': (%d, %d, %d), }", order, descrs[type],
+                         height, width, channels);
+  }
+  size_t total = (10 + dict_size + 1 + HOMV_NPY_ALIGN - 1) / HOMV_NPY_ALIGN * HOMV_NPY_ALIGN;
+  for (size_t i = 10 + dict_size; i < total - 1; i++) {
+    header[i] = ' ';
+  }
+  header[total - 1] = '\n';
+  memcpy(header, "\x93NUMPY\x01\x00", 8);
+  header[8] = (char)((total - 10) & 255);
+  header[9] = (char)((total - 10) >> 8);
+
+  FILE *file = fopen(filename, "wb");
+  bool written = file && fwrite(header, 1, total, file) == total &&
+                 homv_npy_data(file, width, height, channels, type, image);
+  if (file && fclose(file) != 0) {
+    written = false;
+  }
+  return written;
+}
+
+bool homv_raw_write(const char *filename, int width, int height, int channels, homv_type type, const void *image) {
+  FILE *file = fopen(filename, "wb");
+  bool written = file && homv_npy_data(file, width, height, channels, type, image);
+  if (file && fclose(file) != 0) {
+    written = false;
+  }
+  return written;
+}
@@ -0,0 +1,569 @@
+#include "homv_plan.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "homv_iir.h"
+
+// Relative error allowed when checking kernel properties
+#define HOMV_PLAN_EPS 1e-9
+// Jacobi SVD converges quadratically, kernels up to 31x31 need less than 10 sweeps
+#define HOMV_PLAN_SVD_SWEEPS 64
+// Largest common divisor of integer kernel coefficients that is searched for
+#define HOMV_PLAN_MAX_DIVISOR 1024
+// Sliding sums cost the same for any kernel size, but window sums along a row are a serial loop.
+// Measured against int16 blocks and separable passes, box plan wins from 7x7
+#define HOMV_PLAN_BOX_COST 13
+// Folds other than HOMV_FOLD_X keep sums of output row in memory and pass over it for every kernel row.
+// Measured against direct blocks, these passes cost about this much per kernel column
+#define HOMV_PLAN_ROW_FOLD_COST 2.5
+// Four recursive passes of two sections, 8 multiply-adds each, plus transposes of rows to SIMD lanes and back.
+// Measured against separable passes, recursive plan wins from sigma 5 (31x31 kernel)
+#define HOMV_PLAN_RECURSIVE_COST 60
+// 4 multiplies per output instead of 9, but transforms add 12 additions and pixels are deinterleaved to even and
+// odd ones. Measured against direct path, it wins only with scalar code, where multiply and add are separate
+#define HOMV_PLAN_WINOGRAD_SCALAR_COST 8
+#define HOMV_PLAN_WINOGRAD_COST 45
+// 12 additions of both Sobel derivatives in int16 lanes, then float square root of sum of squares
+#define HOMV_PLAN_GRADIENT_COST 8
+
+homv_plan_kind homv_plan_force = HOMV_PLAN_AUTO;
+double homv_svd_tolerance = 1e-3;
+bool homv_plan_compose = true;
+
+// Kernel is separable if it is outer product of column and row: M[y][x] = col[y] * row[x]
+// Largest by absolute value element is taken as pivot, its column and row give both vectors
+static bool homv_plan_factor_separable(homv_matrix mx, double *row, double *col) {
+  size_t size = mx.size;
+  size_t pivot = 0;
+  for (size_t i = 1; i < size * size; i++) {
+    if (fabs(mx.values[i]) > fabs(mx.values[pivot])) {
+      pivot = i;
+    }
+  }
+
+  double max = fabs(mx.values[pivot]);
+  if (max == 0) {
+    return false;
+  }
+
+  size_t pivot_x = pivot % size;
+  size_t pivot_y = pivot / size;
+  for (size_t i = 0; i < size; i++) {
+    col[i] = mx.values[i * size + pivot_x];
+    row[i] = mx.values[pivot_y * size + i] / mx.values[pivot];
+  }
+
+  for (size_t y = 0; y < size; y++) {
+    for (size_t x = 0; x < size; x++) {
+      if (fabs(mx.values[y * size + x] - col[y] * row[x]) > HOMV_PLAN_EPS * max) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// One-sided Jacobi SVD: columns of work = matrix * V are rotated until they are pairwise orthogonal,
+// then matrix = sum of (work column j) * (V column j)^T and singular values are norms of work columns.
+// Kernel rows are y, columns are x, so work column j is vertical and V column j is horizontal 1D kernel.
+// Terms are written to rows and cols sorted by singular value descending, returns count of kept terms
+static size_t homv_plan_factor_svd(homv_matrix mx, double *rows, double *cols) {
+  size_t size = mx.size;
+  double *work = malloc(size * size * sizeof(double));
+  double *v = calloc(size * size, sizeof(double));
+  double *sigma = malloc(size * sizeof(double));
+  size_t *order = malloc(size * sizeof(size_t));
+  for (size_t i = 0; i < size * size; i++) {
+    work[i] = mx.values[i];
+  }
+  for (size_t i = 0; i < size; i++) {
+    v[i * size + i] = 1;
+  }
+
+  for (size_t sweep = 0; sweep < HOMV_PLAN_SVD_SWEEPS; sweep++) {
+    bool rotated = false;
+    for (size_t p = 0; p < size; p++) {
+      for (size_t q = p + 1; q < size; q++) {
+        double alpha = 0, beta = 0, gamma = 0;
+        for (size_t i = 0; i < size; i++) {
+          alpha += work[i * size + p] * work[i * size + p];
+          beta += work[i * size + q] * work[i * size + q];
+          gamma += work[i * size + p] * work[i * size + q];
+        }
+        if (fabs(gamma) <= HOMV_PLAN_EPS * sqrt(alpha * beta)) {
+          continue;
+        }
+
+        rotated = true;
+        double zeta = (beta - alpha) / (2 * gamma);
+        double t = (zeta >= 0 ? 1 : -1) / (fabs(zeta) + sqrt(1 + zeta * zeta));
+        double c = 1 / sqrt(1 + t * t);
+        double s = c * t;
+        for (size_t i = 0; i < size; i++) {
+          double wp = work[i * size + p], wq = work[i * size + q];
+          work[i * size + p] = c * wp - s * wq;
+          work[i * size + q] = s * wp + c * wq;
+          double vp = v[i * size + p], vq = v[i * size + q];
+          v[i * size + p] = c * vp - s * vq;
+          v[i * size + q] = s * vp + c * vq;
+        }
+      }
+    }
+    if (!rotated) {
+      break;
+    }
+  }
+
+  double total = 0;
+  for (size_t j = 0; j < size; j++) {
+    sigma[j] = 0;
+    for (size_t i = 0; i < size; i++) {
+      sigma[j] += work[i * size + j] * work[i * size + j];
+    }
+    total += sigma[j];
+    sigma[j] = sqrt(sigma[j]);
+    order[j] = j;
+  }
+
+  for (size_t i = 1; i < size; i++) {
+    for (size_t j = i; j > 0 && sigma[order[j]] > sigma[order[j - 1]]; j--) {
+      size_t tmp = order[j];
+      order[j] = order[j - 1];
+      order[j - 1] = tmp;
+    }
+  }
+
+  // Squared error of approximation is sum of squares of dropped singular values
+  size_t terms = size;
+  double dropped = 0;
+  while (terms > 1) {
+    double sigma_last = sigma[order[terms - 1]];
+    if (dropped + sigma_last * sigma_last > homv_svd_tolerance * homv_svd_tolerance * total) {
+      break;
+    }
+    dropped += sigma_last * sigma_last;
+    terms--;
+  }
+
+  for (size_t term = 0; term < terms; term++) {
+    for (size_t i = 0; i < size; i++) {
+      cols[term * size + i] = work[i * size + order[term]];
+      rows[term * size + i] = v[i * size + order[term]];
+    }
+  }
+
+  free(work);
+  free(v);
+  free(sigma);
+  free(order);
+  return terms;
+}
+
+// Rounding (half up, like float path) division of sum by divisor
+static int32_t homv_plan_round_div(int32_t sum, int32_t divisor) {
+  int32_t numerator = 2 * sum + divisor;
+  int32_t quotient = numerator / (2 * divisor);
+  return quotient * 2 * divisor > numerator ? quotient - 1 : quotient;
+}
+
+static uint8_t homv_plan_saturate(int32_t value) { return value < 0 ? 0 : value > 255 ? 255 : (uint8_t)value; }
+
+// Kernel is integer if all coefficients are integers divided by common divisor (1 for sobel, 9 for blur).
+// Sums of any uint8 input must fit int16, and division by divisor must give exactly rounded result
+// with one multiply and shift, that is checked for every possible sum
+static bool homv_plan_factor_integer(homv_matrix mx, homv_plan *plan) {
+  size_t count = mx.size * mx.size;
+  for (int32_t divisor = 1; divisor <= HOMV_PLAN_MAX_DIVISOR; divisor++) {
+    bool integer = true;
+    int32_t positive = 0, negative = 0;
+    for (size_t i = 0; i < count && integer; i++) {
+      double scaled = mx.values[i] * divisor;
+      double weight = round(scaled);
+      integer = fabs(scaled - weight) <= HOMV_PLAN_EPS * divisor && fabs(weight) <= 128;
+      plan->weights[i] = (int16_t)weight;
+      positive += weight > 0 ? (int32_t)weight : 0;
+      negative += weight < 0 ? (int32_t)-weight : 0;
+    }
+    if (!integer) {
+      continue;
+    }
+
+    if (255 * positive > INT16_MAX || 255 * negative > INT16_MAX) {
+      return false;
+    }
+
+    plan->divisor = divisor;
+    plan->multiplier = 0;
+    if (divisor == 1) {
+      return true;
+    }
+
+    int32_t multiplier = (int32_t)lround(32768.0 / divisor);
+    for (int32_t sum = -255 * negative; sum <= 255 * positive; sum++) {
+      uint8_t scaled = homv_plan_saturate((sum * multiplier + (1 << 14)) >> 15);
+      if (scaled != homv_plan_saturate(homv_plan_round_div(sum, divisor))) {
+        return false;
+      }
+    }
+    plan->multiplier = (int16_t)multiplier;
+    return true;
+  }
+
+  return false;
+}
+
+// Sparse plan keeps only non-zero taps of integer kernel, taps of 1 and -1 are added without multiply
+static void homv_plan_factor_sparse(homv_plan *plan) {
+  size_t size = plan->matrix.size;
+  plan->sparse = malloc(size * size * sizeof(homv_tap));
+  plan->sparse_count = 0;
+  for (size_t i = 0; i < size * size; i++) {
+    if (plan->weights[i] != 0) {
+      plan->sparse[plan->sparse_count++] = (homv_tap){(uint16_t)(i % size), (uint16_t)(i / size), plan->weights[i]};
+    }
+  }
+}
+
+// Box kernel has all coefficients equal, like blur
+static bool homv_plan_factor_box(homv_matrix mx, homv_plan *plan) {
+  size_t count = mx.size * mx.size;
+  for (size_t i = 1; i < count; i++) {
+    if (fabs(mx.values[i] - mx.values[0]) > HOMV_PLAN_EPS * fabs(mx.values[0])) {
+      return false;
+    }
+  }
+  plan->box_scale = mx.values[0];
+  return true;
+}
+
+// 1 if mirrored kernel equals kernel, -1 if it is negated kernel, 0 otherwise.
+// Kernel is mirrored about vertical axis if flip_x, about horizontal axis if flip_y
+static int homv_plan_mirror_sign(homv_matrix mx, bool flip_x, bool flip_y) {
+  size_t size = mx.size;
+  double scale = 0;
+  for (size_t i = 0; i < size * size; i++) {
+    scale = fmax(scale, fabs(mx.values[i]));
+  }
+
+  for (int sign = 1; sign >= -1; sign -= 2) {
+    bool mirrored = true;
+    for (size_t y = 0; y < size && mirrored; y++) {
+      for (size_t x = 0; x < size && mirrored; x++) {
+        double value = mx.values[(flip_y ? size - 1 - y : y) * size + (flip_x ? size - 1 - x : x)];
+        mirrored = fabs(mx.values[y * size + x] - sign * value) <= HOMV_PLAN_EPS * scale;
+      }
+    }
+    if (mirrored) {
+      return sign;
+    }
+  }
+  return 0;
+}
+
+// Multiplies of kernel taps plus a quarter for every addition of mirrored values, per output value.
+// Center fold widens both values of every pair on its own, so its pairs cost two multiplies and it does not beat
+// direct path. Both axes are folded from 9x9, where the quarter of multiplies outweighs passes over output row
+static double homv_plan_fold_cost(const homv_plan *plan, homv_plan_fold fold) {
+  double size = (double)plan->matrix.size;
+  double half = (double)(plan->matrix.size / 2);
+  double kept = size - half;
+  switch (fold) {
+  case HOMV_FOLD_X:
+    return size * kept + size * half / 4;
+  case HOMV_FOLD_Y:
+    return kept * size + half / 4 + HOMV_PLAN_ROW_FOLD_COST * size;
+  case HOMV_FOLD_POINT:
+    return size * size + 1 + size * half / 4 + HOMV_PLAN_ROW_FOLD_COST * size;
+  case HOMV_FOLD_QUARTER:
+    return kept * kept + (half + kept * half) / 4 + HOMV_PLAN_ROW_FOLD_COST * size;
+  default:
+    return size * size;
+  }
+}
+
+static bool homv_plan_fold_allowed(const homv_plan *plan, homv_plan_fold fold) {
+  switch (fold) {
+  case HOMV_FOLD_X:
+    return plan->symmetry_x;
+  case HOMV_FOLD_Y:
+    return plan->symmetry_y;
+  case HOMV_FOLD_POINT:
+    return plan->symmetry_point;
+  case HOMV_FOLD_QUARTER:
+    return plan->symmetry_x && plan->symmetry_y;
+  default:
+    return false;
+  }
+}
+
+static double homv_plan_kind_cost(const homv_plan *plan, homv_plan_kind kind) {
+  double size = (double)plan->matrix.size;
+  switch (kind) {
+  case HOMV_PLAN_SEPARABLE:
+  case HOMV_PLAN_LOW_RANK:
+    return 2 * size * plan->terms;
+  case HOMV_PLAN_INTEGER:
+    return size * size / 2;
+  case HOMV_PLAN_SPARSE: {
+    // Sparse taps are loaded once per output row, integer blocks share loads between rows,
+    // so sparse plan is cheaper only if it skips at least few taps
+    double cost = 0;
+    for (size_t i = 0; i < plan->sparse_count; i++) {
+      cost += abs(plan->sparse[i].weight) == 1 ? 1 : 1.5;
+    }
+    return cost / 2;
+  }
+  case HOMV_PLAN_BOX:
+    return HOMV_PLAN_BOX_COST;
+  case HOMV_PLAN_RECURSIVE:
+    return HOMV_PLAN_RECURSIVE_COST;
+  case HOMV_PLAN_WINOGRAD:
+    return homv_simd->isa == HOMV_ISA_SCALAR ? HOMV_PLAN_WINOGRAD_SCALAR_COST : HOMV_PLAN_WINOGRAD_COST;
+  case HOMV_PLAN_GRADIENT:
+    return HOMV_PLAN_GRADIENT_COST;
+  case HOMV_PLAN_SYMMETRIC:
+    return homv_plan_fold_cost(plan, plan->fold);
+  default:
+    return size * size;
+  }
+}
+
+// Winograd F(2x2, 3x3) kernel transform U = G * M * G^T. Output of 4 x 4 input tile is
+// A^T * (U .* (B^T * tile * B)) * A, transforms of input and output take only additions
+static void homv_plan_factor_winograd(homv_matrix mx, float *u) {
+  static const double g[4][3] = {{1, 0, 0}, {0.5, 0.5, 0.5}, {0.5, -0.5, 0.5}, {0, 0, 1}};
+  for (size_t a = 0; a < 4; a++) {
+    for (size_t k = 0; k < 4; k++) {
+      double sum = 0;
+      for (size_t y = 0; y < 3; y++) {
+        for (size_t x = 0; x < 3; x++) {
+          sum += g[a][y] * mx.values[y * 3 + x] * g[k][x];
+        }
+      }
+      u[a * 4 + k] = (float)sum;
+    }
+  }
+}
+
+// Row functions of homv_simd take float taps: whole kernel for HOMV_PLAN_DIRECT and HOMV_PLAN_SYMMETRIC,
+// horizontal 1D kernels for HOMV_PLAN_SEPARABLE and HOMV_PLAN_LOW_RANK, transformed kernel for HOMV_PLAN_WINOGRAD
+static void homv_plan_fill_taps(homv_plan *plan) {
+  size_t size = plan->matrix.size;
+  bool whole = plan->kind == HOMV_PLAN_DIRECT || plan->kind == HOMV_PLAN_SYMMETRIC;
+  const double *values = whole ? plan->matrix.values : plan->rows;
+  size_t count = whole ? size * size : plan->terms * size;
+  if (plan->kind == HOMV_PLAN_WINOGRAD) {
+    plan->taps = malloc(16 * sizeof(float));
+    homv_plan_factor_winograd(plan->matrix, plan->taps);
+    return;
+  }
+  if (!whole && plan->kind != HOMV_PLAN_SEPARABLE && plan->kind != HOMV_PLAN_LOW_RANK) {
+    return;
+  }
+
+  plan->taps = malloc(count * sizeof(float));
+  for (size_t i = 0; i < count; i++) {
+    plan->taps[i] = (float)values[i];
+  }
+}
+
+homv_plan *homv_plan_create(homv_matrix matrix) {
+  homv_plan *plan = calloc(1, sizeof(homv_plan));
+  plan->kind = HOMV_PLAN_DIRECT;
+  plan->matrix = matrix;
+
+  // Gradient is not convolution, it has the only plan
+  if (matrix.gradient != HOMV_MX_GRADIENT_NONE) {
+    plan->kind = HOMV_PLAN_GRADIENT;
+    return plan;
+  }
+
+  if (homv_plan_force == HOMV_PLAN_DIRECT) {
+    homv_plan_fill_taps(plan);
+    return plan;
+  }
+
+  // Every kind kernel allows is prepared, then forced or the cheapest one is kept
+  bool allowed[HOMV_PLAN_MAX] = {[HOMV_PLAN_DIRECT] = true};
+  size_t size = matrix.size;
+  plan->rows = malloc(size * size * sizeof(double));
+  plan->cols = malloc(size * size * sizeof(double));
+  plan->weights = malloc(size * size * sizeof(int16_t));
+
+  if (homv_plan_factor_separable(matrix, plan->rows, plan->cols)) {
+    allowed[HOMV_PLAN_SEPARABLE] = true;
+    plan->terms = 1;
+  } else if (homv_plan_force == HOMV_PLAN_AUTO || homv_plan_force == HOMV_PLAN_LOW_RANK) {
+    allowed[HOMV_PLAN_LOW_RANK] = true;
+    plan->terms = homv_plan_factor_svd(matrix, plan->rows, plan->cols);
+  }
+  allowed[HOMV_PLAN_INTEGER] = homv_plan_factor_integer(matrix, plan);
+  allowed[HOMV_PLAN_SPARSE] = allowed[HOMV_PLAN_INTEGER];
+  if (allowed[HOMV_PLAN_SPARSE]) {
+    homv_plan_factor_sparse(plan);
+  }
+  plan->symmetry_x = homv_plan_mirror_sign(matrix, true, false);
+  plan->symmetry_y = homv_plan_mirror_sign(matrix, false, true);
+  plan->symmetry_point = homv_plan_mirror_sign(matrix, true, true);
+  for (homv_plan_fold fold = HOMV_FOLD_X; fold < HOMV_FOLD_MAX; fold++) {
+    if (homv_plan_fold_allowed(plan, fold) &&
+        (!plan->fold || homv_plan_fold_cost(plan, fold) < homv_plan_fold_cost(plan, plan->fold))) {
+      plan->fold = fold;
+    }
+  }
+  allowed[HOMV_PLAN_SYMMETRIC] = plan->fold != HOMV_FOLD_NONE;
+  allowed[HOMV_PLAN_BOX] = homv_plan_factor_box(matrix, plan);
+  allowed[HOMV_PLAN_RECURSIVE] = matrix.sigma >= HOMV_IIR_MIN_SIGMA;
+  allowed[HOMV_PLAN_WINOGRAD] = size == 3;
+
+  if (homv_plan_force != HOMV_PLAN_AUTO) {
+    plan->kind = allowed[homv_plan_force] ? homv_plan_force : HOMV_PLAN_DIRECT;
+  } else {
+    for (homv_plan_kind kind = HOMV_PLAN_DIRECT; kind < HOMV_PLAN_MAX; kind++) {
+      if (allowed[kind] && homv_plan_kind_cost(plan, kind) < homv_plan_kind_cost(plan, plan->kind)) {
+        plan->kind = kind;
+      }
+    }
+  }
+
+  if (plan->kind != HOMV_PLAN_SEPARABLE && plan->kind != HOMV_PLAN_LOW_RANK) {
+    free(plan->rows);
+    free(plan->cols);
+    plan->rows = plan->cols = NULL;
+    plan->terms = 0;
+  }
+  if (plan->kind != HOMV_PLAN_INTEGER) {
+    free(plan->weights);
+    plan->weights = NULL;
+  }
+  if (plan->kind != HOMV_PLAN_SYMMETRIC) {
+    plan->symmetry_x = plan->symmetry_y = plan->symmetry_point = 0;
+    plan->fold = HOMV_FOLD_NONE;
+  }
+  if (plan->kind != HOMV_PLAN_BOX) {
+    plan->box_scale = 0;
+  }
+  if (plan->kind != HOMV_PLAN_SPARSE) {
+    free(plan->sparse);
+    plan->sparse = NULL;
+    plan->sparse_count = 0;
+  }
+  homv_plan_fill_taps(plan);
+  return plan;
+}
+
+void homv_plan_free(homv_plan *plan) {
+  if (!plan) {
+    return;
+  }
+
+  free(plan->rows);
+  free(plan->cols);
+  free(plan->weights);
+  free(plan->sparse);
+  free(plan->taps);
+  free(plan);
+
+  return;
+}
+
+double homv_plan_cost(const homv_plan *plan) { return homv_plan_kind_cost(plan, plan->kind); }
+
+// Kernel with output that is never saturated and reflected the same way as its input
+static bool homv_plan_composable(const homv_matrix *mx) {
+  if (mx->gradient != HOMV_MX_GRADIENT_NONE || mx->size % 2 == 0 || homv_plan_mirror_sign(*mx, true, false) != 1 ||
+      homv_plan_mirror_sign(*mx, false, true) != 1) {
+    return false;
+  }
+
+  double sum = 0;
+  for (size_t i = 0; i < mx->size * mx->size; i++) {
+    if (mx->values[i] < 0) {
+      return false;
+    }
+    sum += mx->values[i];
+  }
+  return sum <= 1 + HOMV_PLAN_EPS;
+}
+
+// Stages of chain are planned as sampled kernels: recursive filter needs whole columns, chain has only rows
+static homv_matrix *homv_plan_chain_copy(const homv_matrix *mx) {
+  homv_matrix *copy = homv_mx_init(mx->size, NULL);
+  copy->gradient = mx->gradient;
+  memcpy(copy->values, mx->values, mx->size * mx->size * sizeof(double));
+  return copy;
+}
+
+homv_plan_chain *homv_plan_chain_create(const homv_matrix *matrices, size_t count) {
+  homv_plan_chain *chain = malloc(sizeof(homv_plan_chain));
+  chain->count = 0;
+  chain->matrices = malloc(count * sizeof(homv_matrix *));
+  chain->plans = malloc(count * sizeof(homv_plan *));
+
+  // Kernels are composed greedily from the left while composed plan is cheaper than two plans and one more stage
+  homv_matrix *last = homv_plan_chain_copy(&matrices[0]);
+  homv_plan *last_plan = homv_plan_create(*last);
+  for (size_t i = 1; i < count; i++) {
+    homv_matrix *next = homv_plan_chain_copy(&matrices[i]);
+    homv_plan *next_plan = homv_plan_create(*next);
+
+    if (homv_plan_compose && homv_plan_composable(last) && next->gradient == HOMV_MX_GRADIENT_NONE) {
+      homv_matrix *composed = homv_mx_convolve(last, next);
+      homv_plan *composed_plan = homv_plan_create(*composed);
+      double separate_cost = homv_plan_cost(last_plan) + homv_plan_cost(next_plan) + HOMV_PLAN_STAGE_COST;
+      if (homv_plan_cost(composed_plan) < separate_cost) {
+        homv_plan_free(last_plan);
+        homv_plan_free(next_plan);
+        homv_mx_free(last);
+        homv_mx_free(next);
+        last = composed;
+        last_plan = composed_plan;
+        continue;
+      }
+      homv_plan_free(composed_plan);
+      homv_mx_free(composed);
+    }
+
+    chain->matrices[chain->count] = last;
+    chain->plans[chain->count++] = last_plan;
+    last = next;
+    last_plan = next_plan;
+  }
+  chain->matrices[chain->count] = last;
+  chain->plans[chain->count++] = last_plan;
+
+  return chain;
+}
+
+void homv_plan_chain_free(homv_plan_chain *chain) {
+  for (size_t i = 0; i < chain->count; i++) {
+    homv_plan_free(chain->plans[i]);
+    homv_mx_free(chain->matrices[i]);
+  }
+  free(chain->matrices);
+  free(chain->plans);
+  free(chain);
+}
+
+double homv_plan_chain_separate_cost(const homv_matrix *matrices, size_t count) {
+  double cost = (double)(count - 1) * HOMV_PLAN_STAGE_COST;
+  for (size_t i = 0; i < count; i++) {
+    homv_matrix *stage = homv_plan_chain_copy(&matrices[i]);
+    homv_plan *plan = homv_plan_create(*stage);
+    cost += homv_plan_cost(plan);
+    homv_plan_free(plan);
+    homv_mx_free(stage);
+  }
+  return cost;
+}
+
+double homv_plan_chain_cost(const homv_plan_chain *chain) {
+  double cost = (double)(chain->count - 1) * HOMV_PLAN_STAGE_COST;
+  for (size_t i = 0; i < chain->count; i++) {
+    cost += homv_plan_cost(chain->plans[i]);
+  }
+  return cost;
+}
@@ -0,0 +1,102 @@
+#include "homv_png.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Deflate of stb_image_write, its implementation is compiled with stb_image_write.h by every program,
+// but header declares it only for implementation. Result is freed with free
+unsigned char *stbi_zlib_compress(unsigned char *data, int data_len, int *out_len, int quality);
+
+// Compression level of stbi_write_png
+#define HOMV_PNG_QUALITY 8
+
+static void homv_png_put32(uint8_t *dst, uint32_t value) {
+  dst[0] = value >> 24;
+  dst[1] = value >> 16;
+  dst[2] = value >> 8;
+  dst[3] = value;
+}
+
+static uint32_t homv_png_crc(const uint8_t *data, size_t size) {
+  static uint32_t table[256];
+  if (!table[1]) {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) {
+        c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      table[n] = c;
+    }
+  }
+
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ data[i]) & 255] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+// Length, type, data and CRC of type and data
+static bool homv_png_chunk(FILE *file, const char *type, const uint8_t *data, size_t size) {
+  uint8_t *chunk = malloc(size + 12);
+  homv_png_put32(chunk, (uint32_t)size);
+  memcpy(chunk + 4, type, 4);
+  if (size) {
+    memcpy(chunk + 8, data, size);
+  }
+  homv_png_put32(chunk + 8 + size, homv_png_crc(chunk + 4, size + 4));
+  bool written = fwrite(chunk, 1, size + 12, file) == size + 12;
+  free(chunk);
+  return written;
+}
+
+bool homv_png_write_u16(const char *filename, int width, int height, int channels, const uint16_t *image) {
+  static const uint8_t signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+  static const uint8_t color_types[5] = {0, 0, 4, 2, 6};
+  if (channels < 1 || channels > 4) {
+    return false;
+  }
+
+  // Every row has Sub filter: big-endian bytes minus bytes of previous pixel, so smooth 16-bit images compress
+  size_t values = (size_t)width * channels;
+  size_t row_size = 1 + 2 * values;
+  size_t pixel = 2 * (size_t)channels;
+  uint8_t *filtered = malloc(height * row_size);
+  for (int y = 0; y < height; y++) {
+    uint8_t *row = filtered + y * row_size;
+    const uint16_t *src = image + y * values;
+    row[0] = 1;
+    for (size_t i = 0; i < values; i++) {
+      row[1 + 2 * i] = src[i] >> 8;
+      row[2 + 2 * i] = src[i] & 255;
+    }
+    for (size_t i = row_size - 1; i > pixel; i--) {
+      row[i] -= row[i - pixel];
+    }
+  }
+
+  int compressed_size;
+  uint8_t *compressed = stbi_zlib_compress(filtered, (int)(height * row_size), &compressed_size, HOMV_PNG_QUALITY);
+  free(filtered);
+  if (!compressed) {
+    return false;
+  }
+
+  uint8_t header[13];
+  homv_png_put32(header, width);
+  homv_png_put32(header + 4, height);
+  header[8] = 16;
+  header[9] = color_types[channels];
+  header[10] = header[11] = header[12] = 0;
+
+  FILE *file = fopen(filename, "wb");
+  bool written = file && fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+                 homv_png_chunk(file, "IHDR", header, sizeof(header)) &&
+                 homv_png_chunk(file, "IDAT", compressed, compressed_size) && homv_png_chunk(file, "IEND", NULL, 0);
+  if (file && fclose(file) != 0) {
+    written = false;
+  }
+  free(compressed);
+  return written;
+}
@@ -0,0 +1,145 @@
+#include "homv_pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HOMV_POOL_MIN_SIZE 64
+#define HOMV_POOL_STEPS 4
+#define HOMV_POOL_CLASSES (HOMV_POOL_STEPS * 48)
+// Header keeps class of buffer, its size keeps alignment of malloc for buffer itself
+#define HOMV_POOL_HEADER 64
+
+size_t homv_pool_limit = (size_t)256 << 20;
+
+typedef struct homv_pool_node {
+  struct homv_pool_node *next;
+} homv_pool_node;
+
+static pthread_mutex_t homv_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static homv_pool_node *homv_pool_lists[HOMV_POOL_CLASSES];
+static homv_pool_stats homv_pool_current;
+static size_t homv_pool_used_bytes;
+
+// Classes are 64, 80, 96, 112, 128, 160, ... bytes: at most 25% of buffer is wasted
+static size_t homv_pool_class_size(size_t class) {
+  size_t base = (size_t)HOMV_POOL_MIN_SIZE << (class / HOMV_POOL_STEPS);
+  return base + base / HOMV_POOL_STEPS * (class % HOMV_POOL_STEPS);
+}
+
+static size_t homv_pool_class(size_t size) {
+  size_t class = 0;
+  while (homv_pool_class_size(class) < size) {
+    class++;
+  }
+  return class;
+}
+
+static size_t *homv_pool_header(void *buffer) { return (size_t *)((uint8_t *)buffer - HOMV_POOL_HEADER); }
+
+static void homv_pool_update_peak(void) {
+  size_t total = homv_pool_used_bytes + homv_pool_current.retained_bytes;
+  if (total > homv_pool_current.peak_bytes) {
+    homv_pool_current.peak_bytes = total;
+  }
+}
+
+void *homv_pool_alloc(size_t size) {
+  size_t class = homv_pool_class(size);
+  if (class >= HOMV_POOL_CLASSES) {
+    return NULL;
+  }
+  size_t class_size = homv_pool_class_size(class);
+
+  pthread_mutex_lock(&homv_pool_mutex);
+  homv_pool_node *node = homv_pool_lists[class];
+  if (node) {
+    homv_pool_lists[class] = node->next;
+    homv_pool_current.retained_bytes -= class_size;
+    homv_pool_current.hits++;
+  } else {
+    homv_pool_current.misses++;
+  }
+  homv_pool_used_bytes += class_size;
+  homv_pool_update_peak();
+  pthread_mutex_unlock(&homv_pool_mutex);
+
+  if (node) {
+    return node;
+  }
+
+  uint8_t *block = malloc(HOMV_POOL_HEADER + class_size);
+  if (!block) {
+    pthread_mutex_lock(&homv_pool_mutex);
+    homv_pool_used_bytes -= class_size;
+    pthread_mutex_unlock(&homv_pool_mutex);
+    return NULL;
+  }
+  *(size_t *)block = class;
+  return block + HOMV_POOL_HEADER;
+}
+
+void *homv_pool_realloc(void *buffer, size_t size) {
+  if (!buffer) {
+    return homv_pool_alloc(size);
+  }
+
+  size_t class_size = homv_pool_class_size(*homv_pool_header(buffer));
+  if (size <= class_size) {
+    return buffer;
+  }
+
+  void *new_buffer = homv_pool_alloc(size);
+  if (!new_buffer) {
+    return NULL;
+  }
+  memcpy(new_buffer, buffer, class_size);
+  homv_pool_free(buffer);
+  return new_buffer;
+}
+
+void homv_pool_free(void *buffer) {
+  if (!buffer) {
+    return;
+  }
+
+  size_t class = *homv_pool_header(buffer);
+  size_t class_size = homv_pool_class_size(class);
+
+  pthread_mutex_lock(&homv_pool_mutex);
+  homv_pool_used_bytes -= class_size;
+  bool retain = homv_pool_current.retained_bytes + class_size <= homv_pool_limit;
+  if (retain) {
+    homv_pool_node *node = buffer;
+    node->next = homv_pool_lists[class];
+    homv_pool_lists[class] = node;
+    homv_pool_current.retained_bytes += class_size;
+  }
+  pthread_mutex_unlock(&homv_pool_mutex);
+
+  if (!retain) {
+    free(homv_pool_header(buffer));
+  }
+}
+
+void homv_pool_clear(void) {
+  pthread_mutex_lock(&homv_pool_mutex);
+  for (size_t class = 0; class < HOMV_POOL_CLASSES; class++) {
+    while (homv_pool_lists[class]) {
+      homv_pool_node *node = homv_pool_lists[class];
+      homv_pool_lists[class] = node->next;
+      free(homv_pool_header(node));
+    }
+  }
+  homv_pool_current.retained_bytes = 0;
+  pthread_mutex_unlock(&homv_pool_mutex);
+}
+
+homv_pool_stats homv_pool_get_stats(void) {
+  pthread_mutex_lock(&homv_pool_mutex);
+  homv_pool_stats stats = homv_pool_current;
+  pthread_mutex_unlock(&homv_pool_mutex);
+  return stats;
+}
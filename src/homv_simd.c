@@ -0,0 +1,2435 @@
+#include "homv_simd.h"
+
+#include <immintrin.h>
+#include <math.h>
+#include <string.h>
+
+// Every variant rounds the same way: clamp to 0..255, add 0.5 and truncate.
+// Variants with FMA (AVX2, AVX-512) also use fmaf in tails, so a value does not depend on its position in row
+
+static inline uint8_t homv_simd_pixel(float value) {
+  if (value <= 0) {
+    return 0;
+  }
+  if (value >= 255) {
+    return 255;
+  }
+  return (uint8_t)(value + 0.5f);
+}
+
+static void homv_madd_u8_scalar(float *acc, const uint8_t *src, float weight, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    acc[i] += weight * src[i];
+  }
+}
+
+static void homv_madd_f32_scalar(float *acc, const float *src, float weight, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    acc[i] += weight * src[i];
+  }
+}
+
+static void homv_store_u8_scalar(uint8_t *dst, const float *acc, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    dst[i] = homv_simd_pixel(acc[i]);
+  }
+}
+
+static void homv_madd_i16_scalar(int16_t *acc, const uint8_t *src, int16_t weight, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    acc[i] += weight * src[i];
+  }
+}
+
+static void homv_store_i16_scalar(uint8_t *dst, const int16_t *acc, int16_t multiplier, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    int32_t value = multiplier ? (acc[i] * multiplier + (1 << 14)) >> 15 : acc[i];
+    dst[i] = value < 0 ? 0 : value > 255 ? 255 : (uint8_t)value;
+  }
+}
+
+// SSE4.1: 16 values per iteration, uint8 are widened to int32 and converted to float
+__attribute__((target("sse4.1"))) static void homv_madd_u8_sse41(float *acc, const uint8_t *src, float weight,
+                                                                 size_t count) {
+  __m128 w = _mm_set1_ps(weight);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)(src + i));
+    for (size_t part = 0; part < 4; part++) {
+      __m128 values = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(bytes));
+      _mm_storeu_ps(acc + i + part * 4, _mm_add_ps(_mm_loadu_ps(acc + i + part * 4), _mm_mul_ps(values, w)));
+      bytes = _mm_srli_si128(bytes, 4);
+    }
+  }
+  homv_madd_u8_scalar(acc + i, src + i, weight, count - i);
+}
+
+__attribute__((target("sse4.1"))) static void homv_madd_f32_sse41(float *acc, const float *src, float weight,
+                                                                  size_t count) {
+  __m128 w = _mm_set1_ps(weight);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(src + i), w)));
+  }
+  homv_madd_f32_scalar(acc + i, src + i, weight, count - i);
+}
+
+__attribute__((target("sse4.1"))) static void homv_store_u8_sse41(uint8_t *dst, const float *acc, size_t count) {
+  __m128 low = _mm_setzero_ps();
+  __m128 high = _mm_set1_ps(255);
+  __m128 half = _mm_set1_ps(0.5f);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i ints[4];
+    for (size_t part = 0; part < 4; part++) {
+      __m128 values = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(acc + i + part * 4), low), high);
+      ints[part] = _mm_cvttps_epi32(_mm_add_ps(values, half));
+    }
+    __m128i words_low = _mm_packs_epi32(ints[0], ints[1]);
+    __m128i words_high = _mm_packs_epi32(ints[2], ints[3]);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(words_low, words_high));
+  }
+  homv_store_u8_scalar(dst + i, acc + i, count - i);
+}
+
+// Integer path works in int16 lanes: 8 values per register instead of 4 floats
+__attribute__((target("sse4.1"))) static void homv_madd_i16_sse41(int16_t *acc, const uint8_t *src, int16_t weight,
+                                                                  size_t count) {
+  __m128i w = _mm_set1_epi16(weight);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i first = _mm_mullo_epi16(_mm_cvtepu8_epi16(bytes), w);
+    __m128i second = _mm_mullo_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(bytes, 8)), w);
+    _mm_storeu_si128((__m128i *)(acc + i), _mm_add_epi16(_mm_loadu_si128((const __m128i *)(acc + i)), first));
+    _mm_storeu_si128((__m128i *)(acc + i + 8), _mm_add_epi16(_mm_loadu_si128((const __m128i *)(acc + i + 8)), second));
+  }
+  homv_madd_i16_scalar(acc + i, src + i, weight, count - i);
+}
+
+// _mm_mulhrs_epi16 computes exactly (a * b + 2^14) >> 15
+__attribute__((target("sse4.1"))) static void homv_store_i16_sse41(uint8_t *dst, const int16_t *acc, int16_t multiplier,
+                                                                   size_t count) {
+  __m128i m = _mm_set1_epi16(multiplier);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i first = _mm_loadu_si128((const __m128i *)(acc + i));
+    __m128i second = _mm_loadu_si128((const __m128i *)(acc + i + 8));
+    if (multiplier) {
+      first = _mm_mulhrs_epi16(first, m);
+      second = _mm_mulhrs_epi16(second, m);
+    }
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(first, second));
+  }
+  homv_store_i16_scalar(dst + i, acc + i, multiplier, count - i);
+}
+
+// AVX2: 32 values per iteration with FMA
+__attribute__((target("avx2,fma"))) static void homv_madd_u8_avx2(float *acc, const uint8_t *src, float weight,
+                                                                  size_t count) {
+  __m256 w = _mm256_set1_ps(weight);
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    for (size_t half = 0; half < 2; half++) {
+      __m128i bytes = _mm_loadu_si128((const __m128i *)(src + i + half * 16));
+      float *out = acc + i + half * 16;
+      __m256 first = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+      __m256 second = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+      _mm256_storeu_ps(out, _mm256_fmadd_ps(first, w, _mm256_loadu_ps(out)));
+      _mm256_storeu_ps(out + 8, _mm256_fmadd_ps(second, w, _mm256_loadu_ps(out + 8)));
+    }
+  }
+  for (; i < count; i++) {
+    acc[i] = fmaf((float)src[i], weight, acc[i]);
+  }
+}
+
+__attribute__((target("avx2,fma"))) static void homv_madd_f32_avx2(float *acc, const float *src, float weight,
+                                                                   size_t count) {
+  __m256 w = _mm256_set1_ps(weight);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_ps(acc + i, _mm256_fmadd_ps(_mm256_loadu_ps(src + i), w, _mm256_loadu_ps(acc + i)));
+  }
+  for (; i < count; i++) {
+    acc[i] = fmaf(src[i], weight, acc[i]);
+  }
+}
+
+// Packs work inside 128-bit lanes, so after packing dwords are in order 0 4 1 5 2 6 3 7
+__attribute__((target("avx2,fma"))) static void homv_store_u8_avx2(uint8_t *dst, const float *acc, size_t count) {
+  __m256 low = _mm256_setzero_ps();
+  __m256 high = _mm256_set1_ps(255);
+  __m256 half = _mm256_set1_ps(0.5f);
+  __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i ints[4];
+    for (size_t part = 0; part < 4; part++) {
+      __m256 values = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(acc + i + part * 8), low), high);
+      ints[part] = _mm256_cvttps_epi32(_mm256_add_ps(values, half));
+    }
+    __m256i words_low = _mm256_packs_epi32(ints[0], ints[1]);
+    __m256i words_high = _mm256_packs_epi32(ints[2], ints[3]);
+    __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(words_low, words_high), order);
+    _mm256_storeu_si256((__m256i *)(dst + i), bytes);
+  }
+  homv_store_u8_scalar(dst + i, acc + i, count - i);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_madd_i16_avx2(int16_t *acc, const uint8_t *src, int16_t weight,
+                                                                   size_t count) {
+  __m256i w = _mm256_set1_epi16(weight);
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i bytes = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i first = _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)), w);
+    __m256i second = _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)), w);
+    _mm256_storeu_si256((__m256i *)(acc + i), _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(acc + i)), first));
+    _mm256_storeu_si256((__m256i *)(acc + i + 16),
+                        _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(acc + i + 16)), second));
+  }
+  homv_madd_i16_scalar(acc + i, src + i, weight, count - i);
+}
+
+// Pack works inside 128-bit lanes, so after packing qwords are in order 0 2 1 3
+__attribute__((target("avx2,fma"))) static void homv_store_i16_avx2(uint8_t *dst, const int16_t *acc,
+                                                                    int16_t multiplier, size_t count) {
+  __m256i m = _mm256_set1_epi16(multiplier);
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i first = _mm256_loadu_si256((const __m256i *)(acc + i));
+    __m256i second = _mm256_loadu_si256((const __m256i *)(acc + i + 16));
+    if (multiplier) {
+      first = _mm256_mulhrs_epi16(first, m);
+      second = _mm256_mulhrs_epi16(second, m);
+    }
+    __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), 0xD8);
+    _mm256_storeu_si256((__m256i *)(dst + i), bytes);
+  }
+  homv_store_i16_scalar(dst + i, acc + i, multiplier, count - i);
+}
+
+// AVX-512 (F and BW): 64 values per iteration with FMA, int32 are narrowed to uint8 with unsigned saturation
+__attribute__((target("avx512f,fma"))) static void homv_madd_u8_avx512(float *acc, const uint8_t *src, float weight,
+                                                                       size_t count) {
+  __m512 w = _mm512_set1_ps(weight);
+  size_t i = 0;
+  for (; i + 64 <= count; i += 64) {
+    for (size_t part = 0; part < 4; part++) {
+      __m128i bytes = _mm_loadu_si128((const __m128i *)(src + i + part * 16));
+      float *out = acc + i + part * 16;
+      __m512 values = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(bytes));
+      _mm512_storeu_ps(out, _mm512_fmadd_ps(values, w, _mm512_loadu_ps(out)));
+    }
+  }
+  for (; i < count; i++) {
+    acc[i] = fmaf((float)src[i], weight, acc[i]);
+  }
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_madd_f32_avx512(float *acc, const float *src, float weight,
+                                                                        size_t count) {
+  __m512 w = _mm512_set1_ps(weight);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    _mm512_storeu_ps(acc + i, _mm512_fmadd_ps(_mm512_loadu_ps(src + i), w, _mm512_loadu_ps(acc + i)));
+  }
+  for (; i < count; i++) {
+    acc[i] = fmaf(src[i], weight, acc[i]);
+  }
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_store_u8_avx512(uint8_t *dst, const float *acc,
+                                                                        size_t count) {
+  __m512 low = _mm512_setzero_ps();
+  __m512 high = _mm512_set1_ps(255);
+  __m512 half = _mm512_set1_ps(0.5f);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m512 values = _mm512_min_ps(_mm512_max_ps(_mm512_loadu_ps(acc + i), low), high);
+    __m128i bytes = _mm512_cvtusepi32_epi8(_mm512_cvttps_epi32(_mm512_add_ps(values, half)));
+    _mm_storeu_si128((__m128i *)(dst + i), bytes);
+  }
+  homv_store_u8_scalar(dst + i, acc + i, count - i);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void homv_madd_i16_avx512(int16_t *acc, const uint8_t *src,
+                                                                            int16_t weight, size_t count) {
+  __m512i w = _mm512_set1_epi16(weight);
+  size_t i = 0;
+  for (; i + 64 <= count; i += 64) {
+    for (size_t half = 0; half < 2; half++) {
+      __m256i bytes = _mm256_loadu_si256((const __m256i *)(src + i + half * 32));
+      int16_t *out = acc + i + half * 32;
+      __m512i products = _mm512_mullo_epi16(_mm512_cvtepu8_epi16(bytes), w);
+      _mm512_storeu_si512(out, _mm512_add_epi16(_mm512_loadu_si512(out), products));
+    }
+  }
+  homv_madd_i16_scalar(acc + i, src + i, weight, count - i);
+}
+
+// Negative sums are zeroed first, then int16 are narrowed to uint8 with unsigned saturation
+__attribute__((target("avx512f,avx512bw"))) static void homv_store_i16_avx512(uint8_t *dst, const int16_t *acc,
+                                                                             int16_t multiplier, size_t count) {
+  __m512i m = _mm512_set1_epi16(multiplier);
+  __m512i zero = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m512i values = _mm512_loadu_si512(acc + i);
+    if (multiplier) {
+      values = _mm512_mulhrs_epi16(values, m);
+    }
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm512_cvtusepi16_epi8(_mm512_max_epi16(values, zero)));
+  }
+  homv_store_i16_scalar(dst + i, acc + i, multiplier, count - i);
+}
+
+// Row functions add whole kernel row of taps at once: accumulators are loaded once, get all taps and are stored once.
+// Taps are added in order, so results are the same as of taps calls of madd_u8 or madd_i16.
+// Kernel sizes 3, 5, 7, 9 crossed with 1, 3, 4 channels (stride between taps) are specialized:
+// with constant taps and stride the tap loop is fully unrolled and offsets are immediate
+#define HOMV_SIMD_SPECIALIZE_STRIDE(row, taps, stride)                                                               \
+  switch (stride) {                                                                                                    \
+  case 1:                                                                                                              \
+    row(taps, 1);                                                                                                      \
+    return;                                                                                                            \
+  case 3:                                                                                                              \
+    row(taps, 3);                                                                                                      \
+    return;                                                                                                            \
+  case 4:                                                                                                              \
+    row(taps, 4);                                                                                                      \
+    return;                                                                                                            \
+  }
+
+#define HOMV_SIMD_SPECIALIZE(row, taps, stride)                                                                      \
+  switch (taps) {                                                                                                      \
+  case 3:                                                                                                              \
+    HOMV_SIMD_SPECIALIZE_STRIDE(row, 3, stride);                                                                       \
+    break;                                                                                                             \
+  case 5:                                                                                                              \
+    HOMV_SIMD_SPECIALIZE_STRIDE(row, 5, stride);                                                                       \
+    break;                                                                                                             \
+  case 7:                                                                                                              \
+    HOMV_SIMD_SPECIALIZE_STRIDE(row, 7, stride);                                                                       \
+    break;                                                                                                             \
+  case 9:                                                                                                              \
+    HOMV_SIMD_SPECIALIZE_STRIDE(row, 9, stride);                                                                       \
+    break;                                                                                                             \
+  }                                                                                                                    \
+  row(taps, stride);
+
+#define HOMV_SIMD_INLINE __attribute__((always_inline)) static inline
+
+HOMV_SIMD_INLINE void homv_row_u8_scalar(float *acc, const uint8_t *src, const float *weights, size_t taps,
+                                         size_t stride, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    float sum = acc[i];
+#pragma GCC unroll 16
+    for (size_t tap = 0; tap < taps; tap++) {
+      sum += weights[tap] * src[i + tap * stride];
+    }
+    acc[i] = sum;
+  }
+}
+
+HOMV_SIMD_INLINE void homv_row_u8_fma(float *acc, const uint8_t *src, const float *weights, size_t taps,
+                                      size_t stride, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    float sum = acc[i];
+#pragma GCC unroll 16
+    for (size_t tap = 0; tap < taps; tap++) {
+      sum = fmaf((float)src[i + tap * stride], weights[tap], sum);
+    }
+    acc[i] = sum;
+  }
+}
+
+HOMV_SIMD_INLINE void homv_row_i16_scalar(int16_t *acc, const uint8_t *src, const int16_t *weights, size_t taps,
+                                          size_t stride, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    int16_t sum = acc[i];
+#pragma GCC unroll 16
+    for (size_t tap = 0; tap < taps; tap++) {
+      sum += weights[tap] * src[i + tap * stride];
+    }
+    acc[i] = sum;
+  }
+}
+
+#define HOMV_ROW_U8_SCALAR(taps, stride) homv_row_u8_scalar(acc, src, weights, taps, stride, count)
+static void homv_madd_row_u8_scalar(float *acc, const uint8_t *src, const float *weights, size_t taps, size_t stride,
+                                    size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_ROW_U8_SCALAR, taps, stride);
+}
+
+#define HOMV_ROW_I16_SCALAR(taps, stride) homv_row_i16_scalar(acc, src, weights, taps, stride, count)
+static void homv_madd_row_i16_scalar(int16_t *acc, const uint8_t *src, const int16_t *weights, size_t taps,
+                                     size_t stride, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_ROW_I16_SCALAR, taps, stride);
+}
+
+__attribute__((target("sse4.1"))) HOMV_SIMD_INLINE void homv_row_u8_sse41(float *acc, const uint8_t *src,
+                                                                          const float *weights, size_t taps,
+                                                                          size_t stride, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128 sums[4];
+    for (size_t part = 0; part < 4; part++) {
+      sums[part] = _mm_loadu_ps(acc + i + part * 4);
+    }
+#pragma GCC unroll 16
+    for (size_t tap = 0; tap < taps; tap++) {
+      __m128 w = _mm_set1_ps(weights[tap]);
+      __m128i bytes = _mm_loadu_si128((const __m128i *)(src + i + tap * stride));
+      for (size_t part = 0; part < 4; part++) {
+        sums[part] = _mm_add_ps(sums[part], _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(bytes)), w));
+        bytes = _mm_srli_si128(bytes, 4);
+      }
+    }
+    for (size_t part = 0; part < 4; part++) {
+      _mm_storeu_ps(acc + i + part * 4, sums[part]);
+    }
+  }
+  homv_row_u8_scalar(acc + i, src + i, weights, taps, stride, count - i);
+}
+
+__attribute__((target("sse4.1"))) HOMV_SIMD_INLINE void homv_row_i16_sse41(int16_t *acc, const uint8_t *src,
+                                                                           const int16_t *weights, size_t taps,
+                                                                           size_t stride, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i first = _mm_loadu_si128((const __m128i *)(acc + i));
+    __m128i second = _mm_loadu_si128((const __m128i *)(acc + i + 8));
+#pragma GCC unroll 16
+    for (size_t tap = 0; tap < taps; tap++) {
+      __m128i w = _mm_set1_epi16(weights[tap]);
+      __m128i bytes = _mm_loadu_si128((const __m128i *)(src + i + tap * stride));
+      first = _mm_add_epi16(first, _mm_mullo_epi16(_mm_cvtepu8_epi16(bytes), w));
+      second = _mm_add_epi16(second, _mm_mullo_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(bytes, 8)), w));
+    }
+    _mm_storeu_si128((__m128i *)(acc + i), first);
+    _mm_storeu_si128((__m128i *)(acc + i + 8), second);
+  }
+  homv_row_i16_scalar(acc + i, src + i, weights, taps, stride, count - i);
+}
+
+#define HOMV_ROW_U8_SSE41(taps, stride) homv_row_u8_sse41(acc, src, weights, taps, stride, count)
+__attribute__((target("sse4.1"))) static void homv_madd_row_u8_sse41(float *acc, const uint8_t *src,
+                                                                     const float *weights, size_t taps, size_t stride,
+                                                                     size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_ROW_U8_SSE41, taps, stride);
+}
+
+#define HOMV_ROW_I16_SSE41(taps, stride) homv_row_i16_sse41(acc, src, weights, taps, stride, count)
+__attribute__((target("sse4.1"))) static void homv_madd_row_i16_sse41(int16_t *acc, const uint8_t *src,
+                                                                      const int16_t *weights, size_t taps,
+                                                                      size_t stride, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_ROW_I16_SSE41, taps, stride);
+}
+
+__attribute__((target("avx2,fma"))) HOMV_SIMD_INLINE void homv_row_u8_avx2(float *acc, const uint8_t *src,
+                                                                           const float *weights, size_t taps,
+                                                                           size_t stride, size_t count) {
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256 sums[4];
+    for (size_t part = 0; part < 4; part++) {
+      sums[part] = _mm256_loadu_ps(acc + i + part * 8);
+    }
+#pragma GCC unroll 16
+    for (size_t tap = 0; tap < taps; tap++) {
+      __m256 w = _mm256_set1_ps(weights[tap]);
+      for (size_t part = 0; part < 4; part++) {
+        __m128i bytes = _mm_loadl_epi64((const __m128i *)(src + i + tap * stride + part * 8));
+        sums[part] = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)), w, sums[part]);
+      }
+    }
+    for (size_t part = 0; part < 4; part++) {
+      _mm256_storeu_ps(acc + i + part * 8, sums[part]);
+    }
+  }
+  homv_row_u8_fma(acc + i, src + i, weights, taps, stride, count - i);
+}
+
+__attribute__((target("avx2,fma"))) HOMV_SIMD_INLINE void homv_row_i16_avx2(int16_t *acc, const uint8_t *src,
+                                                                            const int16_t *weights, size_t taps,
+                                                                            size_t stride, size_t count) {
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i first = _mm256_loadu_si256((const __m256i *)(acc + i));
+    __m256i second = _mm256_loadu_si256((const __m256i *)(acc + i + 16));
+#pragma GCC unroll 16
+    for (size_t tap = 0; tap < taps; tap++) {
+      __m256i w = _mm256_set1_epi16(weights[tap]);
+      __m256i bytes = _mm256_loadu_si256((const __m256i *)(src + i + tap * stride));
+      first = _mm256_add_epi16(first, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)), w));
+      second =
+          _mm256_add_epi16(second, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)), w));
+    }
+    _mm256_storeu_si256((__m256i *)(acc + i), first);
+    _mm256_storeu_si256((__m256i *)(acc + i + 16), second);
+  }
+  homv_row_i16_scalar(acc + i, src + i, weights, taps, stride, count - i);
+}
+
+#define HOMV_ROW_U8_AVX2(taps, stride) homv_row_u8_avx2(acc, src, weights, taps, stride, count)
+__attribute__((target("avx2,fma"))) static void homv_madd_row_u8_avx2(float *acc, const uint8_t *src,
+                                                                      const float *weights, size_t taps, size_t stride,
+                                                                      size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_ROW_U8_AVX2, taps, stride);
+}
+
+#define HOMV_ROW_I16_AVX2(taps, stride) homv_row_i16_avx2(acc, src, weights, taps, stride, count)
+__attribute__((target("avx2,fma"))) static void homv_madd_row_i16_avx2(int16_t *acc, const uint8_t *src,
+                                                                       const int16_t *weights, size_t taps,
+                                                                       size_t stride, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_ROW_I16_AVX2, taps, stride);
+}
+
+__attribute__((target("avx512f,fma"))) HOMV_SIMD_INLINE void homv_row_u8_avx512(float *acc, const uint8_t *src,
+                                                                               const float *weights, size_t taps,
+                                                                               size_t stride, size_t count) {
+  size_t i = 0;
+  for (; i + 64 <= count; i += 64) {
+    __m512 sums[4];
+    for (size_t part = 0; part < 4; part++) {
+      sums[part] = _mm512_loadu_ps(acc + i + part * 16);
+    }
+#pragma GCC unroll 16
+    for (size_t tap = 0; tap < taps; tap++) {
+      __m512 w = _mm512_set1_ps(weights[tap]);
+      for (size_t part = 0; part < 4; part++) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(src + i + tap * stride + part * 16));
+        sums[part] = _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(bytes)), w, sums[part]);
+      }
+    }
+    for (size_t part = 0; part < 4; part++) {
+      _mm512_storeu_ps(acc + i + part * 16, sums[part]);
+    }
+  }
+  homv_row_u8_fma(acc + i, src + i, weights, taps, stride, count - i);
+}
+
+__attribute__((target("avx512f,avx512bw"))) HOMV_SIMD_INLINE void homv_row_i16_avx512(int16_t *acc, const uint8_t *src,
+                                                                                      const int16_t *weights,
+                                                                                      size_t taps, size_t stride,
+                                                                                      size_t count) {
+  size_t i = 0;
+  for (; i + 64 <= count; i += 64) {
+    __m512i first = _mm512_loadu_si512(acc + i);
+    __m512i second = _mm512_loadu_si512(acc + i + 32);
+#pragma GCC unroll 16
+    for (size_t tap = 0; tap < taps; tap++) {
+      __m512i w = _mm512_set1_epi16(weights[tap]);
+      const uint8_t *tap_src = src + i + tap * stride;
+      first = _mm512_add_epi16(
+          first, _mm512_mullo_epi16(_mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)tap_src)), w));
+      second = _mm512_add_epi16(
+          second, _mm512_mullo_epi16(_mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(tap_src + 32))), w));
+    }
+    _mm512_storeu_si512(acc + i, first);
+    _mm512_storeu_si512(acc + i + 32, second);
+  }
+  homv_row_i16_scalar(acc + i, src + i, weights, taps, stride, count - i);
+}
+
+#define HOMV_ROW_U8_AVX512(taps, stride) homv_row_u8_avx512(acc, src, weights, taps, stride, count)
+__attribute__((target("avx512f,fma"))) static void homv_madd_row_u8_avx512(float *acc, const uint8_t *src,
+                                                                          const float *weights, size_t taps,
+                                                                          size_t stride, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_ROW_U8_AVX512, taps, stride);
+}
+
+#define HOMV_ROW_I16_AVX512(taps, stride) homv_row_i16_avx512(acc, src, weights, taps, stride, count)
+__attribute__((target("avx512f,avx512bw"))) static void homv_madd_row_i16_avx512(int16_t *acc, const uint8_t *src,
+                                                                                const int16_t *weights, size_t taps,
+                                                                                size_t stride, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_ROW_I16_AVX512, taps, stride);
+}
+
+// Start of SIMD chunk of width values at i. Last chunk is moved back to end of row, so it overlaps previous one
+// and rows of at least width values need no scalar tail. Overlapped values are computed again from the same
+// input, so functions using it must not write to their input rows. Narrow rows of one channel images would
+// otherwise spend large part of time in scalar tails
+static inline size_t homv_simd_chunk(size_t i, size_t width, size_t count) {
+  return i + width <= count ? i : count - width;
+}
+
+// Block functions convolve up to HOMV_SIMD_BLOCK_ROWS output rows at once: dst[row] gets sum of
+// weights[ky * taps + tap] * src[row + ky][i + tap * stride], rounded and saturated like store_u8 and store_i16.
+// Sums of all rows stay in registers, every input vector is loaded and widened once and added to every
+// output row it belongs to. For every value taps are added in the same order as by row functions,
+// so values do not depend on how many rows are in block
+
+HOMV_SIMD_INLINE void homv_block_u8_scalar(uint8_t *const *dst, const uint8_t *const *src, const float *weights,
+                                           size_t taps, size_t stride, size_t rows, size_t begin, size_t count) {
+  for (size_t i = begin; i < count; i++) {
+    float sums[HOMV_SIMD_BLOCK_ROWS] = {0};
+    for (size_t row = 0; row < rows; row++) {
+      for (size_t ky = 0; ky < taps; ky++) {
+#pragma GCC unroll 16
+        for (size_t tap = 0; tap < taps; tap++) {
+          sums[row] += weights[ky * taps + tap] * src[row + ky][i + tap * stride];
+        }
+      }
+      dst[row][i] = homv_simd_pixel(sums[row]);
+    }
+  }
+}
+
+HOMV_SIMD_INLINE void homv_block_u8_fma(uint8_t *const *dst, const uint8_t *const *src, const float *weights,
+                                        size_t taps, size_t stride, size_t rows, size_t begin, size_t count) {
+  for (size_t i = begin; i < count; i++) {
+    for (size_t row = 0; row < rows; row++) {
+      float sum = 0;
+      for (size_t ky = 0; ky < taps; ky++) {
+#pragma GCC unroll 16
+        for (size_t tap = 0; tap < taps; tap++) {
+          sum = fmaf((float)src[row + ky][i + tap * stride], weights[ky * taps + tap], sum);
+        }
+      }
+      dst[row][i] = homv_simd_pixel(sum);
+    }
+  }
+}
+
+HOMV_SIMD_INLINE void homv_block_i16_scalar(uint8_t *const *dst, const uint8_t *const *src, const int16_t *weights,
+                                            size_t taps, size_t stride, int16_t multiplier, size_t rows, size_t begin,
+                                            size_t count) {
+  for (size_t i = begin; i < count; i++) {
+    for (size_t row = 0; row < rows; row++) {
+      int16_t sum = 0;
+      for (size_t ky = 0; ky < taps; ky++) {
+#pragma GCC unroll 16
+        for (size_t tap = 0; tap < taps; tap++) {
+          sum += weights[ky * taps + tap] * src[row + ky][i + tap * stride];
+        }
+      }
+      homv_store_i16_scalar(dst[row] + i, &sum, multiplier, 1);
+    }
+  }
+}
+
+#define HOMV_BLOCK_U8_SCALAR(taps, stride) homv_block_u8_scalar(dst, src, weights, taps, stride, rows, 0, count)
+static void homv_convolve_u8_scalar(uint8_t *const *dst, const uint8_t *const *src, const float *weights, size_t taps,
+                                    size_t stride, size_t rows, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_BLOCK_U8_SCALAR, taps, stride);
+}
+
+#define HOMV_BLOCK_I16_SCALAR(taps, stride)                                                                            \
+  homv_block_i16_scalar(dst, src, weights, taps, stride, multiplier, rows, 0, count)
+static void homv_convolve_i16_scalar(uint8_t *const *dst, const uint8_t *const *src, const int16_t *weights,
+                                     size_t taps, size_t stride, int16_t multiplier, size_t rows, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_BLOCK_I16_SCALAR, taps, stride);
+}
+
+// SSE4.1: 8 values of 4 rows in 8 registers
+__attribute__((target("sse4.1"))) HOMV_SIMD_INLINE void homv_block_u8_sse41(uint8_t *const *dst,
+                                                                            const uint8_t *const *src,
+                                                                            const float *weights, size_t taps,
+                                                                            size_t stride, size_t rows, size_t count) {
+  __m128 low = _mm_setzero_ps();
+  __m128 high = _mm_set1_ps(255);
+  __m128 half = _mm_set1_ps(0.5f);
+  size_t i = 0;
+  for (; count >= 8 && i < count; i += 8) {
+    i = homv_simd_chunk(i, 8, count);
+    __m128 sums[HOMV_SIMD_BLOCK_ROWS][2];
+    for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+      sums[row][0] = sums[row][1] = _mm_setzero_ps();
+    }
+    for (size_t line = 0; line < rows + taps - 1; line++) {
+#pragma GCC unroll 16
+      for (size_t tap = 0; tap < taps; tap++) {
+        __m128i bytes = _mm_loadl_epi64((const __m128i *)(src[line] + i + tap * stride));
+        __m128 first = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(bytes));
+        __m128 second = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)));
+#pragma GCC unroll 4
+        for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+          if (line >= row && line - row < taps) {
+            __m128 w = _mm_set1_ps(weights[(line - row) * taps + tap]);
+            sums[row][0] = _mm_add_ps(sums[row][0], _mm_mul_ps(first, w));
+            sums[row][1] = _mm_add_ps(sums[row][1], _mm_mul_ps(second, w));
+          }
+        }
+      }
+    }
+    for (size_t row = 0; row < rows; row++) {
+      __m128i first = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(sums[row][0], low), high), half));
+      __m128i second = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(sums[row][1], low), high), half));
+      __m128i words = _mm_packs_epi32(first, second);
+      _mm_storel_epi64((__m128i *)(dst[row] + i), _mm_packus_epi16(words, words));
+    }
+  }
+  homv_block_u8_scalar(dst, src, weights, taps, stride, rows, i, count);
+}
+
+__attribute__((target("sse4.1"))) HOMV_SIMD_INLINE void
+homv_block_i16_sse41(uint8_t *const *dst, const uint8_t *const *src, const int16_t *weights, size_t taps,
+                     size_t stride, int16_t multiplier, size_t rows, size_t count) {
+  __m128i m = _mm_set1_epi16(multiplier);
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+    __m128i sums[HOMV_SIMD_BLOCK_ROWS][2];
+    for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+      sums[row][0] = sums[row][1] = _mm_setzero_si128();
+    }
+    for (size_t line = 0; line < rows + taps - 1; line++) {
+#pragma GCC unroll 16
+      for (size_t tap = 0; tap < taps; tap++) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(src[line] + i + tap * stride));
+        __m128i first = _mm_cvtepu8_epi16(bytes);
+        __m128i second = _mm_cvtepu8_epi16(_mm_srli_si128(bytes, 8));
+#pragma GCC unroll 4
+        for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+          if (line >= row && line - row < taps) {
+            __m128i w = _mm_set1_epi16(weights[(line - row) * taps + tap]);
+            sums[row][0] = _mm_add_epi16(sums[row][0], _mm_mullo_epi16(first, w));
+            sums[row][1] = _mm_add_epi16(sums[row][1], _mm_mullo_epi16(second, w));
+          }
+        }
+      }
+    }
+    for (size_t row = 0; row < rows; row++) {
+      if (multiplier) {
+        sums[row][0] = _mm_mulhrs_epi16(sums[row][0], m);
+        sums[row][1] = _mm_mulhrs_epi16(sums[row][1], m);
+      }
+      _mm_storeu_si128((__m128i *)(dst[row] + i), _mm_packus_epi16(sums[row][0], sums[row][1]));
+    }
+  }
+  homv_block_i16_scalar(dst, src, weights, taps, stride, multiplier, rows, i, count);
+}
+
+#define HOMV_BLOCK_U8_SSE41(taps, stride) homv_block_u8_sse41(dst, src, weights, taps, stride, rows, count)
+__attribute__((target("sse4.1"))) static void homv_convolve_u8_sse41(uint8_t *const *dst, const uint8_t *const *src,
+                                                                     const float *weights, size_t taps, size_t stride,
+                                                                     size_t rows, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_BLOCK_U8_SSE41, taps, stride);
+}
+
+#define HOMV_BLOCK_I16_SSE41(taps, stride)                                                                             \
+  homv_block_i16_sse41(dst, src, weights, taps, stride, multiplier, rows, count)
+__attribute__((target("sse4.1"))) static void homv_convolve_i16_sse41(uint8_t *const *dst, const uint8_t *const *src,
+                                                                      const int16_t *weights, size_t taps,
+                                                                      size_t stride, int16_t multiplier, size_t rows,
+                                                                      size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_BLOCK_I16_SSE41, taps, stride);
+}
+
+// AVX2: 16 values of 4 rows in 8 registers, floats are narrowed to bytes in 128-bit halves to keep order
+__attribute__((target("avx2,fma"))) HOMV_SIMD_INLINE void homv_block_u8_avx2(uint8_t *const *dst,
+                                                                             const uint8_t *const *src,
+                                                                             const float *weights, size_t taps,
+                                                                             size_t stride, size_t rows, size_t count) {
+  __m256 low = _mm256_setzero_ps();
+  __m256 high = _mm256_set1_ps(255);
+  __m256 half = _mm256_set1_ps(0.5f);
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+    __m256 sums[HOMV_SIMD_BLOCK_ROWS][2];
+    for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+      sums[row][0] = sums[row][1] = _mm256_setzero_ps();
+    }
+    for (size_t line = 0; line < rows + taps - 1; line++) {
+#pragma GCC unroll 16
+      for (size_t tap = 0; tap < taps; tap++) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(src[line] + i + tap * stride));
+        __m256 first = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+        __m256 second = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+#pragma GCC unroll 4
+        for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+          if (line >= row && line - row < taps) {
+            __m256 w = _mm256_set1_ps(weights[(line - row) * taps + tap]);
+            sums[row][0] = _mm256_fmadd_ps(first, w, sums[row][0]);
+            sums[row][1] = _mm256_fmadd_ps(second, w, sums[row][1]);
+          }
+        }
+      }
+    }
+    for (size_t row = 0; row < rows; row++) {
+      __m256i first = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_min_ps(_mm256_max_ps(sums[row][0], low), high), half));
+      __m256i second = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_min_ps(_mm256_max_ps(sums[row][1], low), high), half));
+      __m128i words_first = _mm_packs_epi32(_mm256_castsi256_si128(first), _mm256_extracti128_si256(first, 1));
+      __m128i words_second = _mm_packs_epi32(_mm256_castsi256_si128(second), _mm256_extracti128_si256(second, 1));
+      _mm_storeu_si128((__m128i *)(dst[row] + i), _mm_packus_epi16(words_first, words_second));
+    }
+  }
+  homv_block_u8_fma(dst, src, weights, taps, stride, rows, i, count);
+}
+
+__attribute__((target("avx2,fma"))) HOMV_SIMD_INLINE void
+homv_block_i16_avx2(uint8_t *const *dst, const uint8_t *const *src, const int16_t *weights, size_t taps, size_t stride,
+                    int16_t multiplier, size_t rows, size_t count) {
+  __m256i m = _mm256_set1_epi16(multiplier);
+  size_t i = 0;
+  for (; count >= 32 && i < count; i += 32) {
+    i = homv_simd_chunk(i, 32, count);
+    __m256i sums[HOMV_SIMD_BLOCK_ROWS][2];
+    for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+      sums[row][0] = sums[row][1] = _mm256_setzero_si256();
+    }
+    for (size_t line = 0; line < rows + taps - 1; line++) {
+#pragma GCC unroll 16
+      for (size_t tap = 0; tap < taps; tap++) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(src[line] + i + tap * stride));
+        __m256i first = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes));
+        __m256i second = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1));
+#pragma GCC unroll 4
+        for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+          if (line >= row && line - row < taps) {
+            __m256i w = _mm256_set1_epi16(weights[(line - row) * taps + tap]);
+            sums[row][0] = _mm256_add_epi16(sums[row][0], _mm256_mullo_epi16(first, w));
+            sums[row][1] = _mm256_add_epi16(sums[row][1], _mm256_mullo_epi16(second, w));
+          }
+        }
+      }
+    }
+    for (size_t row = 0; row < rows; row++) {
+      if (multiplier) {
+        sums[row][0] = _mm256_mulhrs_epi16(sums[row][0], m);
+        sums[row][1] = _mm256_mulhrs_epi16(sums[row][1], m);
+      }
+      __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(sums[row][0], sums[row][1]), 0xD8);
+      _mm256_storeu_si256((__m256i *)(dst[row] + i), bytes);
+    }
+  }
+  homv_block_i16_scalar(dst, src, weights, taps, stride, multiplier, rows, i, count);
+}
+
+#define HOMV_BLOCK_U8_AVX2(taps, stride) homv_block_u8_avx2(dst, src, weights, taps, stride, rows, count)
+__attribute__((target("avx2,fma"))) static void homv_convolve_u8_avx2(uint8_t *const *dst, const uint8_t *const *src,
+                                                                      const float *weights, size_t taps, size_t stride,
+                                                                      size_t rows, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_BLOCK_U8_AVX2, taps, stride);
+}
+
+#define HOMV_BLOCK_I16_AVX2(taps, stride) homv_block_i16_avx2(dst, src, weights, taps, stride, multiplier, rows, count)
+__attribute__((target("avx2,fma"))) static void homv_convolve_i16_avx2(uint8_t *const *dst, const uint8_t *const *src,
+                                                                       const int16_t *weights, size_t taps,
+                                                                       size_t stride, int16_t multiplier, size_t rows,
+                                                                       size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_BLOCK_I16_AVX2, taps, stride);
+}
+
+// AVX-512: 32 values of 4 rows in 8 registers
+__attribute__((target("avx512f,fma"))) HOMV_SIMD_INLINE void
+homv_block_u8_avx512(uint8_t *const *dst, const uint8_t *const *src, const float *weights, size_t taps, size_t stride,
+                     size_t rows, size_t count) {
+  __m512 low = _mm512_setzero_ps();
+  __m512 high = _mm512_set1_ps(255);
+  __m512 half = _mm512_set1_ps(0.5f);
+  size_t i = 0;
+  for (; count >= 32 && i < count; i += 32) {
+    i = homv_simd_chunk(i, 32, count);
+    __m512 sums[HOMV_SIMD_BLOCK_ROWS][2];
+    for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+      sums[row][0] = sums[row][1] = _mm512_setzero_ps();
+    }
+    for (size_t line = 0; line < rows + taps - 1; line++) {
+#pragma GCC unroll 16
+      for (size_t tap = 0; tap < taps; tap++) {
+        const uint8_t *tap_src = src[line] + i + tap * stride;
+        __m512 first = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)tap_src)));
+        __m512 second = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(tap_src + 16))));
+#pragma GCC unroll 4
+        for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+          if (line >= row && line - row < taps) {
+            __m512 w = _mm512_set1_ps(weights[(line - row) * taps + tap]);
+            sums[row][0] = _mm512_fmadd_ps(first, w, sums[row][0]);
+            sums[row][1] = _mm512_fmadd_ps(second, w, sums[row][1]);
+          }
+        }
+      }
+    }
+    for (size_t row = 0; row < rows; row++) {
+      for (size_t part = 0; part < 2; part++) {
+        __m512 values = _mm512_min_ps(_mm512_max_ps(sums[row][part], low), high);
+        __m128i bytes = _mm512_cvtusepi32_epi8(_mm512_cvttps_epi32(_mm512_add_ps(values, half)));
+        _mm_storeu_si128((__m128i *)(dst[row] + i + part * 16), bytes);
+      }
+    }
+  }
+  homv_block_u8_fma(dst, src, weights, taps, stride, rows, i, count);
+}
+
+__attribute__((target("avx512f,avx512bw"))) HOMV_SIMD_INLINE void
+homv_block_i16_avx512(uint8_t *const *dst, const uint8_t *const *src, const int16_t *weights, size_t taps,
+                      size_t stride, int16_t multiplier, size_t rows, size_t count) {
+  __m512i m = _mm512_set1_epi16(multiplier);
+  __m512i zero = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; count >= 64 && i < count; i += 64) {
+    i = homv_simd_chunk(i, 64, count);
+    __m512i sums[HOMV_SIMD_BLOCK_ROWS][2];
+    for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+      sums[row][0] = sums[row][1] = _mm512_setzero_si512();
+    }
+    for (size_t line = 0; line < rows + taps - 1; line++) {
+#pragma GCC unroll 16
+      for (size_t tap = 0; tap < taps; tap++) {
+        const uint8_t *tap_src = src[line] + i + tap * stride;
+        __m512i first = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)tap_src));
+        __m512i second = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(tap_src + 32)));
+#pragma GCC unroll 4
+        for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+          if (line >= row && line - row < taps) {
+            __m512i w = _mm512_set1_epi16(weights[(line - row) * taps + tap]);
+            sums[row][0] = _mm512_add_epi16(sums[row][0], _mm512_mullo_epi16(first, w));
+            sums[row][1] = _mm512_add_epi16(sums[row][1], _mm512_mullo_epi16(second, w));
+          }
+        }
+      }
+    }
+    for (size_t row = 0; row < rows; row++) {
+      for (size_t part = 0; part < 2; part++) {
+        __m512i values = multiplier ? _mm512_mulhrs_epi16(sums[row][part], m) : sums[row][part];
+        __m256i bytes = _mm512_cvtusepi16_epi8(_mm512_max_epi16(values, zero));
+        _mm256_storeu_si256((__m256i *)(dst[row] + i + part * 32), bytes);
+      }
+    }
+  }
+  homv_block_i16_scalar(dst, src, weights, taps, stride, multiplier, rows, i, count);
+}
+
+#define HOMV_BLOCK_U8_AVX512(taps, stride) homv_block_u8_avx512(dst, src, weights, taps, stride, rows, count)
+__attribute__((target("avx512f,fma"))) static void homv_convolve_u8_avx512(uint8_t *const *dst,
+                                                                          const uint8_t *const *src,
+                                                                          const float *weights, size_t taps,
+                                                                          size_t stride, size_t rows, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_BLOCK_U8_AVX512, taps, stride);
+}
+
+#define HOMV_BLOCK_I16_AVX512(taps, stride)                                                                            \
+  homv_block_i16_avx512(dst, src, weights, taps, stride, multiplier, rows, count)
+__attribute__((target("avx512f,avx512bw"))) static void
+homv_convolve_i16_avx512(uint8_t *const *dst, const uint8_t *const *src, const int16_t *weights, size_t taps,
+                         size_t stride, int16_t multiplier, size_t rows, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_BLOCK_I16_AVX512, taps, stride);
+}
+
+// Sparse kernels: sums of one chunk stay in registers while taps are added, 1 and -1 taps need no multiply.
+// Values from begin to count, SIMD variants finish their rows with it
+HOMV_SIMD_INLINE void homv_sparse_i16_scalar(uint8_t *dst, const uint8_t *const *src, const homv_tap *taps,
+                                             size_t taps_count, size_t stride, int16_t multiplier, size_t begin,
+                                             size_t count) {
+  for (size_t i = begin; i < count; i++) {
+    int16_t sum = 0;
+    for (size_t t = 0; t < taps_count; t++) {
+      sum += taps[t].weight * src[taps[t].dy][i + taps[t].dx * stride];
+    }
+    homv_store_i16_scalar(dst + i, &sum, multiplier, 1);
+  }
+}
+
+static void homv_convolve_sparse_i16_scalar(uint8_t *dst, const uint8_t *const *src, const homv_tap *taps,
+                                            size_t taps_count, size_t stride, int16_t multiplier, size_t count) {
+  homv_sparse_i16_scalar(dst, src, taps, taps_count, stride, multiplier, 0, count);
+}
+
+__attribute__((target("sse4.1"))) static void homv_convolve_sparse_i16_sse41(uint8_t *dst, const uint8_t *const *src,
+                                                                             const homv_tap *taps, size_t taps_count,
+                                                                             size_t stride, int16_t multiplier,
+                                                                             size_t count) {
+  __m128i m = _mm_set1_epi16(multiplier);
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+    __m128i first = _mm_setzero_si128();
+    __m128i second = _mm_setzero_si128();
+    for (size_t t = 0; t < taps_count; t++) {
+      __m128i bytes = _mm_loadu_si128((const __m128i *)(src[taps[t].dy] + i + taps[t].dx * stride));
+      __m128i low = _mm_cvtepu8_epi16(bytes);
+      __m128i high = _mm_cvtepu8_epi16(_mm_srli_si128(bytes, 8));
+      if (taps[t].weight == 1) {
+        first = _mm_add_epi16(first, low);
+        second = _mm_add_epi16(second, high);
+      } else if (taps[t].weight == -1) {
+        first = _mm_sub_epi16(first, low);
+        second = _mm_sub_epi16(second, high);
+      } else {
+        __m128i w = _mm_set1_epi16(taps[t].weight);
+        first = _mm_add_epi16(first, _mm_mullo_epi16(low, w));
+        second = _mm_add_epi16(second, _mm_mullo_epi16(high, w));
+      }
+    }
+    if (multiplier) {
+      first = _mm_mulhrs_epi16(first, m);
+      second = _mm_mulhrs_epi16(second, m);
+    }
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(first, second));
+  }
+  homv_sparse_i16_scalar(dst, src, taps, taps_count, stride, multiplier, i, count);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_convolve_sparse_i16_avx2(uint8_t *dst, const uint8_t *const *src,
+                                                                              const homv_tap *taps, size_t taps_count,
+                                                                              size_t stride, int16_t multiplier,
+                                                                              size_t count) {
+  __m256i m = _mm256_set1_epi16(multiplier);
+  size_t i = 0;
+  for (; count >= 32 && i < count; i += 32) {
+    i = homv_simd_chunk(i, 32, count);
+    __m256i first = _mm256_setzero_si256();
+    __m256i second = _mm256_setzero_si256();
+    for (size_t t = 0; t < taps_count; t++) {
+      __m256i bytes = _mm256_loadu_si256((const __m256i *)(src[taps[t].dy] + i + taps[t].dx * stride));
+      __m256i low = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes));
+      __m256i high = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1));
+      if (taps[t].weight == 1) {
+        first = _mm256_add_epi16(first, low);
+        second = _mm256_add_epi16(second, high);
+      } else if (taps[t].weight == -1) {
+        first = _mm256_sub_epi16(first, low);
+        second = _mm256_sub_epi16(second, high);
+      } else {
+        __m256i w = _mm256_set1_epi16(taps[t].weight);
+        first = _mm256_add_epi16(first, _mm256_mullo_epi16(low, w));
+        second = _mm256_add_epi16(second, _mm256_mullo_epi16(high, w));
+      }
+    }
+    if (multiplier) {
+      first = _mm256_mulhrs_epi16(first, m);
+      second = _mm256_mulhrs_epi16(second, m);
+    }
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), 0xD8));
+  }
+  homv_sparse_i16_scalar(dst, src, taps, taps_count, stride, multiplier, i, count);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void
+homv_convolve_sparse_i16_avx512(uint8_t *dst, const uint8_t *const *src, const homv_tap *taps, size_t taps_count,
+                                size_t stride, int16_t multiplier, size_t count) {
+  __m512i m = _mm512_set1_epi16(multiplier);
+  __m512i zero = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; count >= 64 && i < count; i += 64) {
+    i = homv_simd_chunk(i, 64, count);
+    __m512i sums[2] = {zero, zero};
+    for (size_t t = 0; t < taps_count; t++) {
+      const uint8_t *tap_src = src[taps[t].dy] + i + taps[t].dx * stride;
+      __m512i w = _mm512_set1_epi16(taps[t].weight);
+      for (size_t part = 0; part < 2; part++) {
+        __m512i values = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(tap_src + part * 32)));
+        if (taps[t].weight == 1) {
+          sums[part] = _mm512_add_epi16(sums[part], values);
+        } else if (taps[t].weight == -1) {
+          sums[part] = _mm512_sub_epi16(sums[part], values);
+        } else {
+          sums[part] = _mm512_add_epi16(sums[part], _mm512_mullo_epi16(values, w));
+        }
+      }
+    }
+    for (size_t part = 0; part < 2; part++) {
+      __m512i values = multiplier ? _mm512_mulhrs_epi16(sums[part], m) : sums[part];
+      _mm256_storeu_si256((__m256i *)(dst + i + part * 32), _mm512_cvtusepi16_epi8(_mm512_max_epi16(values, zero)));
+    }
+  }
+  homv_sparse_i16_scalar(dst, src, taps, taps_count, stride, multiplier, i, count);
+}
+
+// Kernels symmetric about vertical axis: for every input row of block mirrored taps are added or subtracted once,
+// converted once and multiplied by the common tap for every output row, so there are half of multiplies and
+// conversions of convolve_u8. Middle tap of odd kernel is alone, it is zero if kernel is antisymmetric
+HOMV_SIMD_INLINE void homv_block_fold_scalar(uint8_t *const *dst, const uint8_t *const *src, const float *weights,
+                                             size_t taps, size_t stride, float sign, size_t rows, size_t begin,
+                                             size_t count) {
+  size_t folded = taps / 2 + (taps % 2 && sign > 0);
+  for (size_t i = begin; i < count; i++) {
+    for (size_t row = 0; row < rows; row++) {
+      float sum = 0;
+      for (size_t ky = 0; ky < taps; ky++) {
+        const uint8_t *line = src[row + ky] + i;
+#pragma GCC unroll 16
+        for (size_t tap = 0; tap < folded; tap++) {
+          float pair = line[tap * stride];
+          if (tap < taps / 2) {
+            pair += sign * line[(taps - 1 - tap) * stride];
+          }
+          sum += weights[ky * taps + tap] * pair;
+        }
+      }
+      dst[row][i] = homv_simd_pixel(sum);
+    }
+  }
+}
+
+HOMV_SIMD_INLINE void homv_block_fold_fma(uint8_t *const *dst, const uint8_t *const *src, const float *weights,
+                                          size_t taps, size_t stride, float sign, size_t rows, size_t begin,
+                                          size_t count) {
+  size_t folded = taps / 2 + (taps % 2 && sign > 0);
+  for (size_t i = begin; i < count; i++) {
+    for (size_t row = 0; row < rows; row++) {
+      float sum = 0;
+      for (size_t ky = 0; ky < taps; ky++) {
+        const uint8_t *line = src[row + ky] + i;
+#pragma GCC unroll 16
+        for (size_t tap = 0; tap < folded; tap++) {
+          float pair = line[tap * stride];
+          if (tap < taps / 2) {
+            pair += sign * line[(taps - 1 - tap) * stride];
+          }
+          sum = fmaf(pair, weights[ky * taps + tap], sum);
+        }
+      }
+      dst[row][i] = homv_simd_pixel(sum);
+    }
+  }
+}
+
+#define HOMV_BLOCK_FOLD_SCALAR(taps, stride)                                                                           \
+  homv_block_fold_scalar(dst, src, weights, taps, stride, sign, rows, 0, count)
+static void homv_convolve_fold_u8_scalar(uint8_t *const *dst, const uint8_t *const *src, const float *weights,
+                                         size_t taps, size_t stride, float sign, size_t rows, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_BLOCK_FOLD_SCALAR, taps, stride);
+}
+
+// 8 pairs of tap and its mirror as two vectors of 4 floats
+__attribute__((target("sse4.1"))) HOMV_SIMD_INLINE void homv_fold_sse41(__m128 values[2], const uint8_t *line,
+                                                                        size_t tap, size_t taps, size_t stride,
+                                                                        float sign) {
+  __m128i words = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(line + tap * stride)));
+  if (tap < taps / 2) {
+    __m128i mirror = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(line + (taps - 1 - tap) * stride)));
+    words = sign > 0 ? _mm_add_epi16(words, mirror) : _mm_sub_epi16(words, mirror);
+  }
+  values[0] = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(words));
+  values[1] = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(words, 8)));
+}
+
+__attribute__((target("sse4.1"))) HOMV_SIMD_INLINE void homv_block_fold_sse41(uint8_t *const *dst,
+                                                                              const uint8_t *const *src,
+                                                                              const float *weights, size_t taps,
+                                                                              size_t stride, float sign, size_t rows,
+                                                                              size_t count) {
+  __m128 low = _mm_setzero_ps();
+  __m128 high = _mm_set1_ps(255);
+  __m128 half = _mm_set1_ps(0.5f);
+  size_t folded = taps / 2 + (taps % 2 && sign > 0);
+  size_t i = 0;
+  for (; count >= 8 && i < count; i += 8) {
+    i = homv_simd_chunk(i, 8, count);
+    __m128 sums[HOMV_SIMD_BLOCK_ROWS][2];
+    for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+      sums[row][0] = sums[row][1] = _mm_setzero_ps();
+    }
+    for (size_t line = 0; line < rows + taps - 1; line++) {
+#pragma GCC unroll 16
+      for (size_t tap = 0; tap < folded; tap++) {
+        __m128 values[2];
+        homv_fold_sse41(values, src[line] + i, tap, taps, stride, sign);
+#pragma GCC unroll 4
+        for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+          if (line >= row && line - row < taps) {
+            __m128 w = _mm_set1_ps(weights[(line - row) * taps + tap]);
+            sums[row][0] = _mm_add_ps(sums[row][0], _mm_mul_ps(values[0], w));
+            sums[row][1] = _mm_add_ps(sums[row][1], _mm_mul_ps(values[1], w));
+          }
+        }
+      }
+    }
+    for (size_t row = 0; row < rows; row++) {
+      __m128i first = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(sums[row][0], low), high), half));
+      __m128i second = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(sums[row][1], low), high), half));
+      __m128i words = _mm_packs_epi32(first, second);
+      _mm_storel_epi64((__m128i *)(dst[row] + i), _mm_packus_epi16(words, words));
+    }
+  }
+  homv_block_fold_scalar(dst, src, weights, taps, stride, sign, rows, i, count);
+}
+
+#define HOMV_BLOCK_FOLD_SSE41(taps, stride) homv_block_fold_sse41(dst, src, weights, taps, stride, sign, rows, count)
+__attribute__((target("sse4.1"))) static void homv_convolve_fold_u8_sse41(uint8_t *const *dst,
+                                                                          const uint8_t *const *src,
+                                                                          const float *weights, size_t taps,
+                                                                          size_t stride, float sign, size_t rows,
+                                                                          size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_BLOCK_FOLD_SSE41, taps, stride);
+}
+
+// 16 pairs as two vectors of 8 floats
+__attribute__((target("avx2,fma"))) HOMV_SIMD_INLINE void homv_fold_avx2(__m256 values[2], const uint8_t *line,
+                                                                         size_t tap, size_t taps, size_t stride,
+                                                                         float sign) {
+  __m256i words = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(line + tap * stride)));
+  if (tap < taps / 2) {
+    __m256i mirror = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(line + (taps - 1 - tap) * stride)));
+    words = sign > 0 ? _mm256_add_epi16(words, mirror) : _mm256_sub_epi16(words, mirror);
+  }
+  values[0] = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(words)));
+  values[1] = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(words, 1)));
+}
+
+__attribute__((target("avx2,fma"))) HOMV_SIMD_INLINE void homv_block_fold_avx2(uint8_t *const *dst,
+                                                                               const uint8_t *const *src,
+                                                                               const float *weights, size_t taps,
+                                                                               size_t stride, float sign, size_t rows,
+                                                                               size_t count) {
+  __m256 low = _mm256_setzero_ps();
+  __m256 high = _mm256_set1_ps(255);
+  __m256 half = _mm256_set1_ps(0.5f);
+  size_t folded = taps / 2 + (taps % 2 && sign > 0);
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+    __m256 sums[HOMV_SIMD_BLOCK_ROWS][2];
+    for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+      sums[row][0] = sums[row][1] = _mm256_setzero_ps();
+    }
+    for (size_t line = 0; line < rows + taps - 1; line++) {
+#pragma GCC unroll 16
+      for (size_t tap = 0; tap < folded; tap++) {
+        __m256 values[2];
+        homv_fold_avx2(values, src[line] + i, tap, taps, stride, sign);
+#pragma GCC unroll 4
+        for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+          if (line >= row && line - row < taps) {
+            __m256 w = _mm256_set1_ps(weights[(line - row) * taps + tap]);
+            sums[row][0] = _mm256_fmadd_ps(values[0], w, sums[row][0]);
+            sums[row][1] = _mm256_fmadd_ps(values[1], w, sums[row][1]);
+          }
+        }
+      }
+    }
+    for (size_t row = 0; row < rows; row++) {
+      __m256i first = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_min_ps(_mm256_max_ps(sums[row][0], low), high), half));
+      __m256i second = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_min_ps(_mm256_max_ps(sums[row][1], low), high), half));
+      __m128i words_first = _mm_packs_epi32(_mm256_castsi256_si128(first), _mm256_extracti128_si256(first, 1));
+      __m128i words_second = _mm_packs_epi32(_mm256_castsi256_si128(second), _mm256_extracti128_si256(second, 1));
+      _mm_storeu_si128((__m128i *)(dst[row] + i), _mm_packus_epi16(words_first, words_second));
+    }
+  }
+  homv_block_fold_fma(dst, src, weights, taps, stride, sign, rows, i, count);
+}
+
+#define HOMV_BLOCK_FOLD_AVX2(taps, stride) homv_block_fold_avx2(dst, src, weights, taps, stride, sign, rows, count)
+__attribute__((target("avx2,fma"))) static void homv_convolve_fold_u8_avx2(uint8_t *const *dst,
+                                                                           const uint8_t *const *src,
+                                                                           const float *weights, size_t taps,
+                                                                           size_t stride, float sign, size_t rows,
+                                                                           size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_BLOCK_FOLD_AVX2, taps, stride);
+}
+
+// 32 pairs as two vectors of 16 floats, pairs are summed in int16 lanes of one 512-bit register
+__attribute__((target("avx512f,avx512bw,fma"))) HOMV_SIMD_INLINE void
+homv_fold_avx512(__m512 values[2], const uint8_t *line, size_t tap, size_t taps, size_t stride, float sign) {
+  __m512i words = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(line + tap * stride)));
+  if (tap < taps / 2) {
+    __m512i mirror = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(line + (taps - 1 - tap) * stride)));
+    words = sign > 0 ? _mm512_add_epi16(words, mirror) : _mm512_sub_epi16(words, mirror);
+  }
+  values[0] = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm512_castsi512_si256(words)));
+  values[1] = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm512_extracti64x4_epi64(words, 1)));
+}
+
+__attribute__((target("avx512f,avx512bw,fma"))) HOMV_SIMD_INLINE void
+homv_block_fold_avx512(uint8_t *const *dst, const uint8_t *const *src, const float *weights, size_t taps,
+                       size_t stride, float sign, size_t rows, size_t count) {
+  __m512 low = _mm512_setzero_ps();
+  __m512 high = _mm512_set1_ps(255);
+  __m512 half = _mm512_set1_ps(0.5f);
+  size_t folded = taps / 2 + (taps % 2 && sign > 0);
+  size_t i = 0;
+  for (; count >= 32 && i < count; i += 32) {
+    i = homv_simd_chunk(i, 32, count);
+    __m512 sums[HOMV_SIMD_BLOCK_ROWS][2];
+    for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+      sums[row][0] = sums[row][1] = _mm512_setzero_ps();
+    }
+    for (size_t line = 0; line < rows + taps - 1; line++) {
+#pragma GCC unroll 16
+      for (size_t tap = 0; tap < folded; tap++) {
+        __m512 values[2];
+        homv_fold_avx512(values, src[line] + i, tap, taps, stride, sign);
+#pragma GCC unroll 4
+        for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+          if (line >= row && line - row < taps) {
+            __m512 w = _mm512_set1_ps(weights[(line - row) * taps + tap]);
+            sums[row][0] = _mm512_fmadd_ps(values[0], w, sums[row][0]);
+            sums[row][1] = _mm512_fmadd_ps(values[1], w, sums[row][1]);
+          }
+        }
+      }
+    }
+    for (size_t row = 0; row < rows; row++) {
+      for (size_t part = 0; part < 2; part++) {
+        __m512 values = _mm512_min_ps(_mm512_max_ps(sums[row][part], low), high);
+        __m128i bytes = _mm512_cvtusepi32_epi8(_mm512_cvttps_epi32(_mm512_add_ps(values, half)));
+        _mm_storeu_si128((__m128i *)(dst[row] + i + part * 16), bytes);
+      }
+    }
+  }
+  homv_block_fold_fma(dst, src, weights, taps, stride, sign, rows, i, count);
+}
+
+#define HOMV_BLOCK_FOLD_AVX512(taps, stride)                                                                           \
+  homv_block_fold_avx512(dst, src, weights, taps, stride, sign, rows, count)
+__attribute__((target("avx512f,avx512bw,fma"))) static void
+homv_convolve_fold_u8_avx512(uint8_t *const *dst, const uint8_t *const *src, const float *weights, size_t taps,
+                             size_t stride, float sign, size_t rows, size_t count) {
+  HOMV_SIMD_SPECIALIZE(HOMV_BLOCK_FOLD_AVX512, taps, stride);
+}
+
+// Symmetric kernels: mirrored input values are added or subtracted before they are multiplied by their common tap.
+// Sums of uint8 are exact in int16 lanes and sign is 1 or -1, so every variant gets the same pairs as scalar one
+static void homv_fold_u8_scalar(float *dst, const uint8_t *a, const uint8_t *b, float sign, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    dst[i] = b ? a[i] + sign * b[i] : a[i];
+  }
+}
+
+static void homv_madd_pair_u8_scalar(float *acc, const uint8_t *a, const uint8_t *b, const float *weights,
+                                     size_t taps, size_t stride, float sign, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    float sum = acc[i];
+    for (size_t tap = 0; tap < taps; tap++) {
+      sum += weights[tap] * (a[i + tap * stride] + sign * b[i - tap * stride]);
+    }
+    acc[i] = sum;
+  }
+}
+
+static void homv_madd_pair_f32_scalar(float *acc, const float *a, const float *b, const float *weights, size_t taps,
+                                      size_t stride, float sign, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    float sum = acc[i];
+    for (size_t tap = 0; tap < taps; tap++) {
+      sum += weights[tap] * (a[i + tap * stride] + sign * b[i - tap * stride]);
+    }
+    acc[i] = sum;
+  }
+}
+
+// Pairs of 16 uint8 values as two vectors of 8 int16
+__attribute__((target("sse4.1"))) static inline void homv_pair_u8_sse41(__m128i pairs[2], const uint8_t *a,
+                                                                        const uint8_t *b, float sign) {
+  __m128i first = _mm_loadu_si128((const __m128i *)a);
+  __m128i second = b ? _mm_loadu_si128((const __m128i *)b) : _mm_setzero_si128();
+  __m128i first_low = _mm_cvtepu8_epi16(first);
+  __m128i first_high = _mm_cvtepu8_epi16(_mm_srli_si128(first, 8));
+  __m128i second_low = _mm_cvtepu8_epi16(second);
+  __m128i second_high = _mm_cvtepu8_epi16(_mm_srli_si128(second, 8));
+  pairs[0] = sign > 0 ? _mm_add_epi16(first_low, second_low) : _mm_sub_epi16(first_low, second_low);
+  pairs[1] = sign > 0 ? _mm_add_epi16(first_high, second_high) : _mm_sub_epi16(first_high, second_high);
+}
+
+__attribute__((target("sse4.1"))) static void homv_fold_u8_sse41(float *dst, const uint8_t *a, const uint8_t *b,
+                                                                 float sign, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i pairs[2];
+    homv_pair_u8_sse41(pairs, a + i, b ? b + i : NULL, sign);
+    for (size_t part = 0; part < 4; part++) {
+      __m128i words = part % 2 ? _mm_srli_si128(pairs[part / 2], 8) : pairs[part / 2];
+      _mm_storeu_ps(dst + i + part * 4, _mm_cvtepi32_ps(_mm_cvtepi16_epi32(words)));
+    }
+  }
+  homv_fold_u8_scalar(dst + i, a + i, b ? b + i : NULL, sign, count - i);
+}
+
+__attribute__((target("sse4.1"))) static void homv_madd_pair_u8_sse41(float *acc, const uint8_t *a, const uint8_t *b,
+                                                                      const float *weights, size_t taps, size_t stride,
+                                                                      float sign, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128 sums[4];
+    for (size_t part = 0; part < 4; part++) {
+      sums[part] = _mm_loadu_ps(acc + i + part * 4);
+    }
+    for (size_t tap = 0; tap < taps; tap++) {
+      __m128i pairs[2];
+      homv_pair_u8_sse41(pairs, a + i + tap * stride, b + i - tap * stride, sign);
+      __m128 w = _mm_set1_ps(weights[tap]);
+      for (size_t part = 0; part < 4; part++) {
+        __m128i words = part % 2 ? _mm_srli_si128(pairs[part / 2], 8) : pairs[part / 2];
+        sums[part] = _mm_add_ps(sums[part], _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(words)), w));
+      }
+    }
+    for (size_t part = 0; part < 4; part++) {
+      _mm_storeu_ps(acc + i + part * 4, sums[part]);
+    }
+  }
+  homv_madd_pair_u8_scalar(acc + i, a + i, b + i, weights, taps, stride, sign, count - i);
+}
+
+__attribute__((target("sse4.1"))) static void homv_madd_pair_f32_sse41(float *acc, const float *a, const float *b,
+                                                                       const float *weights, size_t taps,
+                                                                       size_t stride, float sign, size_t count) {
+  __m128 s = _mm_set1_ps(sign);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128 first = _mm_loadu_ps(acc + i);
+    __m128 second = _mm_loadu_ps(acc + i + 4);
+    for (size_t tap = 0; tap < taps; tap++) {
+      const float *left = a + i + tap * stride;
+      const float *right = b + i - tap * stride;
+      __m128 w = _mm_set1_ps(weights[tap]);
+      __m128 low = _mm_add_ps(_mm_loadu_ps(left), _mm_mul_ps(s, _mm_loadu_ps(right)));
+      __m128 high = _mm_add_ps(_mm_loadu_ps(left + 4), _mm_mul_ps(s, _mm_loadu_ps(right + 4)));
+      first = _mm_add_ps(first, _mm_mul_ps(w, low));
+      second = _mm_add_ps(second, _mm_mul_ps(w, high));
+    }
+    _mm_storeu_ps(acc + i, first);
+    _mm_storeu_ps(acc + i + 4, second);
+  }
+  homv_madd_pair_f32_scalar(acc + i, a + i, b + i, weights, taps, stride, sign, count - i);
+}
+
+// Pairs of 16 uint8 values as one vector of 16 int16
+__attribute__((target("avx2,fma"))) static inline __m256i homv_pair_u8_avx2(const uint8_t *a, const uint8_t *b,
+                                                                            float sign) {
+  __m256i first = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)a));
+  __m256i second = b ? _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)b)) : _mm256_setzero_si256();
+  return sign > 0 ? _mm256_add_epi16(first, second) : _mm256_sub_epi16(first, second);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_fold_u8_avx2(float *dst, const uint8_t *a, const uint8_t *b,
+                                                                  float sign, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i pairs = homv_pair_u8_avx2(a + i, b ? b + i : NULL, sign);
+    _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(pairs))));
+    _mm256_storeu_ps(dst + i + 8, _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(pairs, 1))));
+  }
+  homv_fold_u8_scalar(dst + i, a + i, b ? b + i : NULL, sign, count - i);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_madd_pair_u8_avx2(float *acc, const uint8_t *a, const uint8_t *b,
+                                                                       const float *weights, size_t taps, size_t stride,
+                                                                       float sign, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256 first = _mm256_loadu_ps(acc + i);
+    __m256 second = _mm256_loadu_ps(acc + i + 8);
+    for (size_t tap = 0; tap < taps; tap++) {
+      __m256i pairs = homv_pair_u8_avx2(a + i + tap * stride, b + i - tap * stride, sign);
+      __m256 w = _mm256_set1_ps(weights[tap]);
+      __m256 low = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(pairs)));
+      __m256 high = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(pairs, 1)));
+      first = _mm256_fmadd_ps(low, w, first);
+      second = _mm256_fmadd_ps(high, w, second);
+    }
+    _mm256_storeu_ps(acc + i, first);
+    _mm256_storeu_ps(acc + i + 8, second);
+  }
+  for (; i < count; i++) {
+    float sum = acc[i];
+    for (size_t tap = 0; tap < taps; tap++) {
+      sum = fmaf(a[i + tap * stride] + sign * b[i - tap * stride], weights[tap], sum);
+    }
+    acc[i] = sum;
+  }
+}
+
+__attribute__((target("avx2,fma"))) static void homv_madd_pair_f32_avx2(float *acc, const float *a, const float *b,
+                                                                        const float *weights, size_t taps,
+                                                                        size_t stride, float sign, size_t count) {
+  __m256 s = _mm256_set1_ps(sign);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256 first = _mm256_loadu_ps(acc + i);
+    __m256 second = _mm256_loadu_ps(acc + i + 8);
+    for (size_t tap = 0; tap < taps; tap++) {
+      const float *left = a + i + tap * stride;
+      const float *right = b + i - tap * stride;
+      __m256 w = _mm256_set1_ps(weights[tap]);
+      first = _mm256_fmadd_ps(_mm256_fmadd_ps(s, _mm256_loadu_ps(right), _mm256_loadu_ps(left)), w, first);
+      second = _mm256_fmadd_ps(_mm256_fmadd_ps(s, _mm256_loadu_ps(right + 8), _mm256_loadu_ps(left + 8)), w, second);
+    }
+    _mm256_storeu_ps(acc + i, first);
+    _mm256_storeu_ps(acc + i + 8, second);
+  }
+  for (; i < count; i++) {
+    float sum = acc[i];
+    for (size_t tap = 0; tap < taps; tap++) {
+      sum = fmaf(fmaf(sign, b[i - tap * stride], a[i + tap * stride]), weights[tap], sum);
+    }
+    acc[i] = sum;
+  }
+}
+
+// Pairs of 16 uint8 values as one vector of 16 int32
+__attribute__((target("avx512f,fma"))) static inline __m512i homv_pair_u8_avx512(const uint8_t *a, const uint8_t *b,
+                                                                                 float sign) {
+  __m512i first = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)a));
+  __m512i second = b ? _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)b)) : _mm512_setzero_si512();
+  return sign > 0 ? _mm512_add_epi32(first, second) : _mm512_sub_epi32(first, second);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_fold_u8_avx512(float *dst, const uint8_t *a, const uint8_t *b,
+                                                                       float sign, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    _mm512_storeu_ps(dst + i, _mm512_cvtepi32_ps(homv_pair_u8_avx512(a + i, b ? b + i : NULL, sign)));
+  }
+  homv_fold_u8_scalar(dst + i, a + i, b ? b + i : NULL, sign, count - i);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_madd_pair_u8_avx512(float *acc, const uint8_t *a,
+                                                                            const uint8_t *b, const float *weights,
+                                                                            size_t taps, size_t stride, float sign,
+                                                                            size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m512 sum = _mm512_loadu_ps(acc + i);
+    for (size_t tap = 0; tap < taps; tap++) {
+      __m512 pairs = _mm512_cvtepi32_ps(homv_pair_u8_avx512(a + i + tap * stride, b + i - tap * stride, sign));
+      sum = _mm512_fmadd_ps(pairs, _mm512_set1_ps(weights[tap]), sum);
+    }
+    _mm512_storeu_ps(acc + i, sum);
+  }
+  for (; i < count; i++) {
+    float sum = acc[i];
+    for (size_t tap = 0; tap < taps; tap++) {
+      sum = fmaf(a[i + tap * stride] + sign * b[i - tap * stride], weights[tap], sum);
+    }
+    acc[i] = sum;
+  }
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_madd_pair_f32_avx512(float *acc, const float *a,
+                                                                            const float *b, const float *weights,
+                                                                            size_t taps, size_t stride, float sign,
+                                                                            size_t count) {
+  __m512 s = _mm512_set1_ps(sign);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m512 sum = _mm512_loadu_ps(acc + i);
+    for (size_t tap = 0; tap < taps; tap++) {
+      __m512 pairs = _mm512_fmadd_ps(s, _mm512_loadu_ps(b + i - tap * stride), _mm512_loadu_ps(a + i + tap * stride));
+      sum = _mm512_fmadd_ps(pairs, _mm512_set1_ps(weights[tap]), sum);
+    }
+    _mm512_storeu_ps(acc + i, sum);
+  }
+  for (; i < count; i++) {
+    float sum = acc[i];
+    for (size_t tap = 0; tap < taps; tap++) {
+      sum = fmaf(fmaf(sign, b[i - tap * stride], a[i + tap * stride]), weights[tap], sum);
+    }
+    acc[i] = sum;
+  }
+}
+
+// Box kernels: column sums slide down by one row and are scaled once per output value
+static void homv_slide_u8_scalar(int32_t *sums, const uint8_t *add, const uint8_t *sub, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    sums[i] += sub ? add[i] - sub[i] : add[i];
+  }
+}
+
+static void homv_store_i32_scalar(uint8_t *dst, const int32_t *sums, float scale, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    dst[i] = homv_simd_pixel(sums[i] * scale);
+  }
+}
+
+__attribute__((target("sse4.1"))) static void homv_slide_u8_sse41(int32_t *sums, const uint8_t *add,
+                                                                  const uint8_t *sub, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i added = _mm_loadu_si128((const __m128i *)(add + i));
+    __m128i subtracted = sub ? _mm_loadu_si128((const __m128i *)(sub + i)) : _mm_setzero_si128();
+    __m128i low = _mm_sub_epi16(_mm_cvtepu8_epi16(added), _mm_cvtepu8_epi16(subtracted));
+    __m128i high = _mm_sub_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(added, 8)),
+                                 _mm_cvtepu8_epi16(_mm_srli_si128(subtracted, 8)));
+    for (size_t part = 0; part < 4; part++) {
+      __m128i words = part < 2 ? low : high;
+      __m128i delta = _mm_cvtepi16_epi32(part % 2 ? _mm_srli_si128(words, 8) : words);
+      __m128i *out = (__m128i *)(sums + i + part * 4);
+      _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), delta));
+    }
+  }
+  homv_slide_u8_scalar(sums + i, add + i, sub ? sub + i : NULL, count - i);
+}
+
+__attribute__((target("sse4.1"))) static void homv_store_i32_sse41(uint8_t *dst, const int32_t *sums, float scale,
+                                                                   size_t count) {
+  __m128 s = _mm_set1_ps(scale);
+  __m128 low = _mm_setzero_ps();
+  __m128 high = _mm_set1_ps(255);
+  __m128 half = _mm_set1_ps(0.5f);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i ints[4];
+    for (size_t part = 0; part < 4; part++) {
+      __m128 values = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(sums + i + part * 4))), s);
+      ints[part] = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(values, low), high), half));
+    }
+    __m128i words_low = _mm_packs_epi32(ints[0], ints[1]);
+    __m128i words_high = _mm_packs_epi32(ints[2], ints[3]);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(words_low, words_high));
+  }
+  homv_store_i32_scalar(dst + i, sums + i, scale, count - i);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_slide_u8_avx2(int32_t *sums, const uint8_t *add,
+                                                                   const uint8_t *sub, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i added = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(add + i)));
+    __m256i subtracted = _mm256_setzero_si256();
+    if (sub) {
+      subtracted = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(sub + i)));
+    }
+    __m256i delta = _mm256_sub_epi16(added, subtracted);
+    __m256i *out = (__m256i *)(sums + i);
+    _mm256_storeu_si256(out, _mm256_add_epi32(_mm256_loadu_si256(out),
+                                              _mm256_cvtepi16_epi32(_mm256_castsi256_si128(delta))));
+    _mm256_storeu_si256(out + 1, _mm256_add_epi32(_mm256_loadu_si256(out + 1),
+                                                  _mm256_cvtepi16_epi32(_mm256_extracti128_si256(delta, 1))));
+  }
+  homv_slide_u8_scalar(sums + i, add + i, sub ? sub + i : NULL, count - i);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_store_i32_avx2(uint8_t *dst, const int32_t *sums, float scale,
+                                                                    size_t count) {
+  __m256 s = _mm256_set1_ps(scale);
+  __m256 low = _mm256_setzero_ps();
+  __m256 high = _mm256_set1_ps(255);
+  __m256 half = _mm256_set1_ps(0.5f);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i ints[2];
+    for (size_t part = 0; part < 2; part++) {
+      __m256 values = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(sums + i + part * 8))), s);
+      ints[part] = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_min_ps(_mm256_max_ps(values, low), high), half));
+    }
+    __m128i words_first = _mm_packs_epi32(_mm256_castsi256_si128(ints[0]), _mm256_extracti128_si256(ints[0], 1));
+    __m128i words_second = _mm_packs_epi32(_mm256_castsi256_si128(ints[1]), _mm256_extracti128_si256(ints[1], 1));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(words_first, words_second));
+  }
+  homv_store_i32_scalar(dst + i, sums + i, scale, count - i);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_slide_u8_avx512(int32_t *sums, const uint8_t *add,
+                                                                        const uint8_t *sub, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m512i added = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(add + i)));
+    __m512i subtracted = _mm512_setzero_si512();
+    if (sub) {
+      subtracted = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(sub + i)));
+    }
+    _mm512_storeu_si512(sums + i, _mm512_add_epi32(_mm512_loadu_si512(sums + i), _mm512_sub_epi32(added, subtracted)));
+  }
+  homv_slide_u8_scalar(sums + i, add + i, sub ? sub + i : NULL, count - i);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_store_i32_avx512(uint8_t *dst, const int32_t *sums,
+                                                                         float scale, size_t count) {
+  __m512 s = _mm512_set1_ps(scale);
+  __m512 low = _mm512_setzero_ps();
+  __m512 high = _mm512_set1_ps(255);
+  __m512 half = _mm512_set1_ps(0.5f);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m512 values = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_loadu_si512(sums + i)), s);
+    values = _mm512_min_ps(_mm512_max_ps(values, low), high);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm512_cvtusepi32_epi8(_mm512_cvttps_epi32(_mm512_add_ps(values, half))));
+  }
+  homv_store_i32_scalar(dst + i, sums + i, scale, count - i);
+}
+
+// Recursive filters: one step of every lane, previous outputs are rows of the same lanes
+static void homv_iir_f32_scalar(float *dst, const float *base, float *const *rows, const float *x0, const float *x1,
+                                const float *const *prev, const float *coefs, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    float y0 = coefs[0] * x0[i] + coefs[1] * x1[i] + coefs[2] * prev[0][i] + coefs[3] * prev[1][i];
+    float y1 = coefs[4] * x0[i] + coefs[5] * x1[i] + coefs[6] * prev[2][i] + coefs[7] * prev[3][i];
+    rows[0][i] = y0;
+    rows[1][i] = y1;
+    dst[i] = (base ? base[i] : 0) + y0 + y1;
+  }
+}
+
+static void homv_iir_f32_fma(float *dst, const float *base, float *const *rows, const float *x0, const float *x1,
+                             const float *const *prev, const float *coefs, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    float y0 = fmaf(coefs[3], prev[1][i], fmaf(coefs[2], prev[0][i], fmaf(coefs[1], x1[i], coefs[0] * x0[i])));
+    float y1 = fmaf(coefs[7], prev[3][i], fmaf(coefs[6], prev[2][i], fmaf(coefs[5], x1[i], coefs[4] * x0[i])));
+    rows[0][i] = y0;
+    rows[1][i] = y1;
+    dst[i] = (base ? base[i] : 0) + y0 + y1;
+  }
+}
+
+__attribute__((target("sse4.1"))) static void homv_iir_f32_sse41(float *dst, const float *base, float *const *rows,
+                                                                 const float *x0, const float *x1,
+                                                                 const float *const *prev, const float *coefs,
+                                                                 size_t count) {
+  __m128 c[8];
+  for (int k = 0; k < 8; k++) {
+    c[k] = _mm_set1_ps(coefs[k]);
+  }
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 a = _mm_loadu_ps(x0 + i), b = _mm_loadu_ps(x1 + i);
+    __m128 y0 = _mm_add_ps(_mm_mul_ps(c[0], a), _mm_mul_ps(c[1], b));
+    y0 = _mm_add_ps(y0, _mm_mul_ps(c[2], _mm_loadu_ps(prev[0] + i)));
+    y0 = _mm_add_ps(y0, _mm_mul_ps(c[3], _mm_loadu_ps(prev[1] + i)));
+    __m128 y1 = _mm_add_ps(_mm_mul_ps(c[4], a), _mm_mul_ps(c[5], b));
+    y1 = _mm_add_ps(y1, _mm_mul_ps(c[6], _mm_loadu_ps(prev[2] + i)));
+    y1 = _mm_add_ps(y1, _mm_mul_ps(c[7], _mm_loadu_ps(prev[3] + i)));
+    _mm_storeu_ps(rows[0] + i, y0);
+    _mm_storeu_ps(rows[1] + i, y1);
+    __m128 sum = base ? _mm_loadu_ps(base + i) : _mm_setzero_ps();
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_add_ps(sum, y0), y1));
+  }
+  float *tail[2] = {rows[0] + i, rows[1] + i};
+  const float *tail_prev[4] = {prev[0] + i, prev[1] + i, prev[2] + i, prev[3] + i};
+  homv_iir_f32_scalar(dst + i, base ? base + i : NULL, tail, x0 + i, x1 + i, tail_prev, coefs, count - i);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_iir_f32_avx2(float *dst, const float *base, float *const *rows,
+                                                                  const float *x0, const float *x1,
+                                                                  const float *const *prev, const float *coefs,
+                                                                  size_t count) {
+  __m256 c[8];
+  for (int k = 0; k < 8; k++) {
+    c[k] = _mm256_set1_ps(coefs[k]);
+  }
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 a = _mm256_loadu_ps(x0 + i), b = _mm256_loadu_ps(x1 + i);
+    __m256 y0 = _mm256_fmadd_ps(c[1], b, _mm256_mul_ps(c[0], a));
+    y0 = _mm256_fmadd_ps(c[3], _mm256_loadu_ps(prev[1] + i), _mm256_fmadd_ps(c[2], _mm256_loadu_ps(prev[0] + i), y0));
+    __m256 y1 = _mm256_fmadd_ps(c[5], b, _mm256_mul_ps(c[4], a));
+    y1 = _mm256_fmadd_ps(c[7], _mm256_loadu_ps(prev[3] + i), _mm256_fmadd_ps(c[6], _mm256_loadu_ps(prev[2] + i), y1));
+    _mm256_storeu_ps(rows[0] + i, y0);
+    _mm256_storeu_ps(rows[1] + i, y1);
+    __m256 sum = base ? _mm256_loadu_ps(base + i) : _mm256_setzero_ps();
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_add_ps(sum, y0), y1));
+  }
+  float *tail[2] = {rows[0] + i, rows[1] + i};
+  const float *tail_prev[4] = {prev[0] + i, prev[1] + i, prev[2] + i, prev[3] + i};
+  homv_iir_f32_fma(dst + i, base ? base + i : NULL, tail, x0 + i, x1 + i, tail_prev, coefs, count - i);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_iir_f32_avx512(float *dst, const float *base,
+                                                                       float *const *rows, const float *x0,
+                                                                       const float *x1, const float *const *prev,
+                                                                       const float *coefs, size_t count) {
+  __m512 c[8];
+  for (int k = 0; k < 8; k++) {
+    c[k] = _mm512_set1_ps(coefs[k]);
+  }
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m512 a = _mm512_loadu_ps(x0 + i), b = _mm512_loadu_ps(x1 + i);
+    __m512 y0 = _mm512_fmadd_ps(c[1], b, _mm512_mul_ps(c[0], a));
+    y0 = _mm512_fmadd_ps(c[3], _mm512_loadu_ps(prev[1] + i), _mm512_fmadd_ps(c[2], _mm512_loadu_ps(prev[0] + i), y0));
+    __m512 y1 = _mm512_fmadd_ps(c[5], b, _mm512_mul_ps(c[4], a));
+    y1 = _mm512_fmadd_ps(c[7], _mm512_loadu_ps(prev[3] + i), _mm512_fmadd_ps(c[6], _mm512_loadu_ps(prev[2] + i), y1));
+    _mm512_storeu_ps(rows[0] + i, y0);
+    _mm512_storeu_ps(rows[1] + i, y1);
+    __m512 sum = base ? _mm512_loadu_ps(base + i) : _mm512_setzero_ps();
+    _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_add_ps(sum, y0), y1));
+  }
+  float *tail[2] = {rows[0] + i, rows[1] + i};
+  const float *tail_prev[4] = {prev[0] + i, prev[1] + i, prev[2] + i, prev[3] + i};
+  homv_iir_f32_fma(dst + i, base ? base + i : NULL, tail, x0 + i, x1 + i, tail_prev, coefs, count - i);
+}
+
+// Winograd F(2x2, 3x3): input transform along a row works on deinterleaved even and odd pixels,
+// so 4 input values of tile i are even[i], odd[i], even[i + stride], odd[i + stride]
+static void homv_winograd_row_f32_scalar(float *const *h, const float *even, const float *odd, size_t stride,
+                                         size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    h[0][i] = even[i] - even[i + stride];
+    h[1][i] = odd[i] + even[i + stride];
+    h[2][i] = even[i + stride] - odd[i];
+    h[3][i] = odd[i] - odd[i + stride];
+  }
+}
+
+// Rows of vertical input transform are multiplied by transformed kernel and summed by output transform at once:
+// s[0][k] = M[0][k] + M[1][k] + M[2][k], s[1][k] = M[1][k] - M[2][k] - M[3][k] for M = u * v
+static void homv_winograd_tile_f32_scalar(float *const *out, const float *const *h, const float *u, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    float s[2][4];
+    for (size_t k = 0; k < 4; k++) {
+      float v0 = h[k][i] - h[8 + k][i];
+      float v1 = h[4 + k][i] + h[8 + k][i];
+      float v2 = h[8 + k][i] - h[4 + k][i];
+      float v3 = h[4 + k][i] - h[12 + k][i];
+      s[0][k] = u[k] * v0 + u[4 + k] * v1 + u[8 + k] * v2;
+      s[1][k] = u[4 + k] * v1 - u[8 + k] * v2 - u[12 + k] * v3;
+    }
+    for (size_t row = 0; row < 2; row++) {
+      out[2 * row][i] = s[row][0] + s[row][1] + s[row][2];
+      out[2 * row + 1][i] = s[row][1] - s[row][2] - s[row][3];
+    }
+  }
+}
+
+static void homv_winograd_tile_f32_fma(float *const *out, const float *const *h, const float *u, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    float s[2][4];
+    for (size_t k = 0; k < 4; k++) {
+      float v0 = h[k][i] - h[8 + k][i];
+      float v1 = h[4 + k][i] + h[8 + k][i];
+      float v2 = h[8 + k][i] - h[4 + k][i];
+      float v3 = h[4 + k][i] - h[12 + k][i];
+      s[0][k] = fmaf(u[8 + k], v2, fmaf(u[4 + k], v1, u[k] * v0));
+      s[1][k] = fmaf(-u[12 + k], v3, fmaf(-u[8 + k], v2, u[4 + k] * v1));
+    }
+    for (size_t row = 0; row < 2; row++) {
+      out[2 * row][i] = s[row][0] + s[row][1] + s[row][2];
+      out[2 * row + 1][i] = s[row][1] - s[row][2] - s[row][3];
+    }
+  }
+}
+
+__attribute__((target("sse4.1"))) static void homv_winograd_row_f32_sse41(float *const *h, const float *even,
+                                                                          const float *odd, size_t stride,
+                                                                          size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 d0 = _mm_loadu_ps(even + i), d1 = _mm_loadu_ps(odd + i);
+    __m128 d2 = _mm_loadu_ps(even + i + stride), d3 = _mm_loadu_ps(odd + i + stride);
+    _mm_storeu_ps(h[0] + i, _mm_sub_ps(d0, d2));
+    _mm_storeu_ps(h[1] + i, _mm_add_ps(d1, d2));
+    _mm_storeu_ps(h[2] + i, _mm_sub_ps(d2, d1));
+    _mm_storeu_ps(h[3] + i, _mm_sub_ps(d1, d3));
+  }
+  float *const tail[4] = {h[0] + i, h[1] + i, h[2] + i, h[3] + i};
+  homv_winograd_row_f32_scalar(tail, even + i, odd + i, stride, count - i);
+}
+
+__attribute__((target("sse4.1"))) static void homv_winograd_tile_f32_sse41(float *const *out, const float *const *h,
+                                                                           const float *u, size_t count) {
+  __m128 weights[16];
+  for (size_t tap = 0; tap < 16; tap++) {
+    weights[tap] = _mm_set1_ps(u[tap]);
+  }
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 s[2][4];
+    for (size_t k = 0; k < 4; k++) {
+      __m128 a = _mm_loadu_ps(h[k] + i), b = _mm_loadu_ps(h[4 + k] + i);
+      __m128 c = _mm_loadu_ps(h[8 + k] + i), d = _mm_loadu_ps(h[12 + k] + i);
+      __m128 v1 = _mm_mul_ps(weights[4 + k], _mm_add_ps(b, c));
+      __m128 v2 = _mm_mul_ps(weights[8 + k], _mm_sub_ps(c, b));
+      s[0][k] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(weights[k], _mm_sub_ps(a, c)), v1), v2);
+      s[1][k] = _mm_sub_ps(_mm_sub_ps(v1, v2), _mm_mul_ps(weights[12 + k], _mm_sub_ps(b, d)));
+    }
+    for (size_t row = 0; row < 2; row++) {
+      _mm_storeu_ps(out[2 * row] + i, _mm_add_ps(_mm_add_ps(s[row][0], s[row][1]), s[row][2]));
+      _mm_storeu_ps(out[2 * row + 1] + i, _mm_sub_ps(_mm_sub_ps(s[row][1], s[row][2]), s[row][3]));
+    }
+  }
+  const float *h_tail[16];
+  for (size_t row = 0; row < 16; row++) {
+    h_tail[row] = h[row] + i;
+  }
+  float *const out_tail[4] = {out[0] + i, out[1] + i, out[2] + i, out[3] + i};
+  homv_winograd_tile_f32_scalar(out_tail, h_tail, u, count - i);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_winograd_row_f32_avx2(float *const *h, const float *even,
+                                                                           const float *odd, size_t stride,
+                                                                           size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 d0 = _mm256_loadu_ps(even + i), d1 = _mm256_loadu_ps(odd + i);
+    __m256 d2 = _mm256_loadu_ps(even + i + stride), d3 = _mm256_loadu_ps(odd + i + stride);
+    _mm256_storeu_ps(h[0] + i, _mm256_sub_ps(d0, d2));
+    _mm256_storeu_ps(h[1] + i, _mm256_add_ps(d1, d2));
+    _mm256_storeu_ps(h[2] + i, _mm256_sub_ps(d2, d1));
+    _mm256_storeu_ps(h[3] + i, _mm256_sub_ps(d1, d3));
+  }
+  float *const tail[4] = {h[0] + i, h[1] + i, h[2] + i, h[3] + i};
+  homv_winograd_row_f32_scalar(tail, even + i, odd + i, stride, count - i);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_winograd_tile_f32_avx2(float *const *out, const float *const *h,
+                                                                            const float *u, size_t count) {
+  __m256 weights[16];
+  for (size_t tap = 0; tap < 16; tap++) {
+    weights[tap] = _mm256_set1_ps(u[tap]);
+  }
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 s[2][4];
+    for (size_t k = 0; k < 4; k++) {
+      __m256 a = _mm256_loadu_ps(h[k] + i), b = _mm256_loadu_ps(h[4 + k] + i);
+      __m256 c = _mm256_loadu_ps(h[8 + k] + i), d = _mm256_loadu_ps(h[12 + k] + i);
+      __m256 v1 = _mm256_add_ps(b, c), v2 = _mm256_sub_ps(c, b);
+      s[0][k] = _mm256_fmadd_ps(weights[8 + k], v2,
+                                _mm256_fmadd_ps(weights[4 + k], v1, _mm256_mul_ps(weights[k], _mm256_sub_ps(a, c))));
+      s[1][k] = _mm256_fnmadd_ps(weights[12 + k], _mm256_sub_ps(b, d),
+                                 _mm256_fnmadd_ps(weights[8 + k], v2, _mm256_mul_ps(weights[4 + k], v1)));
+    }
+    for (size_t row = 0; row < 2; row++) {
+      _mm256_storeu_ps(out[2 * row] + i, _mm256_add_ps(_mm256_add_ps(s[row][0], s[row][1]), s[row][2]));
+      _mm256_storeu_ps(out[2 * row + 1] + i, _mm256_sub_ps(_mm256_sub_ps(s[row][1], s[row][2]), s[row][3]));
+    }
+  }
+  const float *h_tail[16];
+  for (size_t row = 0; row < 16; row++) {
+    h_tail[row] = h[row] + i;
+  }
+  float *const out_tail[4] = {out[0] + i, out[1] + i, out[2] + i, out[3] + i};
+  homv_winograd_tile_f32_fma(out_tail, h_tail, u, count - i);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_winograd_row_f32_avx512(float *const *h, const float *even,
+                                                                               const float *odd, size_t stride,
+                                                                               size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m512 d0 = _mm512_loadu_ps(even + i), d1 = _mm512_loadu_ps(odd + i);
+    __m512 d2 = _mm512_loadu_ps(even + i + stride), d3 = _mm512_loadu_ps(odd + i + stride);
+    _mm512_storeu_ps(h[0] + i, _mm512_sub_ps(d0, d2));
+    _mm512_storeu_ps(h[1] + i, _mm512_add_ps(d1, d2));
+    _mm512_storeu_ps(h[2] + i, _mm512_sub_ps(d2, d1));
+    _mm512_storeu_ps(h[3] + i, _mm512_sub_ps(d1, d3));
+  }
+  float *const tail[4] = {h[0] + i, h[1] + i, h[2] + i, h[3] + i};
+  homv_winograd_row_f32_scalar(tail, even + i, odd + i, stride, count - i);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_winograd_tile_f32_avx512(float *const *out,
+                                                                                const float *const *h, const float *u,
+                                                                                size_t count) {
+  __m512 weights[16];
+  for (size_t tap = 0; tap < 16; tap++) {
+    weights[tap] = _mm512_set1_ps(u[tap]);
+  }
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m512 s[2][4];
+    for (size_t k = 0; k < 4; k++) {
+      __m512 a = _mm512_loadu_ps(h[k] + i), b = _mm512_loadu_ps(h[4 + k] + i);
+      __m512 c = _mm512_loadu_ps(h[8 + k] + i), d = _mm512_loadu_ps(h[12 + k] + i);
+      __m512 v1 = _mm512_add_ps(b, c), v2 = _mm512_sub_ps(c, b);
+      s[0][k] = _mm512_fmadd_ps(weights[8 + k], v2,
+                                _mm512_fmadd_ps(weights[4 + k], v1, _mm512_mul_ps(weights[k], _mm512_sub_ps(a, c))));
+      s[1][k] = _mm512_fnmadd_ps(weights[12 + k], _mm512_sub_ps(b, d),
+                                 _mm512_fnmadd_ps(weights[8 + k], v2, _mm512_mul_ps(weights[4 + k], v1)));
+    }
+    for (size_t row = 0; row < 2; row++) {
+      _mm512_storeu_ps(out[2 * row] + i, _mm512_add_ps(_mm512_add_ps(s[row][0], s[row][1]), s[row][2]));
+      _mm512_storeu_ps(out[2 * row + 1] + i, _mm512_sub_ps(_mm512_sub_ps(s[row][1], s[row][2]), s[row][3]));
+    }
+  }
+  const float *h_tail[16];
+  for (size_t row = 0; row < 16; row++) {
+    h_tail[row] = h[row] + i;
+  }
+  float *const out_tail[4] = {out[0] + i, out[1] + i, out[2] + i, out[3] + i};
+  homv_winograd_tile_f32_fma(out_tail, h_tail, u, count - i);
+}
+
+// Sobel derivatives: every input value is loaded once for both directions. Middle row has no vertical taps
+// and middle column has no horizontal taps, so 8 loads serve 12 taps
+HOMV_SIMD_INLINE void homv_sobel_scalar(int16_t *gx, int16_t *gy, const uint8_t *const *src, size_t stride,
+                                        size_t begin, size_t count) {
+  const uint8_t *top = src[0], *middle = src[1], *bottom = src[2];
+  for (size_t i = begin; i < count; i++) {
+    gx[i] = (int16_t)(top[i + 2 * stride] - top[i] + 2 * (middle[i + 2 * stride] - middle[i]) + bottom[i + 2 * stride] -
+                      bottom[i]);
+    gy[i] = (int16_t)(bottom[i] + 2 * bottom[i + stride] + bottom[i + 2 * stride] - top[i] - 2 * top[i + stride] -
+                      top[i + 2 * stride]);
+  }
+}
+
+static void homv_sobel_i16_scalar(int16_t *gx, int16_t *gy, const uint8_t *const *src, size_t stride,
+                                  size_t count) {
+  homv_sobel_scalar(gx, gy, src, stride, 0, count);
+}
+
+// Squares of derivatives up to 4 * 255 and their sums are exact in float, and sqrt is exact rounded,
+// so every variant gives the same magnitude
+static void homv_magnitude_u8_scalar(uint8_t *dst, const int16_t *gx, const int16_t *gy, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    float x = gx[i], y = gy[i];
+    dst[i] = homv_simd_pixel(sqrtf(x * x + y * y));
+  }
+}
+
+__attribute__((target("sse4.1"))) static void homv_sobel_i16_sse41(int16_t *gx, int16_t *gy,
+                                                                   const uint8_t *const *src, size_t stride,
+                                                                   size_t count) {
+  const uint8_t *top = src[0], *middle = src[1], *bottom = src[2];
+  size_t i = 0;
+  for (; count >= 8 && i < count; i += 8) {
+    i = homv_simd_chunk(i, 8, count);
+#define HOMV_LOAD_SSE41(row, tap) _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(row + i + (tap) * stride)))
+    __m128i t0 = HOMV_LOAD_SSE41(top, 0), t1 = HOMV_LOAD_SSE41(top, 1), t2 = HOMV_LOAD_SSE41(top, 2);
+    __m128i m0 = HOMV_LOAD_SSE41(middle, 0), m2 = HOMV_LOAD_SSE41(middle, 2);
+    __m128i b0 = HOMV_LOAD_SSE41(bottom, 0), b1 = HOMV_LOAD_SSE41(bottom, 1), b2 = HOMV_LOAD_SSE41(bottom, 2);
+#undef HOMV_LOAD_SSE41
+    __m128i middle_diff = _mm_sub_epi16(m2, m0);
+    __m128i x = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(t2, t0), _mm_sub_epi16(b2, b0)),
+                              _mm_add_epi16(middle_diff, middle_diff));
+    __m128i top_sum = _mm_add_epi16(_mm_add_epi16(t0, t2), _mm_add_epi16(t1, t1));
+    __m128i bottom_sum = _mm_add_epi16(_mm_add_epi16(b0, b2), _mm_add_epi16(b1, b1));
+    _mm_storeu_si128((__m128i *)(gx + i), x);
+    _mm_storeu_si128((__m128i *)(gy + i), _mm_sub_epi16(bottom_sum, top_sum));
+  }
+  homv_sobel_scalar(gx, gy, src, stride, i, count);
+}
+
+__attribute__((target("sse4.1"))) static void homv_magnitude_u8_sse41(uint8_t *dst, const int16_t *gx,
+                                                                      const int16_t *gy, size_t count) {
+  __m128 high = _mm_set1_ps(255);
+  __m128 half = _mm_set1_ps(0.5f);
+  size_t i = 0;
+  for (; count >= 8 && i < count; i += 8) {
+    i = homv_simd_chunk(i, 8, count);
+    __m128i x = _mm_loadu_si128((const __m128i *)(gx + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(gy + i));
+    __m128i ints[2];
+    for (size_t part = 0; part < 2; part++) {
+      __m128 fx = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(part ? _mm_srli_si128(x, 8) : x));
+      __m128 fy = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(part ? _mm_srli_si128(y, 8) : y));
+      __m128 magnitude = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)));
+      ints[part] = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(magnitude, high), half));
+    }
+    __m128i words = _mm_packs_epi32(ints[0], ints[1]);
+    _mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(words, words));
+  }
+  homv_magnitude_u8_scalar(dst + i, gx + i, gy + i, count - i);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_sobel_i16_avx2(int16_t *gx, int16_t *gy,
+                                                                    const uint8_t *const *src, size_t stride,
+                                                                    size_t count) {
+  const uint8_t *top = src[0], *middle = src[1], *bottom = src[2];
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+#define HOMV_LOAD_AVX2(row, tap) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(row + i + (tap) * stride)))
+    __m256i t0 = HOMV_LOAD_AVX2(top, 0), t1 = HOMV_LOAD_AVX2(top, 1), t2 = HOMV_LOAD_AVX2(top, 2);
+    __m256i m0 = HOMV_LOAD_AVX2(middle, 0), m2 = HOMV_LOAD_AVX2(middle, 2);
+    __m256i b0 = HOMV_LOAD_AVX2(bottom, 0), b1 = HOMV_LOAD_AVX2(bottom, 1), b2 = HOMV_LOAD_AVX2(bottom, 2);
+#undef HOMV_LOAD_AVX2
+    __m256i middle_diff = _mm256_sub_epi16(m2, m0);
+    __m256i x = _mm256_add_epi16(_mm256_add_epi16(_mm256_sub_epi16(t2, t0), _mm256_sub_epi16(b2, b0)),
+                                 _mm256_add_epi16(middle_diff, middle_diff));
+    __m256i top_sum = _mm256_add_epi16(_mm256_add_epi16(t0, t2), _mm256_add_epi16(t1, t1));
+    __m256i bottom_sum = _mm256_add_epi16(_mm256_add_epi16(b0, b2), _mm256_add_epi16(b1, b1));
+    _mm256_storeu_si256((__m256i *)(gx + i), x);
+    _mm256_storeu_si256((__m256i *)(gy + i), _mm256_sub_epi16(bottom_sum, top_sum));
+  }
+  homv_sobel_scalar(gx, gy, src, stride, i, count);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_magnitude_u8_avx2(uint8_t *dst, const int16_t *gx,
+                                                                       const int16_t *gy, size_t count) {
+  __m256 high = _mm256_set1_ps(255);
+  __m256 half = _mm256_set1_ps(0.5f);
+  size_t i = 0;
+  for (; count >= 8 && i < count; i += 8) {
+    i = homv_simd_chunk(i, 8, count);
+    __m256 fx = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(gx + i))));
+    __m256 fy = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(gy + i))));
+    __m256 magnitude = _mm256_sqrt_ps(_mm256_fmadd_ps(fx, fx, _mm256_mul_ps(fy, fy)));
+    __m256i ints = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_min_ps(magnitude, high), half));
+    __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(ints), _mm256_extracti128_si256(ints, 1));
+    _mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(words, words));
+  }
+  homv_magnitude_u8_scalar(dst + i, gx + i, gy + i, count - i);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void homv_sobel_i16_avx512(int16_t *gx, int16_t *gy,
+                                                                              const uint8_t *const *src,
+                                                                              size_t stride, size_t count) {
+  const uint8_t *top = src[0], *middle = src[1], *bottom = src[2];
+  size_t i = 0;
+  for (; count >= 32 && i < count; i += 32) {
+    i = homv_simd_chunk(i, 32, count);
+#define HOMV_LOAD_AVX512(row, tap)                                                                                     \
+  _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(row + i + (tap) * stride)))
+    __m512i t0 = HOMV_LOAD_AVX512(top, 0), t1 = HOMV_LOAD_AVX512(top, 1), t2 = HOMV_LOAD_AVX512(top, 2);
+    __m512i m0 = HOMV_LOAD_AVX512(middle, 0), m2 = HOMV_LOAD_AVX512(middle, 2);
+    __m512i b0 = HOMV_LOAD_AVX512(bottom, 0), b1 = HOMV_LOAD_AVX512(bottom, 1), b2 = HOMV_LOAD_AVX512(bottom, 2);
+#undef HOMV_LOAD_AVX512
+    __m512i middle_diff = _mm512_sub_epi16(m2, m0);
+    __m512i x = _mm512_add_epi16(_mm512_add_epi16(_mm512_sub_epi16(t2, t0), _mm512_sub_epi16(b2, b0)),
+                                 _mm512_add_epi16(middle_diff, middle_diff));
+    __m512i top_sum = _mm512_add_epi16(_mm512_add_epi16(t0, t2), _mm512_add_epi16(t1, t1));
+    __m512i bottom_sum = _mm512_add_epi16(_mm512_add_epi16(b0, b2), _mm512_add_epi16(b1, b1));
+    _mm512_storeu_si512((__m512i *)(gx + i), x);
+    _mm512_storeu_si512((__m512i *)(gy + i), _mm512_sub_epi16(bottom_sum, top_sum));
+  }
+  homv_sobel_scalar(gx, gy, src, stride, i, count);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_magnitude_u8_avx512(uint8_t *dst, const int16_t *gx,
+                                                                           const int16_t *gy, size_t count) {
+  __m512 high = _mm512_set1_ps(255);
+  __m512 half = _mm512_set1_ps(0.5f);
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+    __m512 fx = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)(gx + i))));
+    __m512 fy = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)(gy + i))));
+    __m512 magnitude = _mm512_sqrt_ps(_mm512_fmadd_ps(fx, fx, _mm512_mul_ps(fy, fy)));
+    __m128i bytes = _mm512_cvtusepi32_epi8(_mm512_cvttps_epi32(_mm512_add_ps(_mm512_min_ps(magnitude, high), half)));
+    _mm_storeu_si128((__m128i *)(dst + i), bytes);
+  }
+  homv_magnitude_u8_scalar(dst + i, gx + i, gy + i, count - i);
+}
+
+// 16-bit images: rows are widened to floats once and convolved by float operations, sums are rounded
+// and saturated to 0..65535 like store_u8 does to 0..255
+
+static inline uint16_t homv_simd_sample(float value) {
+  if (value <= 0) {
+    return 0;
+  }
+  if (value >= 65535) {
+    return 65535;
+  }
+  return (uint16_t)(value + 0.5f);
+}
+
+static void homv_widen_u16_scalar(float *dst, const uint16_t *src, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    dst[i] = src[i];
+  }
+}
+
+static void homv_widen_i16_scalar(float *dst, const int16_t *src, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    dst[i] = src[i];
+  }
+}
+
+static void homv_store_u16_scalar(uint16_t *dst, const float *acc, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    dst[i] = homv_simd_sample(acc[i]);
+  }
+}
+
+__attribute__((target("sse4.1"))) static void homv_widen_u16_sse41(float *dst, const uint16_t *src, size_t count) {
+  size_t i = 0;
+  for (; count >= 8 && i < count; i += 8) {
+    i = homv_simd_chunk(i, 8, count);
+    __m128i words = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_cvtepu16_epi32(words)));
+    _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_srli_si128(words, 8))));
+  }
+  homv_widen_u16_scalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("sse4.1"))) static void homv_widen_i16_sse41(float *dst, const int16_t *src, size_t count) {
+  size_t i = 0;
+  for (; count >= 8 && i < count; i += 8) {
+    i = homv_simd_chunk(i, 8, count);
+    __m128i words = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_cvtepi16_epi32(words)));
+    _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(words, 8))));
+  }
+  homv_widen_i16_scalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("sse4.1"))) static void homv_store_u16_sse41(uint16_t *dst, const float *acc, size_t count) {
+  __m128 low = _mm_setzero_ps();
+  __m128 high = _mm_set1_ps(65535);
+  __m128 half = _mm_set1_ps(0.5f);
+  size_t i = 0;
+  for (; count >= 8 && i < count; i += 8) {
+    i = homv_simd_chunk(i, 8, count);
+    __m128i ints[2];
+    for (size_t part = 0; part < 2; part++) {
+      __m128 values = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(acc + i + part * 4), low), high);
+      ints[part] = _mm_cvttps_epi32(_mm_add_ps(values, half));
+    }
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi32(ints[0], ints[1]));
+  }
+  homv_store_u16_scalar(dst + i, acc + i, count - i);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_widen_u16_avx2(float *dst, const uint16_t *src, size_t count) {
+  size_t i = 0;
+  for (; count >= 8 && i < count; i += 8) {
+    i = homv_simd_chunk(i, 8, count);
+    __m256i ints = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+    _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(ints));
+  }
+  homv_widen_u16_scalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_widen_i16_avx2(float *dst, const int16_t *src, size_t count) {
+  size_t i = 0;
+  for (; count >= 8 && i < count; i += 8) {
+    i = homv_simd_chunk(i, 8, count);
+    __m256i ints = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+    _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(ints));
+  }
+  homv_widen_i16_scalar(dst + i, src + i, count - i);
+}
+
+// Packs work inside 128-bit lanes, so packed words are in order 0 2 1 3 of their quarters
+__attribute__((target("avx2,fma"))) static void homv_store_u16_avx2(uint16_t *dst, const float *acc, size_t count) {
+  __m256 low = _mm256_setzero_ps();
+  __m256 high = _mm256_set1_ps(65535);
+  __m256 half = _mm256_set1_ps(0.5f);
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+    __m256i ints[2];
+    for (size_t part = 0; part < 2; part++) {
+      __m256 values = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(acc + i + part * 8), low), high);
+      ints[part] = _mm256_cvttps_epi32(_mm256_add_ps(values, half));
+    }
+    __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(ints[0], ints[1]), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256((__m256i *)(dst + i), words);
+  }
+  homv_store_u16_scalar(dst + i, acc + i, count - i);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_widen_u16_avx512(float *dst, const uint16_t *src,
+                                                                         size_t count) {
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+    __m512i ints = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *)(src + i)));
+    _mm512_storeu_ps(dst + i, _mm512_cvtepi32_ps(ints));
+  }
+  homv_widen_u16_scalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_widen_i16_avx512(float *dst, const int16_t *src,
+                                                                         size_t count) {
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+    __m512i ints = _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)(src + i)));
+    _mm512_storeu_ps(dst + i, _mm512_cvtepi32_ps(ints));
+  }
+  homv_widen_i16_scalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_store_u16_avx512(uint16_t *dst, const float *acc,
+                                                                         size_t count) {
+  __m512 low = _mm512_setzero_ps();
+  __m512 high = _mm512_set1_ps(65535);
+  __m512 half = _mm512_set1_ps(0.5f);
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+    __m512 values = _mm512_min_ps(_mm512_max_ps(_mm512_loadu_ps(acc + i), low), high);
+    __m256i words = _mm512_cvtusepi32_epi16(_mm512_cvttps_epi32(_mm512_add_ps(values, half)));
+    _mm256_storeu_si256((__m256i *)(dst + i), words);
+  }
+  homv_store_u16_scalar(dst + i, acc + i, count - i);
+}
+
+// Signed 16-bit output keeps negative sums of derivative kernels. Rounding is to nearest even like conversions
+// of SIMD registers. Ranges of float rows give min and max of image for normalization
+
+static void homv_narrow_i16_scalar(int16_t *dst, const float *acc, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    float value = acc[i] < -32768 ? -32768 : acc[i] > 32767 ? 32767 : acc[i];
+    dst[i] = (int16_t)lrintf(value);
+  }
+}
+
+static void homv_range_f32_scalar(float *bounds, const float *src, size_t count) {
+  float low = bounds[0], high = bounds[1];
+  for (size_t i = 0; i < count; i++) {
+    low = src[i] < low ? src[i] : low;
+    high = src[i] > high ? src[i] : high;
+  }
+  bounds[0] = low;
+  bounds[1] = high;
+}
+
+__attribute__((target("sse4.1"))) static void homv_narrow_i16_sse41(int16_t *dst, const float *acc, size_t count) {
+  __m128 low = _mm_set1_ps(-32768);
+  __m128 high = _mm_set1_ps(32767);
+  size_t i = 0;
+  for (; count >= 8 && i < count; i += 8) {
+    i = homv_simd_chunk(i, 8, count);
+    __m128i ints[2];
+    for (size_t part = 0; part < 2; part++) {
+      ints[part] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(acc + i + part * 4), low), high));
+    }
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(ints[0], ints[1]));
+  }
+  homv_narrow_i16_scalar(dst + i, acc + i, count - i);
+}
+
+__attribute__((target("sse4.1"))) static void homv_range_f32_sse41(float *bounds, const float *src, size_t count) {
+  __m128 low = _mm_set1_ps(bounds[0]);
+  __m128 high = _mm_set1_ps(bounds[1]);
+  size_t i = 0;
+  for (; count >= 4 && i < count; i += 4) {
+    i = homv_simd_chunk(i, 4, count);
+    __m128 values = _mm_loadu_ps(src + i);
+    low = _mm_min_ps(low, values);
+    high = _mm_max_ps(high, values);
+  }
+  float lows[4], highs[4];
+  _mm_storeu_ps(lows, low);
+  _mm_storeu_ps(highs, high);
+  for (size_t lane = 0; lane < 4; lane++) {
+    bounds[0] = lows[lane] < bounds[0] ? lows[lane] : bounds[0];
+    bounds[1] = highs[lane] > bounds[1] ? highs[lane] : bounds[1];
+  }
+  homv_range_f32_scalar(bounds, src + i, count - i);
+}
+
+// Packs work inside 128-bit lanes, so packed words are in order 0 2 1 3 of their quarters
+__attribute__((target("avx2,fma"))) static void homv_narrow_i16_avx2(int16_t *dst, const float *acc, size_t count) {
+  __m256 low = _mm256_set1_ps(-32768);
+  __m256 high = _mm256_set1_ps(32767);
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+    __m256i ints[2];
+    for (size_t part = 0; part < 2; part++) {
+      ints[part] = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(acc + i + part * 8), low), high));
+    }
+    __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(ints[0], ints[1]), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256((__m256i *)(dst + i), words);
+  }
+  homv_narrow_i16_scalar(dst + i, acc + i, count - i);
+}
+
+__attribute__((target("avx2,fma"))) static void homv_range_f32_avx2(float *bounds, const float *src, size_t count) {
+  __m256 low = _mm256_set1_ps(bounds[0]);
+  __m256 high = _mm256_set1_ps(bounds[1]);
+  size_t i = 0;
+  for (; count >= 8 && i < count; i += 8) {
+    i = homv_simd_chunk(i, 8, count);
+    __m256 values = _mm256_loadu_ps(src + i);
+    low = _mm256_min_ps(low, values);
+    high = _mm256_max_ps(high, values);
+  }
+  float lows[8], highs[8];
+  _mm256_storeu_ps(lows, low);
+  _mm256_storeu_ps(highs, high);
+  for (size_t lane = 0; lane < 8; lane++) {
+    bounds[0] = lows[lane] < bounds[0] ? lows[lane] : bounds[0];
+    bounds[1] = highs[lane] > bounds[1] ? highs[lane] : bounds[1];
+  }
+  homv_range_f32_scalar(bounds, src + i, count - i);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_narrow_i16_avx512(int16_t *dst, const float *acc,
+                                                                          size_t count) {
+  __m512 low = _mm512_set1_ps(-32768);
+  __m512 high = _mm512_set1_ps(32767);
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+    __m512i ints = _mm512_cvtps_epi32(_mm512_min_ps(_mm512_max_ps(_mm512_loadu_ps(acc + i), low), high));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm512_cvtsepi32_epi16(ints));
+  }
+  homv_narrow_i16_scalar(dst + i, acc + i, count - i);
+}
+
+__attribute__((target("avx512f,fma"))) static void homv_range_f32_avx512(float *bounds, const float *src,
+                                                                         size_t count) {
+  __m512 low = _mm512_set1_ps(bounds[0]);
+  __m512 high = _mm512_set1_ps(bounds[1]);
+  size_t i = 0;
+  for (; count >= 16 && i < count; i += 16) {
+    i = homv_simd_chunk(i, 16, count);
+    __m512 values = _mm512_loadu_ps(src + i);
+    low = _mm512_min_ps(low, values);
+    high = _mm512_max_ps(high, values);
+  }
+  bounds[0] = _mm512_reduce_min_ps(low);
+  bounds[1] = _mm512_reduce_max_ps(high);
+  homv_range_f32_scalar(bounds, src + i, count - i);
+}
+
+static const homv_simd_ops homv_simd_table[HOMV_ISA_MAX] = {
+    [HOMV_ISA_SCALAR] = {HOMV_ISA_SCALAR, "scalar", homv_madd_u8_scalar, homv_madd_f32_scalar, homv_store_u8_scalar,
+                         homv_madd_i16_scalar, homv_store_i16_scalar, homv_madd_row_u8_scalar,
+                         homv_madd_row_i16_scalar, homv_convolve_u8_scalar, homv_convolve_i16_scalar,
+                         homv_convolve_sparse_i16_scalar, homv_fold_u8_scalar, homv_madd_pair_u8_scalar,
+                         homv_madd_pair_f32_scalar, homv_convolve_fold_u8_scalar, homv_slide_u8_scalar,
+                         homv_store_i32_scalar,
+                         homv_iir_f32_scalar, homv_winograd_row_f32_scalar,
+                         homv_winograd_tile_f32_scalar, homv_sobel_i16_scalar, homv_magnitude_u8_scalar,
+                         homv_widen_u16_scalar, homv_widen_i16_scalar, homv_store_u16_scalar, homv_narrow_i16_scalar,
+                         homv_range_f32_scalar},
+    [HOMV_ISA_SSE41] = {HOMV_ISA_SSE41, "sse4.1", homv_madd_u8_sse41, homv_madd_f32_sse41, homv_store_u8_sse41,
+                        homv_madd_i16_sse41, homv_store_i16_sse41, homv_madd_row_u8_sse41, homv_madd_row_i16_sse41,
+                        homv_convolve_u8_sse41, homv_convolve_i16_sse41, homv_convolve_sparse_i16_sse41,
+                        homv_fold_u8_sse41, homv_madd_pair_u8_sse41, homv_madd_pair_f32_sse41,
+                        homv_convolve_fold_u8_sse41, homv_slide_u8_sse41,
+                        homv_store_i32_sse41, homv_iir_f32_sse41, homv_winograd_row_f32_sse41,
+                        homv_winograd_tile_f32_sse41, homv_sobel_i16_sse41, homv_magnitude_u8_sse41,
+                        homv_widen_u16_sse41, homv_widen_i16_sse41, homv_store_u16_sse41, homv_narrow_i16_sse41,
+                        homv_range_f32_sse41},
+    [HOMV_ISA_AVX2] = {HOMV_ISA_AVX2, "avx2", homv_madd_u8_avx2, homv_madd_f32_avx2, homv_store_u8_avx2,
+                       homv_madd_i16_avx2, homv_store_i16_avx2, homv_madd_row_u8_avx2, homv_madd_row_i16_avx2,
+                       homv_convolve_u8_avx2, homv_convolve_i16_avx2, homv_convolve_sparse_i16_avx2, homv_fold_u8_avx2,
+                       homv_madd_pair_u8_avx2, homv_madd_pair_f32_avx2, homv_convolve_fold_u8_avx2, homv_slide_u8_avx2,
+                       homv_store_i32_avx2,
+                       homv_iir_f32_avx2, homv_winograd_row_f32_avx2,
+                       homv_winograd_tile_f32_avx2, homv_sobel_i16_avx2, homv_magnitude_u8_avx2,
+                       homv_widen_u16_avx2, homv_widen_i16_avx2, homv_store_u16_avx2, homv_narrow_i16_avx2,
+                       homv_range_f32_avx2},
+    [HOMV_ISA_AVX512] = {HOMV_ISA_AVX512, "avx512", homv_madd_u8_avx512, homv_madd_f32_avx512, homv_store_u8_avx512,
+                         homv_madd_i16_avx512, homv_store_i16_avx512, homv_madd_row_u8_avx512,
+                         homv_madd_row_i16_avx512, homv_convolve_u8_avx512, homv_convolve_i16_avx512,
+                         homv_convolve_sparse_i16_avx512, homv_fold_u8_avx512, homv_madd_pair_u8_avx512,
+                         homv_madd_pair_f32_avx512, homv_convolve_fold_u8_avx512, homv_slide_u8_avx512,
+                         homv_store_i32_avx512,
+                         homv_iir_f32_avx512, homv_winograd_row_f32_avx512,
+                         homv_winograd_tile_f32_avx512, homv_sobel_i16_avx512, homv_magnitude_u8_avx512,
+                         homv_widen_u16_avx512, homv_widen_i16_avx512, homv_store_u16_avx512, homv_narrow_i16_avx512,
+                         homv_range_f32_avx512},
+};
+
+const homv_simd_ops *homv_simd = &homv_simd_table[HOMV_ISA_SCALAR];
+
+static bool homv_simd_supported(homv_isa isa) {
+  __builtin_cpu_init();
+  switch (isa) {
+  case HOMV_ISA_SCALAR:
+    return true;
+  case HOMV_ISA_SSE41:
+    return __builtin_cpu_supports("sse4.1");
+  case HOMV_ISA_AVX2:
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  case HOMV_ISA_AVX512:
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("fma");
+  default:
+    return false;
+  }
+}
+
+bool homv_simd_select(homv_isa isa) {
+  if (isa == HOMV_ISA_AUTO) {
+    isa = HOMV_ISA_MAX - 1;
+    while (!homv_simd_supported(isa)) {
+      isa--;
+    }
+  }
+
+  if (!homv_simd_supported(isa)) {
+    return false;
+  }
+
+  homv_simd = &homv_simd_table[isa];
+  return true;
+}
+
+homv_isa homv_simd_parse(const char *name) {
+  if (strcmp(name, "auto") == 0) {
+    return HOMV_ISA_AUTO;
+  }
+  for (homv_isa isa = HOMV_ISA_SCALAR; isa < HOMV_ISA_MAX; isa++) {
+    if (strcmp(name, homv_simd_table[isa].name) == 0) {
+      return isa;
+    }
+  }
+
+  return HOMV_ISA_MAX;
+}
+
+__attribute__((constructor)) static void homv_simd_init(void) { homv_simd_select(HOMV_ISA_AUTO); }
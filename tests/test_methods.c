@@ -17,6 +17,10 @@
 
 #include "homv_core.h"
 #include "homv_matrix.h"
+#include "homv_npy.h"
+#include "homv_plan.h"
+#include "homv_png.h"
+#include "homv_simd.h"
 #include "stb_image.h"
 #include "stb_image_write.h"
 
@@ -101,12 +105,1577 @@ static void test_area_method(void **state) {
 	FREE_WORKSPACE();
 }
 
+static void test_separable_plan(void **state) {
+	(void)state;
+
+	homv_plan_force = HOMV_PLAN_SEPARABLE;
+	homv_plan *blur = homv_plan_create(homv_matrices[HOMV_MATRIX_BLUR]);
+	homv_plan *sobel = homv_plan_create(homv_matrices[HOMV_MATRIX_BOTTOM_SOBEL]);
+	homv_plan *outline = homv_plan_create(homv_matrices[HOMV_MATRIX_OUTLINE]);
+	homv_plan_force = HOMV_PLAN_AUTO;
+
+	assert_int_equal(blur->kind, HOMV_PLAN_SEPARABLE);
+	assert_int_equal(sobel->kind, HOMV_PLAN_SEPARABLE);
+	assert_int_equal(outline->kind, HOMV_PLAN_DIRECT);
+
+	homv_plan_free(blur);
+	homv_plan_free(sobel);
+	homv_plan_free(outline);
+}
+
+static void test_separable_method(void **state) {
+	(void)state;
+
+	LOAD_IMAGE("./input/sticker.jpg");
+	matrix = homv_matrices[HOMV_MATRIX_BLUR];
+
+	homv_plan_force = HOMV_PLAN_DIRECT;
+	uint8_t *first_output = homv_apply_seq(image_reflected, width, height, channels, matrix);
+	homv_plan_force = HOMV_PLAN_SEPARABLE;
+	uint8_t *second_output = homv_apply_parallel_pixels(image_reflected, width, height, channels, matrix);
+	homv_plan_force = HOMV_PLAN_AUTO;
+
+	for (ssize_t i = 0; i < width * height * channels; i++) {
+		assert_int_equal(first_output[i], second_output[i]);
+	}
+
+	FREE_WORKSPACE();
+}
+
+static void test_low_rank_plan(void **state) {
+	(void)state;
+
+	// 9x9 kernel of rank 2: outer products of two non-parallel vectors
+	homv_matrix *kernel = homv_mx_init(9, NULL);
+	for (size_t y = 0; y < 9; y++) {
+		for (size_t x = 0; x < 9; x++) {
+			kernel->values[y * 9 + x] = (1.0 + y) * (9.0 - x) / 400 + (x % 3 == 0 ? 0.01 : -0.02) * (y % 2 ? 1 : -1);
+		}
+	}
+
+	homv_plan *plan = homv_plan_create(*kernel);
+	assert_int_equal(plan->kind, HOMV_PLAN_LOW_RANK);
+	assert_int_equal(plan->terms, 2);
+	for (size_t y = 0; y < 9; y++) {
+		for (size_t x = 0; x < 9; x++) {
+			double value = 0;
+			for (size_t term = 0; term < plan->terms; term++) {
+				value += plan->cols[term * 9 + y] * plan->rows[term * 9 + x];
+			}
+			assert_float_equal(value, kernel->values[y * 9 + x], 1e-9);
+		}
+	}
+
+	homv_plan_free(plan);
+	homv_mx_free(kernel);
+}
+
+static void test_low_rank_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	homv_matrix *matrix = homv_mx_get_random_matrix(9);
+	uint8_t *image_reflected = homv_reflect_image(img, width, height, channels, matrix->size);
+
+	homv_plan_force = HOMV_PLAN_DIRECT;
+	uint8_t *first_output = homv_apply_seq(image_reflected, width, height, channels, *matrix);
+	homv_plan_force = HOMV_PLAN_LOW_RANK;
+	homv_svd_tolerance = 0;
+	uint8_t *second_output = homv_apply_parallel_rows(image_reflected, width, height, channels, *matrix);
+	homv_plan_force = HOMV_PLAN_AUTO;
+	homv_svd_tolerance = 1e-3;
+
+	// Full rank approximation differs from direct sum only by rounding errors
+	for (ssize_t i = 0; i < width * height * channels; i++) {
+		assert_true(abs(first_output[i] - second_output[i]) <= 1);
+	}
+
+	homv_mx_free(matrix);
+	FREE_WORKSPACE();
+}
+
+static void test_fft_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	homv_matrix *matrix = homv_mx_get_random_matrix(15);
+	uint8_t *image_reflected = homv_reflect_image(img, width, height, channels, matrix->size);
+
+	uint8_t *first_output = homv_apply_seq(image_reflected, width, height, channels, *matrix);
+	uint8_t *second_output = homv_apply_fft(image_reflected, width, height, channels, *matrix);
+
+	// FFT differs from direct sum only by rounding errors
+	for (ssize_t i = 0; i < width * height * channels; i++) {
+		assert_true(abs(first_output[i] - second_output[i]) <= 1);
+	}
+
+	homv_mx_free(matrix);
+	FREE_WORKSPACE();
+}
+
+static void test_isa_variants(void **state) {
+	(void)state;
+
+	LOAD_IMAGE("./input/sticker.jpg");
+	matrix = homv_matrices[HOMV_MATRIX_SHARPEN];
+
+	homv_plan_kind kinds[] = {HOMV_PLAN_DIRECT, HOMV_PLAN_INTEGER, HOMV_PLAN_SPARSE, HOMV_PLAN_SYMMETRIC,
+	                          HOMV_PLAN_WINOGRAD};
+	for (size_t kind = 0; kind < sizeof(kinds) / sizeof(kinds[0]); kind++) {
+		homv_plan_force = kinds[kind];
+		homv_simd_select(HOMV_ISA_SCALAR);
+		uint8_t *first_output = homv_apply_seq(image_reflected, width, height, channels, matrix);
+		for (homv_isa isa = HOMV_ISA_SSE41; isa < HOMV_ISA_MAX; isa++) {
+			if (!homv_simd_select(isa)) {
+				continue;
+			}
+			uint8_t *second_output = homv_apply_parallel_rows(image_reflected, width, height, channels, matrix);
+			// Variants with FMA round products differently
+			for (ssize_t i = 0; i < width * height * channels; i++) {
+				assert_true(abs(first_output[i] - second_output[i]) <= 1);
+			}
+			free(second_output);
+		}
+		free(first_output);
+	}
+	homv_simd_select(HOMV_ISA_AUTO);
+	homv_plan_force = HOMV_PLAN_AUTO;
+
+	free(img);
+	free(image_reflected);
+}
+
+static void test_integer_plan(void **state) {
+	(void)state;
+
+	size_t taps[HOMV_MATRIX_MAX] = {
+			[HOMV_MATRIX_SHARPEN] = 5,
+			[HOMV_MATRIX_BLUR] = 9,
+			[HOMV_MATRIX_IDENTITY] = 1,
+			[HOMV_MATRIX_BOTTOM_SOBEL] = 6,
+			[HOMV_MATRIX_OUTLINE] = 9,
+	};
+	for (size_t i = 0; i < HOMV_MATRIX_MAX; i++) {
+		homv_plan *plan = homv_plan_create(homv_matrices[i]);
+		// Kernels with zero taps skip them, dense ones keep integer blocks
+		assert_int_equal(plan->kind, taps[i] < 9 ? HOMV_PLAN_SPARSE : HOMV_PLAN_INTEGER);
+		assert_int_equal(plan->divisor, i == HOMV_MATRIX_BLUR ? 9 : 1);
+		assert_int_equal(plan->sparse_count, taps[i] < 9 ? taps[i] : 0);
+		homv_plan_free(plan);
+	}
+}
+
+static void test_integer_method(void **state) {
+	(void)state;
+
+	LOAD_IMAGE("./input/sticker.jpg");
+	area_width = area_height = 64;
+
+	for (size_t kernel = 0; kernel < HOMV_MATRIX_MAX; kernel++) {
+		matrix = homv_matrices[kernel];
+		homv_plan_force = HOMV_PLAN_DIRECT;
+		uint8_t *first_output = homv_apply_seq(image_reflected, width, height, channels, matrix);
+		homv_plan_force = HOMV_PLAN_INTEGER;
+		uint8_t *second_output = homv_apply_parallel_area(image_reflected, width, height, channels, matrix);
+		homv_plan_force = HOMV_PLAN_AUTO;
+
+		// Float sums of these kernels are exact or far from rounding boundary, so both paths are equal
+		for (ssize_t i = 0; i < width * height * channels; i++) {
+			assert_int_equal(first_output[i], second_output[i]);
+		}
+
+		free(first_output);
+		free(second_output);
+	}
+
+	free(img);
+	free(image_reflected);
+}
+
+static void test_sparse_method(void **state) {
+	(void)state;
+
+	LOAD_IMAGE("./input/sticker.jpg");
+	area_width = area_height = 64;
+
+	for (size_t kernel = 0; kernel < HOMV_MATRIX_MAX; kernel++) {
+		matrix = homv_matrices[kernel];
+		homv_plan_force = HOMV_PLAN_INTEGER;
+		uint8_t *first_output = homv_apply_seq(image_reflected, width, height, channels, matrix);
+		homv_plan_force = HOMV_PLAN_SPARSE;
+		uint8_t *second_output = homv_apply_parallel_area(image_reflected, width, height, channels, matrix);
+		homv_plan_force = HOMV_PLAN_AUTO;
+
+		// Same int16 sums, only zero taps are skipped
+		for (ssize_t i = 0; i < width * height * channels; i++) {
+			assert_int_equal(first_output[i], second_output[i]);
+		}
+
+		// Identity kernel is copy of input
+		if (kernel == HOMV_MATRIX_IDENTITY) {
+			uint8_t *third_output = homv_apply(HOMV_STRATEGY_SEQ, img, width, height, channels, matrix);
+			assert_memory_equal(third_output, img, width * height * channels);
+			free(third_output);
+		}
+
+		free(first_output);
+		free(second_output);
+	}
+
+	// Unpadded rows of 37 pixels are not a multiple of vectors of any instruction set, border patches
+	// and all rows of 5 pixels are narrower than one vector
+	int noise_widths[] = {37, 5};
+	for (size_t w = 0; w < sizeof(noise_widths) / sizeof(noise_widths[0]); w++) {
+		int noise_width = noise_widths[w], noise_height = 23, noise_channels = 3;
+		size_t noise_size = (size_t)noise_width * noise_height * noise_channels;
+		uint8_t *noise = malloc(noise_size);
+		for (size_t i = 0; i < noise_size; i++) {
+			noise[i] = rand() % 256;
+		}
+		for (size_t kernel = 0; kernel < HOMV_MATRIX_MAX; kernel++) {
+			matrix = homv_matrices[kernel];
+			uint8_t *reflected = homv_reflect_image(noise, noise_width, noise_height, noise_channels, matrix.size);
+			homv_plan_force = HOMV_PLAN_DIRECT;
+			homv_simd_select(HOMV_ISA_SCALAR);
+			uint8_t *expected = homv_apply_seq(reflected, noise_width, noise_height, noise_channels, matrix);
+			homv_plan_force = HOMV_PLAN_SPARSE;
+			for (homv_isa isa = HOMV_ISA_SCALAR; isa < HOMV_ISA_MAX; isa++) {
+				if (!homv_simd_select(isa)) {
+					continue;
+				}
+				uint8_t *output = homv_apply(HOMV_STRATEGY_ROWS, noise, noise_width, noise_height, noise_channels, matrix);
+				for (size_t i = 0; i < noise_size; i++) {
+					assert_int_equal(expected[i], output[i]);
+				}
+				free(output);
+			}
+			homv_simd_select(HOMV_ISA_AUTO);
+			homv_plan_force = HOMV_PLAN_AUTO;
+			free(expected);
+			free(reflected);
+		}
+		free(noise);
+	}
+
+	free(img);
+	free(image_reflected);
+}
+
+// Random kernel made symmetric (sign 1), antisymmetric (sign -1) or left as is (sign 0)
+// about vertical axis, horizontal axis and center in that order
+static homv_matrix *symmetric_matrix(size_t size, int sign_x, int sign_y, int sign_point) {
+	homv_matrix *matrix = homv_mx_get_random_matrix(size);
+	int signs[] = {sign_x, sign_y, sign_point};
+	double *mirrored = malloc(size * size * sizeof(double));
+	for (size_t axis = 0; axis < 3; axis++) {
+		if (!signs[axis]) {
+			continue;
+		}
+		for (size_t y = 0; y < size; y++) {
+			for (size_t x = 0; x < size; x++) {
+				size_t mirror_x = axis != 1 ? size - 1 - x : x;
+				size_t mirror_y = axis != 0 ? size - 1 - y : y;
+				mirrored[y * size + x] = matrix->values[mirror_y * size + mirror_x];
+			}
+		}
+		for (size_t i = 0; i < size * size; i++) {
+			matrix->values[i] = (matrix->values[i] + signs[axis] * mirrored[i]) / 2;
+		}
+	}
+	free(mirrored);
+	return matrix;
+}
+
+static void test_symmetric_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	area_width = area_height = 64;
+
+	int cases[][3] = {{1, 1, 0}, {1, -1, 0}, {-1, 1, 0}, {-1, -1, 0}, {1, 0, 0},
+	                  {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+	size_t sizes[] = {3, 4, 7, 11, 12};
+	for (size_t size = 0; size < sizeof(sizes) / sizeof(sizes[0]); size++) {
+		for (size_t kind = 0; kind < sizeof(cases) / sizeof(cases[0]); kind++) {
+			homv_matrix *matrix = symmetric_matrix(sizes[size], cases[kind][0], cases[kind][1], cases[kind][2]);
+			homv_plan_force = HOMV_PLAN_SYMMETRIC;
+			homv_plan *plan = homv_plan_create(*matrix);
+			assert_int_equal(plan->kind, HOMV_PLAN_SYMMETRIC);
+			assert_true(!cases[kind][0] || plan->symmetry_x == cases[kind][0]);
+			assert_true(!cases[kind][1] || plan->symmetry_y == cases[kind][1]);
+			assert_true(!cases[kind][2] || plan->symmetry_point == cases[kind][2]);
+			// Large kernels symmetric about both axes keep a quarter of multiplies
+			bool quarter = cases[kind][0] && cases[kind][1] && sizes[size] >= 9;
+			assert_true(!quarter || plan->fold == HOMV_FOLD_QUARTER);
+			homv_plan_free(plan);
+
+			homv_plan_force = HOMV_PLAN_DIRECT;
+			uint8_t *first_output = homv_apply(HOMV_STRATEGY_SEQ, img, width, height, channels, *matrix);
+			homv_plan_force = HOMV_PLAN_SYMMETRIC;
+			// Quarter fold runs float pairs of every instruction set
+			for (homv_isa isa = HOMV_ISA_AUTO; isa < (quarter ? HOMV_ISA_MAX : HOMV_ISA_SCALAR); isa++) {
+				if (!homv_simd_select(isa)) {
+					continue;
+				}
+				uint8_t *second_output = homv_apply(HOMV_STRATEGY_AREA, img, width, height, channels, *matrix);
+				// Folded sums are rounded in other order
+				for (ssize_t i = 0; i < width * height * channels; i++) {
+					assert_true(abs(first_output[i] - second_output[i]) <= 1);
+				}
+				free(second_output);
+			}
+			homv_simd_select(HOMV_ISA_AUTO);
+			homv_plan_force = HOMV_PLAN_AUTO;
+
+			homv_mx_free(matrix);
+			free(first_output);
+		}
+	}
+
+	free(img);
+}
+
+static void test_kernel_fits(void **state) {
+	(void)state;
+
+	int width = 20, height = 12, channels = 3;
+	size_t values = (size_t)width * height * channels;
+	uint8_t *img = malloc(values);
+	for (size_t i = 0; i < values; i++) {
+		img[i] = rand() % 256;
+	}
+	uint8_t *output = malloc(values);
+	uint8_t *outputs[] = {output, output};
+
+	// Borders are reflected once: radius 11 fits 12 rows, radius 12 does not
+	homv_matrix *fits = homv_mx_get_box_matrix(23);
+	homv_matrix *large = homv_mx_get_box_matrix(25);
+	homv_matrix *wide = homv_mx_get_gauss_matrix(7);
+	homv_matrix chain[] = {*fits, *large};
+	homv_matrix fanout[] = {*fits, *wide};
+	for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_MAX; strategy++) {
+		uint8_t *result = homv_apply(strategy, img, width, height, channels, *fits);
+		assert_non_null(result);
+		free(result);
+		assert_null(homv_apply(strategy, img, width, height, channels, *large));
+		assert_null(homv_apply(strategy, img, width, height, channels, *wide));
+		assert_false(homv_apply_into(strategy, img, width, height, channels, *large, output, width * channels));
+		assert_null(homv_apply_chain(strategy, img, width, height, channels, chain, 2));
+		assert_false(homv_apply_fanout_into(strategy, img, width, height, channels, fanout, 2, outputs,
+		                                    width * channels));
+		assert_false(homv_apply_typed_into(strategy, HOMV_TYPE_U8, img, width, height, channels, chain, 2,
+		                                   HOMV_TYPE_F32, output, width * channels * sizeof(float)));
+	}
+	assert_null(homv_reflect_image(img, width, height, channels, large->size));
+	uint8_t *reflected = homv_reflect_image(img, width, height, channels, fits->size);
+	assert_non_null(reflected);
+	free(reflected);
+
+	homv_mx_free(fits);
+	homv_mx_free(large);
+	homv_mx_free(wide);
+	free(output);
+	free(img);
+}
+
+static void test_box_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	area_width = area_height = 5;
+
+	size_t sizes[] = {3, 8, 15};
+	for (size_t size = 0; size < sizeof(sizes) / sizeof(sizes[0]); size++) {
+		homv_matrix *matrix = homv_mx_get_box_matrix(sizes[size]);
+		homv_plan *plan = homv_plan_create(*matrix);
+		// Small box is cheaper with int16 blocks
+		assert_int_equal(plan->kind, sizes[size] > 3 ? HOMV_PLAN_BOX : HOMV_PLAN_INTEGER);
+		homv_plan_free(plan);
+
+		homv_plan_force = HOMV_PLAN_DIRECT;
+		uint8_t *first_output = homv_apply(HOMV_STRATEGY_SEQ, img, width, height, channels, *matrix);
+		homv_plan_force = HOMV_PLAN_BOX;
+		for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_FFT; strategy++) {
+			uint8_t *second_output = homv_apply(strategy, img, width, height, channels, *matrix);
+			// Direct float sums are rounded, box sums are exact
+			for (ssize_t i = 0; i < width * height * channels; i++) {
+				assert_true(abs(first_output[i] - second_output[i]) <= 1);
+			}
+			free(second_output);
+		}
+		homv_plan_force = HOMV_PLAN_AUTO;
+
+		homv_mx_free(matrix);
+		free(first_output);
+	}
+
+	free(img);
+}
+
+static void test_gauss_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+
+	double sigmas[] = {2, 4, 6, 12.5};
+	for (size_t sigma = 0; sigma < sizeof(sigmas) / sizeof(sigmas[0]); sigma++) {
+		homv_matrix *matrix = homv_mx_get_gauss_matrix(sigmas[sigma]);
+		assert_int_equal(matrix->size, 2 * (size_t)ceil(3 * sigmas[sigma]) + 1);
+		homv_plan *plan = homv_plan_create(*matrix);
+		// Small Gaussians are cheaper with separable passes
+		assert_int_equal(plan->kind, sigmas[sigma] > 4 ? HOMV_PLAN_RECURSIVE : HOMV_PLAN_SEPARABLE);
+		homv_plan_free(plan);
+
+		homv_plan_force = HOMV_PLAN_SEPARABLE;
+		uint8_t *first_output = homv_apply(HOMV_STRATEGY_SEQ, img, width, height, channels, *matrix);
+		homv_plan_force = HOMV_PLAN_RECURSIVE;
+		uint8_t *recursive_output = homv_apply(HOMV_STRATEGY_SEQ, img, width, height, channels, *matrix);
+		// Recursive filter approximates Gaussian within a level, also at reflected borders
+		double error = 0;
+		for (ssize_t i = 0; i < width * height * channels; i++) {
+			assert_true(abs(first_output[i] - recursive_output[i]) <= 1);
+			error += abs(first_output[i] - recursive_output[i]);
+		}
+		assert_true(error / (width * height * channels) < 0.1);
+
+		// Every strategy and padded image give the same recursive result
+		for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_MAX; strategy++) {
+			uint8_t *second_output = homv_apply(strategy, img, width, height, channels, *matrix);
+			assert_memory_equal(recursive_output, second_output, width * height * channels);
+			free(second_output);
+		}
+		uint8_t *image_reflected = homv_reflect_image(img, width, height, channels, matrix->size);
+		uint8_t *padded_output = homv_apply_parallel_rows(image_reflected, width, height, channels, *matrix);
+		assert_memory_equal(recursive_output, padded_output, width * height * channels);
+		homv_plan_force = HOMV_PLAN_AUTO;
+
+		homv_mx_free(matrix);
+		free(first_output);
+		free(recursive_output);
+		free(image_reflected);
+		free(padded_output);
+	}
+
+	free(img);
+}
+
+static void test_winograd_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	// Odd areas have tiles cut by area border
+	area_width = area_height = 5;
+
+	homv_matrix *random = homv_mx_get_random_matrix(3);
+	homv_matrix matrices[HOMV_MATRIX_MAX + 1];
+	for (size_t i = 0; i < HOMV_MATRIX_MAX; i++) {
+		matrices[i] = homv_matrices[i];
+	}
+	matrices[HOMV_MATRIX_MAX] = *random;
+
+	for (size_t i = 0; i < HOMV_MATRIX_MAX + 1; i++) {
+		uint8_t *image_reflected = homv_reflect_image(img, width, height, channels, matrices[i].size);
+		homv_plan_force = HOMV_PLAN_DIRECT;
+		uint8_t *first_output = homv_apply_seq(image_reflected, width, height, channels, matrices[i]);
+		homv_plan_force = HOMV_PLAN_WINOGRAD;
+		uint8_t *padded_output = homv_apply_parallel_rows(image_reflected, width, height, channels, matrices[i]);
+		for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_FFT; strategy++) {
+			uint8_t *second_output = homv_apply(strategy, img, width, height, channels, matrices[i]);
+			// Transforms sum in different order than direct path
+			for (ssize_t j = 0; j < width * height * channels; j++) {
+				assert_true(abs(first_output[j] - second_output[j]) <= 1);
+			}
+			assert_memory_equal(padded_output, second_output, width * height * channels);
+			free(second_output);
+		}
+		homv_plan_force = HOMV_PLAN_AUTO;
+
+		free(image_reflected);
+		free(first_output);
+		free(padded_output);
+	}
+
+	// Tiles are anchored to even image coordinates, so padded image, borders and areas at odd offsets give
+	// the same pixels. Noise and random kernels hit rounding boundaries that a photo may miss
+	int noise_width = 257, noise_height = 131, noise_channels = 3;
+	size_t noise_size = (size_t)noise_width * noise_height * noise_channels;
+	uint8_t *noise = malloc(noise_size);
+	homv_plan_force = HOMV_PLAN_WINOGRAD;
+	for (size_t round = 0; round < 20; round++) {
+		for (size_t i = 0; i < noise_size; i++) {
+			noise[i] = rand() % 256;
+		}
+		homv_matrix *kernel = homv_mx_get_random_matrix(3);
+		uint8_t *reflected = homv_reflect_image(noise, noise_width, noise_height, noise_channels, kernel->size);
+		for (homv_isa isa = HOMV_ISA_SCALAR; isa < HOMV_ISA_MAX; isa++) {
+			if (!homv_simd_select(isa)) {
+				continue;
+			}
+			uint8_t *padded_output =
+			    homv_apply_parallel_rows(reflected, noise_width, noise_height, noise_channels, *kernel);
+			for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_FFT; strategy++) {
+				uint8_t *output = homv_apply(strategy, noise, noise_width, noise_height, noise_channels, *kernel);
+				assert_memory_equal(output, padded_output, noise_size);
+				free(output);
+			}
+			free(padded_output);
+		}
+		homv_simd_select(HOMV_ISA_AUTO);
+		free(reflected);
+		homv_mx_free(kernel);
+	}
+	homv_plan_force = HOMV_PLAN_AUTO;
+	free(noise);
+
+	// Winograd saves multiplies, which pays off only without FMA
+	homv_simd_select(HOMV_ISA_SCALAR);
+	homv_plan *plan = homv_plan_create(*random);
+	assert_int_equal(plan->kind, HOMV_PLAN_WINOGRAD);
+	homv_plan_free(plan);
+	homv_simd_select(HOMV_ISA_AUTO);
+	plan = homv_plan_create(*random);
+	assert_int_equal(plan->kind, homv_simd->isa == HOMV_ISA_SCALAR ? HOMV_PLAN_WINOGRAD : HOMV_PLAN_DIRECT);
+	homv_plan_free(plan);
+
+	homv_mx_free(random);
+	free(img);
+}
+
+static void test_chain_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	area_width = area_height = 5;
+
+	homv_matrix *random_odd = homv_mx_get_random_matrix(5);
+	homv_matrix *random_even = homv_mx_get_random_matrix(4);
+	homv_matrix *box = homv_mx_get_box_matrix(7);
+	homv_matrix chain[] = {homv_matrices[HOMV_MATRIX_BLUR], homv_matrices[HOMV_MATRIX_SHARPEN],
+	                       homv_matrices[HOMV_MATRIX_OUTLINE], *random_odd, *box, *random_even};
+	size_t chain_count = sizeof(chain) / sizeof(chain[0]);
+
+	// Composed kernels round intermediate pixels differently
+	homv_plan_compose = false;
+	for (size_t count = 1; count <= chain_count; count++) {
+		// Every kernel of chain is applied to whole output of previous one
+		uint8_t *expected = homv_apply(HOMV_STRATEGY_SEQ, img, width, height, channels, chain[0]);
+		for (size_t i = 1; i < count; i++) {
+			uint8_t *next = homv_apply(HOMV_STRATEGY_SEQ, expected, width, height, channels, chain[i]);
+			free(expected);
+			expected = next;
+		}
+
+		for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_FFT; strategy++) {
+			uint8_t *output = homv_apply_chain(strategy, img, width, height, channels, chain, count);
+			assert_memory_equal(expected, output, width * height * channels);
+			free(output);
+		}
+		free(expected);
+	}
+	homv_plan_compose = true;
+
+	homv_mx_free(random_odd);
+	homv_mx_free(random_even);
+	homv_mx_free(box);
+	free(img);
+}
+
+static void test_compose_plan(void **state) {
+	(void)state;
+
+	// Box blur composed with itself is separable tent of 1 2 3 2 1
+	homv_matrix *box = homv_mx_get_box_matrix(3);
+	homv_matrix *tent = homv_mx_convolve(box, box);
+	double tent_row[] = {1, 2, 3, 2, 1};
+	assert_int_equal(tent->size, 5);
+	for (size_t i = 0; i < 25; i++) {
+		assert_true(fabs(tent->values[i] - tent_row[i / 5] * tent_row[i % 5] / 81) < 1e-12);
+	}
+
+	// Even kernels keep their center after middle, so one zero row and column are added at the end
+	homv_matrix *random = homv_mx_get_random_matrix(4);
+	homv_matrix *composed = homv_mx_convolve(random, random);
+	assert_int_equal(composed->size, 8);
+	for (size_t i = 0; i < 8; i++) {
+		assert_true(composed->values[7 * 8 + i] == 0 && composed->values[i * 8 + 7] == 0);
+	}
+
+	// Identity is composable and the composed sparse plan is cheaper than two stages
+	homv_matrix identity_outline[] = {homv_matrices[HOMV_MATRIX_IDENTITY], homv_matrices[HOMV_MATRIX_OUTLINE]};
+	homv_plan_chain *chain = homv_plan_chain_create(identity_outline, 2);
+	assert_int_equal(chain->count, 1);
+	assert_int_equal(chain->matrices[0]->size, 5);
+	homv_plan_chain_free(chain);
+
+	// Outline saturates its output, so it is never composed with the next kernel
+	homv_matrix outline_blur[] = {homv_matrices[HOMV_MATRIX_OUTLINE], homv_matrices[HOMV_MATRIX_BLUR]};
+	chain = homv_plan_chain_create(outline_blur, 2);
+	assert_int_equal(chain->count, 2);
+	homv_plan_chain_free(chain);
+
+	// Composed Gaussians are one separable pass instead of two
+	homv_matrix *gauss = homv_mx_get_gauss_matrix(1);
+	homv_matrix gausses[] = {*gauss, *gauss};
+	chain = homv_plan_chain_create(gausses, 2);
+	assert_int_equal(chain->count, 1);
+	assert_int_equal(chain->plans[0]->kind, HOMV_PLAN_SEPARABLE);
+	homv_plan_compose = false;
+	homv_plan_chain *separate = homv_plan_chain_create(gausses, 2);
+	homv_plan_compose = true;
+	assert_int_equal(separate->count, 2);
+	assert_true(homv_plan_chain_cost(chain) < homv_plan_chain_cost(separate));
+	assert_true(fabs(homv_plan_chain_cost(separate) - homv_plan_chain_separate_cost(gausses, 2)) < 1e-9);
+	homv_plan_chain_free(chain);
+	homv_plan_chain_free(separate);
+
+	// Composition is never reported as more expensive than separate stages, also for recursive Gaussians
+	double sigmas[] = {0.8, 2, 5, 12};
+	for (size_t i = 0; i < sizeof(sigmas) / sizeof(sigmas[0]); i++) {
+		homv_matrix *large = homv_mx_get_gauss_matrix(sigmas[i]);
+		homv_matrix mixed[] = {*large, *large, homv_matrices[HOMV_MATRIX_BLUR], *box};
+		for (size_t count = 2; count <= 4; count++) {
+			chain = homv_plan_chain_create(mixed, count);
+			assert_true(homv_plan_chain_cost(chain) <= homv_plan_chain_separate_cost(mixed, count) + 1e-9);
+			homv_plan_chain_free(chain);
+		}
+		homv_mx_free(large);
+	}
+
+	homv_mx_free(box);
+	homv_mx_free(tent);
+	homv_mx_free(random);
+	homv_mx_free(composed);
+	homv_mx_free(gauss);
+}
+
+static void test_compose_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+
+	// Zero taps added around outline do not change it
+	homv_matrix identity_outline[] = {homv_matrices[HOMV_MATRIX_IDENTITY], homv_matrices[HOMV_MATRIX_OUTLINE]};
+	uint8_t *expected = homv_apply(HOMV_STRATEGY_ROWS, img, width, height, channels, identity_outline[1]);
+	uint8_t *output = homv_apply_chain(HOMV_STRATEGY_ROWS, img, width, height, channels, identity_outline, 2);
+	assert_memory_equal(expected, output, width * height * channels);
+	free(expected);
+	free(output);
+
+	// Composed blurs differ from separate ones only by rounding of intermediate pixels, borders included.
+	// Rounding error is at most 1/2 and the last kernel multiplies it by sum of its absolute taps
+	homv_matrix *gauss = homv_mx_get_gauss_matrix(1);
+	homv_matrix blurs[] = {*gauss, homv_matrices[HOMV_MATRIX_BLUR], homv_matrices[HOMV_MATRIX_BOTTOM_SOBEL]};
+	int tolerances[] = {0, 0, 1, 4};
+	for (size_t count = 2; count <= 3; count++) {
+		homv_plan_compose = false;
+		expected = homv_apply_chain(HOMV_STRATEGY_SEQ, img, width, height, channels, blurs, count);
+		homv_plan_compose = true;
+		for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_FFT; strategy++) {
+			output = homv_apply_chain(strategy, img, width, height, channels, blurs, count);
+			for (ssize_t i = 0; i < width * height * channels; i++) {
+				assert_true(abs(expected[i] - output[i]) <= tolerances[count]);
+			}
+			free(output);
+		}
+		free(expected);
+	}
+
+	homv_mx_free(gauss);
+	free(img);
+}
+
+static void test_fanout_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	area_width = area_height = 5;
+
+	// Recursive Gaussian makes its own sweep, other kernels share one
+	homv_matrix *random = homv_mx_get_random_matrix(9);
+	homv_matrix *gauss = homv_mx_get_gauss_matrix(4);
+	homv_matrix *box = homv_mx_get_box_matrix(7);
+	homv_matrix fanout[] = {homv_matrices[HOMV_MATRIX_BLUR], homv_matrices[HOMV_MATRIX_OUTLINE], *random, *gauss, *box};
+	size_t fanout_count = sizeof(fanout) / sizeof(fanout[0]);
+
+	uint8_t *outputs[sizeof(fanout) / sizeof(fanout[0])];
+	for (size_t i = 0; i < fanout_count; i++) {
+		outputs[i] = malloc(width * height * channels);
+	}
+	for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_FFT; strategy++) {
+		homv_apply_fanout_into(strategy, img, width, height, channels, fanout, fanout_count, outputs, width * channels);
+		for (size_t i = 0; i < fanout_count; i++) {
+			uint8_t *expected = homv_apply(strategy, img, width, height, channels, fanout[i]);
+			assert_memory_equal(expected, outputs[i], width * height * channels);
+			free(expected);
+		}
+	}
+
+	for (size_t i = 0; i < fanout_count; i++) {
+		free(outputs[i]);
+	}
+	homv_mx_free(random);
+	homv_mx_free(gauss);
+	homv_mx_free(box);
+	free(img);
+}
+
+static void test_alpha_method(void **state) {
+	(void)state;
+
+	int width, height, colors;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &colors, 3);
+	assert_non_null(img);
+	colors = 3;
+	area_width = area_height = 5;
+
+	// Alpha is horizontal gradient with fully transparent left quarter
+	int channels = colors + 1;
+	uint8_t *rgba = malloc(width * height * channels);
+	uint8_t *premultiplied = malloc(width * height * channels);
+	for (ssize_t i = 0; i < width * height; i++) {
+		ssize_t x = i % width;
+		int alpha = x < width / 4 ? 0 : (int)(x * 255 / (width - 1));
+		for (ssize_t color = 0; color < colors; color++) {
+			rgba[i * channels + color] = img[i * colors + color];
+			premultiplied[i * channels + color] = (img[i * colors + color] * alpha + 127) / 255;
+		}
+		rgba[i * channels + colors] = premultiplied[i * channels + colors] = alpha;
+	}
+
+	homv_matrix *box = homv_mx_get_box_matrix(7);
+	homv_matrix *sobel = homv_mx_get_sobel_matrix(HOMV_MX_GRADIENT_MAGNITUDE);
+	// Cheap kernels convolve alpha in place in copy mode, random 9x9 packs colors without alpha
+	homv_matrix *random = homv_mx_get_random_matrix(9);
+	homv_matrix matrices[] = {homv_matrices[HOMV_MATRIX_BLUR], homv_matrices[HOMV_MATRIX_SHARPEN], *box, *sobel, *random};
+	size_t matrices_count = sizeof(matrices) / sizeof(matrices[0]);
+	for (size_t i = 0; i <= matrices_count; i++) {
+		// Last round checks the chain of all matrices
+		bool chain = i == matrices_count;
+		for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_MAX; strategy++) {
+			homv_alpha_mode = HOMV_ALPHA_COPY;
+			uint8_t *output = chain ? homv_apply_chain(strategy, rgba, width, height, channels, matrices, matrices_count)
+			                        : homv_apply(strategy, rgba, width, height, channels, matrices[i]);
+			homv_alpha_mode = HOMV_ALPHA_CONVOLVE;
+			uint8_t *expected = chain ? homv_apply_chain(strategy, img, width, height, colors, matrices, matrices_count)
+			                          : homv_apply(strategy, img, width, height, colors, matrices[i]);
+			for (ssize_t pixel = 0; pixel < width * height; pixel++) {
+				assert_memory_equal(output + pixel * channels, expected + pixel * colors, colors);
+				assert_int_equal(output[pixel * channels + colors], rgba[pixel * channels + colors]);
+			}
+			free(output);
+			free(expected);
+
+			homv_alpha_mode = HOMV_ALPHA_PREMULTIPLIED;
+			output = chain ? homv_apply_chain(strategy, rgba, width, height, channels, matrices, matrices_count)
+			               : homv_apply(strategy, rgba, width, height, channels, matrices[i]);
+			homv_alpha_mode = HOMV_ALPHA_CONVOLVE;
+			expected = chain ? homv_apply_chain(strategy, premultiplied, width, height, channels, matrices, matrices_count)
+			                 : homv_apply(strategy, premultiplied, width, height, channels, matrices[i]);
+			for (ssize_t pixel = 0; pixel < width * height; pixel++) {
+				int alpha = expected[pixel * channels + colors];
+				assert_int_equal(output[pixel * channels + colors], alpha);
+				for (ssize_t color = 0; color < colors; color++) {
+					int value = alpha ? (expected[pixel * channels + color] * 255 + alpha / 2) / alpha : 0;
+					assert_int_equal(output[pixel * channels + color], value > 255 ? 255 : value);
+				}
+			}
+			free(output);
+			free(expected);
+		}
+	}
+
+	uint8_t *outputs[] = {malloc(width * height * channels), malloc(width * height * channels)};
+	homv_alpha_mode = HOMV_ALPHA_COPY;
+	homv_apply_fanout_into(HOMV_STRATEGY_ROWS, rgba, width, height, channels, matrices, 2, outputs, width * channels);
+	for (size_t i = 0; i < 2; i++) {
+		uint8_t *expected = homv_apply(HOMV_STRATEGY_ROWS, rgba, width, height, channels, matrices[i]);
+		assert_memory_equal(expected, outputs[i], width * height * channels);
+		free(expected);
+		free(outputs[i]);
+	}
+	homv_alpha_mode = HOMV_ALPHA_CONVOLVE;
+
+	assert_int_equal(homv_alpha_parse("copy"), HOMV_ALPHA_COPY);
+	assert_int_equal(homv_alpha_parse("premultiplied"), HOMV_ALPHA_PREMULTIPLIED);
+	assert_int_equal(homv_alpha_parse("convolve"), HOMV_ALPHA_CONVOLVE);
+	assert_int_equal(homv_alpha_parse("straight"), HOMV_ALPHA_MAX);
+
+	homv_mx_free(box);
+	homv_mx_free(sobel);
+	homv_mx_free(random);
+	free(premultiplied);
+	free(rgba);
+	free(img);
+}
+
+static void test_gray_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 1);
+	assert_non_null(img);
+
+	// Narrow rows of one channel end with SIMD chunk that overlaps previous one
+	int widths[] = {71, 133, width};
+	homv_matrix *sobel = homv_mx_get_sobel_matrix(HOMV_MX_GRADIENT_MAGNITUDE);
+	homv_plan_kind kinds[] = {HOMV_PLAN_DIRECT, HOMV_PLAN_INTEGER, HOMV_PLAN_SPARSE, HOMV_PLAN_SYMMETRIC,
+	                          HOMV_PLAN_WINOGRAD, HOMV_PLAN_GRADIENT};
+	for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+		int crop_width = widths[w];
+		uint8_t *crop = malloc(crop_width * height);
+		for (ssize_t y = 0; y < height; y++) {
+			memcpy(crop + y * crop_width, img + y * width, crop_width);
+		}
+
+		for (size_t kind = 0; kind < sizeof(kinds) / sizeof(kinds[0]); kind++) {
+			bool gradient = kinds[kind] == HOMV_PLAN_GRADIENT;
+			homv_matrix matrix = gradient ? *sobel : homv_matrices[HOMV_MATRIX_SHARPEN];
+			homv_plan_force = gradient ? HOMV_PLAN_AUTO : kinds[kind];
+			homv_simd_select(HOMV_ISA_SCALAR);
+			uint8_t *expected = homv_apply(HOMV_STRATEGY_SEQ, crop, crop_width, height, 1, matrix);
+			for (homv_isa isa = HOMV_ISA_SSE41; isa < HOMV_ISA_MAX; isa++) {
+				if (!homv_simd_select(isa)) {
+					continue;
+				}
+				uint8_t *output = homv_apply(HOMV_STRATEGY_ROWS, crop, crop_width, height, 1, matrix);
+				// Integer sums are exact, variants with FMA round products differently
+				bool exact = kinds[kind] == HOMV_PLAN_INTEGER || kinds[kind] == HOMV_PLAN_SPARSE || gradient;
+				for (ssize_t i = 0; i < crop_width * height; i++) {
+					assert_true(abs(expected[i] - output[i]) <= (exact ? 0 : 1));
+				}
+				free(output);
+			}
+			free(expected);
+		}
+		free(crop);
+	}
+	homv_simd_select(HOMV_ISA_AUTO);
+	homv_plan_force = HOMV_PLAN_AUTO;
+
+	homv_mx_free(sobel);
+	free(img);
+}
+
+static void test_gradient_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	area_width = area_height = 5;
+
+	homv_mx_gradient gradients[] = {HOMV_MX_GRADIENT_MAGNITUDE, HOMV_MX_GRADIENT_DIRECTION};
+	for (size_t gradient = 0; gradient < 2; gradient++) {
+		homv_matrix *matrix = homv_mx_get_sobel_matrix(gradients[gradient]);
+		homv_plan *plan = homv_plan_create(*matrix);
+		assert_int_equal(plan->kind, HOMV_PLAN_GRADIENT);
+		homv_plan_free(plan);
+
+		uint8_t *expected = malloc(width * height * channels);
+		for (ssize_t y = 0; y < height; y++) {
+			for (ssize_t x = 0; x < width; x++) {
+				for (ssize_t color = 0; color < channels; color++) {
+					int sum_x = 0, sum_y = 0;
+					for (ssize_t dy = -1; dy <= 1; dy++) {
+						for (ssize_t dx = -1; dx <= 1; dx++) {
+							int value = img[(homv_reflect_index(y + dy, height) * width + homv_reflect_index(x + dx, width)) *
+							                    channels +
+							                color];
+							sum_x += dx * (2 - dy * dy) * value;
+							sum_y += dy * (2 - dx * dx) * value;
+						}
+					}
+					double magnitude = sqrt(sum_x * sum_x + sum_y * sum_y);
+					expected[(y * width + x) * channels + color] =
+					    gradients[gradient] == HOMV_MX_GRADIENT_MAGNITUDE
+					        ? (magnitude > 255 ? 255 : (uint8_t)(magnitude + 0.5))
+					        : (uint8_t)(lrint(atan2(sum_y, sum_x) * 128 / M_PI) & 255);
+				}
+			}
+		}
+
+		for (homv_isa isa = HOMV_ISA_SCALAR; isa < HOMV_ISA_MAX; isa++) {
+			if (!homv_simd_select(isa)) {
+				continue;
+			}
+			for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_MAX; strategy++) {
+				uint8_t *output = homv_apply(strategy, img, width, height, channels, *matrix);
+				// Direction of float atan2f may be one step off near rounding boundary
+				for (ssize_t i = 0; i < width * height * channels; i++) {
+					assert_true(gradients[gradient] == HOMV_MX_GRADIENT_MAGNITUDE ? expected[i] == output[i]
+					                                                              : ((expected[i] - output[i] + 1) & 255) <= 2);
+				}
+				free(output);
+			}
+		}
+		homv_simd_select(HOMV_ISA_AUTO);
+
+		free(expected);
+		homv_mx_free(matrix);
+	}
+
+	// Blur is not composed with gradient, chain equals two passes
+	homv_matrix *magnitude = homv_mx_get_sobel_matrix(HOMV_MX_GRADIENT_MAGNITUDE);
+	homv_matrix chain[] = {homv_matrices[HOMV_MATRIX_BLUR], *magnitude};
+	uint8_t *blurred = homv_apply(HOMV_STRATEGY_ROWS, img, width, height, channels, chain[0]);
+	uint8_t *expected = homv_apply(HOMV_STRATEGY_ROWS, blurred, width, height, channels, chain[1]);
+	uint8_t *output = homv_apply_chain(HOMV_STRATEGY_ROWS, img, width, height, channels, chain, 2);
+	assert_memory_equal(expected, output, width * height * channels);
+
+	free(blurred);
+	free(expected);
+	free(output);
+	homv_mx_free(magnitude);
+	free(img);
+}
+
+static void test_wide_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	size_t values = (size_t)width * height * channels;
+	uint16_t *wide = malloc(values * sizeof(uint16_t));
+	for (size_t i = 0; i < values; i++) {
+		wide[i] = img[i] * 257;
+	}
+
+	// 16-bit PNG is read back by stb_image as it was written
+	assert_true(homv_png_write_u16("./build/test_wide.png", width, height, channels, wide));
+	assert_true(stbi_is_16_bit("./build/test_wide.png"));
+	int png_width, png_height, png_channels;
+	uint16_t *png = stbi_load_16("./build/test_wide.png", &png_width, &png_height, &png_channels, 0);
+	assert_non_null(png);
+	assert_int_equal(png_width, width);
+	assert_int_equal(png_height, height);
+	assert_int_equal(png_channels, channels);
+	assert_memory_equal(png, wide, values * sizeof(uint16_t));
+	stbi_image_free(png);
+	remove("./build/test_wide.png");
+
+	// Convolution of image scaled to 16 bits is 8-bit convolution scaled the same way, up to rounding of 8-bit values
+	homv_matrix *kernels[] = {&homv_matrices[HOMV_MATRIX_BLUR],
+	                          &homv_matrices[HOMV_MATRIX_SHARPEN],
+	                          &homv_matrices[HOMV_MATRIX_OUTLINE],
+	                          homv_mx_get_box_matrix(5),
+	                          homv_mx_get_gauss_matrix(1),
+	                          homv_mx_get_gauss_matrix(6),
+	                          homv_mx_get_sobel_matrix(HOMV_MX_GRADIENT_MAGNITUDE),
+	                          homv_mx_get_sobel_matrix(HOMV_MX_GRADIENT_DIRECTION)};
+	size_t kernels_count = sizeof(kernels) / sizeof(kernels[0]);
+	area_width = area_height = 5;
+	uint16_t *output = malloc(values * sizeof(uint16_t));
+	for (size_t kernel = 0; kernel < kernels_count; kernel++) {
+		homv_matrix matrix = *kernels[kernel];
+		bool direction = matrix.gradient == HOMV_MX_GRADIENT_DIRECTION;
+		uint8_t *narrow = homv_apply(HOMV_STRATEGY_SEQ, img, width, height, channels, matrix);
+		uint16_t *expected = malloc(values * sizeof(uint16_t));
+		homv_simd_select(HOMV_ISA_SCALAR);
+		homv_apply_typed_into(HOMV_STRATEGY_SEQ, HOMV_TYPE_U16, wide, width, height, channels, &matrix, 1,
+		                      HOMV_TYPE_U16, expected, (size_t)width * channels * sizeof(uint16_t));
+		for (size_t i = 0; i < values; i++) {
+			if (direction) {
+				// 256 steps of 8-bit direction are 65536 steps of 16-bit one
+				assert_true((((expected[i] + 128) / 256 - narrow[i] + 1) & 255) <= 2);
+			} else {
+				assert_true(abs(expected[i] - narrow[i] * 257) <= 257);
+			}
+		}
+		free(narrow);
+
+		// Every strategy computes every value the same way, instruction sets round products differently.
+		// Recursive filter carries rounding along rows and columns
+		homv_plan *plan = homv_plan_create(matrix);
+		int tolerance = plan->kind == HOMV_PLAN_RECURSIVE ? 2 : 1;
+		homv_plan_free(plan);
+		for (homv_isa isa = HOMV_ISA_SCALAR; isa < HOMV_ISA_MAX; isa++) {
+			if (!homv_simd_select(isa)) {
+				continue;
+			}
+			for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_MAX; strategy++) {
+				homv_apply_typed_into(strategy, HOMV_TYPE_U16, wide, width, height, channels, &matrix, 1, HOMV_TYPE_U16,
+				                      output, (size_t)width * channels * sizeof(uint16_t));
+				for (size_t i = 0; i < values; i++) {
+					assert_true(abs(expected[i] - output[i]) <= (isa == HOMV_ISA_SCALAR ? 0 : tolerance));
+				}
+			}
+		}
+		homv_simd_select(HOMV_ISA_AUTO);
+		free(expected);
+	}
+
+	// Chain goes through float intermediate image
+	homv_matrix chain[] = {homv_matrices[HOMV_MATRIX_BLUR], homv_matrices[HOMV_MATRIX_SHARPEN]};
+	float *blurred = malloc(values * sizeof(float));
+	uint16_t *expected = malloc(values * sizeof(uint16_t));
+	homv_apply_typed_into(HOMV_STRATEGY_SEQ, HOMV_TYPE_U16, wide, width, height, channels, &chain[0], 1, HOMV_TYPE_F32,
+	                      blurred, (size_t)width * channels * sizeof(float));
+	homv_apply_typed_into(HOMV_STRATEGY_SEQ, HOMV_TYPE_F32, blurred, width, height, channels, &chain[1], 1,
+	                      HOMV_TYPE_U16, expected, (size_t)width * channels * sizeof(uint16_t));
+	homv_apply_typed_into(HOMV_STRATEGY_ROWS, HOMV_TYPE_U16, wide, width, height, channels, chain, 2, HOMV_TYPE_U16,
+	                      output, (size_t)width * channels * sizeof(uint16_t));
+	assert_memory_equal(output, expected, values * sizeof(uint16_t));
+
+	// 8-bit input with 16-bit output keeps fractions of 8-bit sums only as rounding, identity is exact
+	homv_apply_typed_into(HOMV_STRATEGY_ROWS, HOMV_TYPE_U8, img, width, height, channels,
+	                      &homv_matrices[HOMV_MATRIX_IDENTITY], 1, HOMV_TYPE_U16, output,
+	                      (size_t)width * channels * sizeof(uint16_t));
+	for (size_t i = 0; i < values; i++) {
+		assert_int_equal(output[i], img[i]);
+	}
+
+	for (size_t kernel = 3; kernel < kernels_count; kernel++) {
+		homv_mx_free(kernels[kernel]);
+	}
+	free(blurred);
+	free(expected);
+	free(output);
+	free(wide);
+	free(img);
+}
+
+static void test_float_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	size_t values = (size_t)width * height * channels;
+	size_t stride = (size_t)width * channels * sizeof(float);
+	float *image = malloc(values * sizeof(float));
+	for (size_t i = 0; i < values; i++) {
+		image[i] = img[i] / 255.0f;
+	}
+
+	// Radiance HDR keeps 8 bits of mantissa shared by channels of pixel
+	assert_true(stbi_write_hdr("./build/test_float.hdr", width, height, channels, image));
+	assert_true(stbi_is_hdr("./build/test_float.hdr"));
+	int hdr_width, hdr_height, hdr_channels;
+	float *hdr = stbi_loadf("./build/test_float.hdr", &hdr_width, &hdr_height, &hdr_channels, channels);
+	assert_non_null(hdr);
+	assert_int_equal(hdr_width, width);
+	assert_int_equal(hdr_height, height);
+	for (size_t i = 0; i < values; i++) {
+		assert_true(fabsf(hdr[i] - image[i]) <= 1.0f / 128);
+	}
+	stbi_image_free(hdr);
+	remove("./build/test_float.hdr");
+
+	// Float sums are not clamped: Sobel and sharpen keep negative values, direction is in radians
+	homv_matrix *kernels[] = {&homv_matrices[HOMV_MATRIX_SHARPEN],
+	                          &homv_matrices[HOMV_MATRIX_BOTTOM_SOBEL],
+	                          &homv_matrices[HOMV_MATRIX_OUTLINE],
+	                          homv_mx_get_box_matrix(5),
+	                          homv_mx_get_gauss_matrix(1),
+	                          homv_mx_get_gauss_matrix(6),
+	                          homv_mx_get_sobel_matrix(HOMV_MX_GRADIENT_MAGNITUDE),
+	                          homv_mx_get_sobel_matrix(HOMV_MX_GRADIENT_DIRECTION)};
+	size_t kernels_count = sizeof(kernels) / sizeof(kernels[0]);
+	area_width = area_height = 5;
+	float *expected = malloc(values * sizeof(float));
+	float *output = malloc(values * sizeof(float));
+	for (size_t kernel = 0; kernel < kernels_count; kernel++) {
+		homv_matrix matrix = *kernels[kernel];
+		homv_plan *plan = homv_plan_create(matrix);
+		bool recursive = plan->kind == HOMV_PLAN_RECURSIVE;
+		homv_plan_free(plan);
+		homv_simd_select(HOMV_ISA_SCALAR);
+		homv_apply_typed_into(HOMV_STRATEGY_SEQ, HOMV_TYPE_F32, image, width, height, channels, &matrix, 1,
+		                      HOMV_TYPE_F32, expected, stride);
+
+		// Direct sums in doubles, recursive filter approximates Gaussian and is only compared between runs
+		ssize_t size = (ssize_t)matrix.size;
+		bool negative = false;
+		for (ssize_t y = 0; y < height && !recursive; y++) {
+			for (ssize_t x = 0; x < width; x++) {
+				for (ssize_t color = 0; color < channels; color++) {
+					double sum = 0, sum_x = 0, sum_y = 0;
+					for (ssize_t dy = 0; dy < size; dy++) {
+						for (ssize_t dx = 0; dx < size; dx++) {
+							double value = image[(homv_reflect_index(y + dy - size / 2, height) * width +
+							                      homv_reflect_index(x + dx - size / 2, width)) *
+							                         channels +
+							                     color];
+							sum += matrix.values[dy * size + dx] * value;
+							sum_x += (dx - 1) * (2 - (dy - 1) * (dy - 1)) * value;
+							sum_y += (dy - 1) * (2 - (dx - 1) * (dx - 1)) * value;
+						}
+					}
+					if (matrix.gradient == HOMV_MX_GRADIENT_MAGNITUDE) {
+						sum = sqrt(sum_x * sum_x + sum_y * sum_y);
+					} else if (matrix.gradient == HOMV_MX_GRADIENT_DIRECTION) {
+						sum = atan2(sum_y, sum_x);
+					}
+					float value = expected[(y * width + x) * channels + color];
+					negative = negative || value < 0;
+					// Directions pi and -pi are the same, direction of zero gradient depends on rounding errors
+					bool direction = matrix.gradient == HOMV_MX_GRADIENT_DIRECTION;
+					bool flat = direction && fabs(sum_x) + fabs(sum_y) < 1e-4;
+					assert_true(flat || fabs(direction ? remainder(value - sum, 2 * M_PI) : value - sum) <= 1e-4);
+				}
+			}
+		}
+		if (matrix.values == matrix_bottom_sobel || matrix.values == matrix_outline) {
+			assert_true(negative);
+		}
+
+		// Every strategy computes every value the same way, instruction sets round products differently.
+		// Recursive filter carries rounding along rows and columns
+		float tolerance = recursive ? 1e-4f : 1e-5f;
+		for (homv_isa isa = HOMV_ISA_SCALAR; isa < HOMV_ISA_MAX; isa++) {
+			if (!homv_simd_select(isa)) {
+				continue;
+			}
+			for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_MAX; strategy++) {
+				homv_apply_typed_into(strategy, HOMV_TYPE_F32, image, width, height, channels, &matrix, 1, HOMV_TYPE_F32,
+				                      output, stride);
+				for (size_t i = 0; i < values; i++) {
+					bool flat = matrix.gradient == HOMV_MX_GRADIENT_DIRECTION && fabsf(output[i] - expected[i]) > 3;
+					assert_true(flat || fabsf(output[i] - expected[i]) <= (isa == HOMV_ISA_SCALAR ? 0 : tolerance));
+				}
+			}
+		}
+		homv_simd_select(HOMV_ISA_AUTO);
+	}
+
+	// Chain of float image rounds nothing between kernels
+	homv_matrix chain[] = {homv_matrices[HOMV_MATRIX_BLUR], homv_matrices[HOMV_MATRIX_BOTTOM_SOBEL]};
+	float *blurred = malloc(values * sizeof(float));
+	homv_apply_typed_into(HOMV_STRATEGY_SEQ, HOMV_TYPE_F32, image, width, height, channels, &chain[0], 1, HOMV_TYPE_F32,
+	                      blurred, stride);
+	homv_apply_typed_into(HOMV_STRATEGY_SEQ, HOMV_TYPE_F32, blurred, width, height, channels, &chain[1], 1,
+	                      HOMV_TYPE_F32, expected, stride);
+	homv_apply_typed_into(HOMV_STRATEGY_ROWS, HOMV_TYPE_F32, image, width, height, channels, chain, 2, HOMV_TYPE_F32,
+	                      output, stride);
+	assert_memory_equal(output, expected, values * sizeof(float));
+
+	for (size_t kernel = 3; kernel < kernels_count; kernel++) {
+		homv_mx_free(kernels[kernel]);
+	}
+	free(blurred);
+	free(expected);
+	free(output);
+	free(image);
+	free(img);
+}
+
+static void test_signed_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	size_t values = (size_t)width * height * channels;
+	size_t float_stride = (size_t)width * channels * sizeof(float);
+	size_t signed_stride = (size_t)width * channels * sizeof(int16_t);
+	float *expected = malloc(values * sizeof(float));
+	int16_t *output = malloc(values * sizeof(int16_t));
+	area_width = area_height = 5;
+
+	// Signed output is float output rounded to nearest even and saturated, so derivatives keep their sign
+	homv_matrix *kernels[] = {&homv_matrices[HOMV_MATRIX_BOTTOM_SOBEL], homv_mx_get_gauss_matrix(6),
+	                          homv_mx_get_sobel_matrix(HOMV_MX_GRADIENT_MAGNITUDE)};
+	size_t kernels_count = sizeof(kernels) / sizeof(kernels[0]);
+	for (size_t kernel = 0; kernel < kernels_count; kernel++) {
+		homv_matrix matrix = *kernels[kernel];
+		homv_simd_select(HOMV_ISA_SCALAR);
+		homv_apply_typed_into(HOMV_STRATEGY_SEQ, HOMV_TYPE_U8, img, width, height, channels, &matrix, 1, HOMV_TYPE_F32,
+		                      expected, float_stride);
+		for (homv_isa isa = HOMV_ISA_SCALAR; isa < HOMV_ISA_MAX; isa++) {
+			if (!homv_simd_select(isa)) {
+				continue;
+			}
+			for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_MAX; strategy++) {
+				homv_apply_typed_into(strategy, HOMV_TYPE_U8, img, width, height, channels, &matrix, 1, HOMV_TYPE_I16,
+				                      output, signed_stride);
+				bool negative = false;
+				for (size_t i = 0; i < values; i++) {
+					float rounded = fminf(fmaxf(rintf(expected[i]), -32768), 32767);
+					negative = negative || output[i] < 0;
+					assert_true(fabsf(output[i] - rounded) <= (isa == HOMV_ISA_SCALAR ? 0 : 1));
+				}
+				assert_true(negative == (matrix.values == matrix_bottom_sobel));
+			}
+		}
+		homv_simd_select(HOMV_ISA_AUTO);
+	}
+
+	// Signed direction maps -pi..pi to whole range of int16
+	homv_matrix *direction = homv_mx_get_sobel_matrix(HOMV_MX_GRADIENT_DIRECTION);
+	homv_apply_typed_into(HOMV_STRATEGY_ROWS, HOMV_TYPE_U8, img, width, height, channels, direction, 1, HOMV_TYPE_F32,
+	                      expected, float_stride);
+	homv_apply_typed_into(HOMV_STRATEGY_ROWS, HOMV_TYPE_U8, img, width, height, channels, direction, 1, HOMV_TYPE_I16,
+	                      output, signed_stride);
+	for (size_t i = 0; i < values; i++) {
+		assert_int_equal(output[i], (int16_t)(lrintf(expected[i] * (float)(32768 / M_PI)) & 65535));
+	}
+
+	// Array file: header of .npy is padded to 64 bytes and describes values, then values follow as they are
+	homv_apply_typed_into(HOMV_STRATEGY_ROWS, HOMV_TYPE_U8, img, width, height, channels, kernels[0], 1, HOMV_TYPE_I16,
+	                      output, signed_stride);
+
+	// Signed input is widened exactly on every ISA, negative values included
+	for (homv_isa isa = HOMV_ISA_SCALAR; isa < HOMV_ISA_MAX; isa++) {
+		if (!homv_simd_select(isa)) {
+			continue;
+		}
+		homv_apply_typed_into(HOMV_STRATEGY_ROWS, HOMV_TYPE_I16, output, width, height, channels,
+		                      &homv_matrices[HOMV_MATRIX_IDENTITY], 1, HOMV_TYPE_F32, expected, float_stride);
+		for (size_t i = 0; i < values; i++) {
+			assert_true(expected[i] == output[i]);
+		}
+	}
+	homv_simd_select(HOMV_ISA_AUTO);
+
+	assert_true(homv_npy_write("./build/test_signed.npy", width, height, channels, HOMV_TYPE_I16, output));
+	FILE *file = fopen("./build/test_signed.npy", "rb");
+	assert_non_null(file);
+	uint8_t prefix[10];
+	assert_int_equal(fread(prefix, 1, sizeof(prefix), file), sizeof(prefix));
+	assert_memory_equal(prefix, "\x93NUMPY\x01\x00", 8);
+	size_t header_size = prefix[8] | prefix[9] << 8;
+	assert_int_equal((sizeof(prefix) + header_size) % 64, 0);
+	char *header = malloc(header_size + 1);
+	assert_int_equal(fread(header, 1, header_size, file), header_size);
+	header[header_size] = '\0';
+	char shape[64];
+	snprintf(shape, sizeof(shape), "'shape': (%d, %d, %d)", height, width, channels);
+	assert_non_null(strstr(header, "'descr': '<i2'"));
+	assert_non_null(strstr(header, shape));
+	assert_int_equal(header[header_size - 1], '\n');
+	int16_t *loaded = malloc(values * sizeof(int16_t) + 1);
+	assert_int_equal(fread(loaded, 1, values * sizeof(int16_t) + 1, file), values * sizeof(int16_t));
+	assert_memory_equal(loaded, output, values * sizeof(int16_t));
+	fclose(file);
+	remove("./build/test_signed.npy");
+
+	assert_true(homv_raw_write("./build/test_signed.raw", width, height, channels, HOMV_TYPE_I16, output));
+	file = fopen("./build/test_signed.raw", "rb");
+	assert_non_null(file);
+	assert_int_equal(fread(loaded, 1, values * sizeof(int16_t) + 1, file), values * sizeof(int16_t));
+	assert_memory_equal(loaded, output, values * sizeof(int16_t));
+	fclose(file);
+	remove("./build/test_signed.raw");
+
+	homv_mx_free(kernels[1]);
+	homv_mx_free(kernels[2]);
+	homv_mx_free(direction);
+	free(loaded);
+	free(header);
+	free(output);
+	free(expected);
+	free(img);
+}
+
+static void test_normalize_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	size_t values = (size_t)width * height * channels;
+	size_t stride = (size_t)width * channels;
+	float *floats = malloc(values * sizeof(float));
+	uint8_t *expected = malloc(values);
+	uint8_t *output = malloc(values);
+	area_width = area_height = 5;
+
+	// Min and max of float output are mapped to 0 and 255, also for chains and recursive filter
+	homv_matrix chain[] = {homv_matrices[HOMV_MATRIX_BLUR], homv_matrices[HOMV_MATRIX_BOTTOM_SOBEL]};
+	homv_matrix *gauss = homv_mx_get_gauss_matrix(6);
+	struct {
+		const homv_matrix *matrices;
+		size_t count;
+	} cases[] = {{chain, 2}, {&chain[1], 1}, {gauss, 1}};
+	for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+		// Kernels but the last run as 8-bit chain, only the last one writes floats
+		size_t last = cases[c].count - 1;
+		uint8_t *chained = last ? homv_apply_chain(HOMV_STRATEGY_SEQ, img, width, height, channels, cases[c].matrices,
+		                                           last)
+		                        : NULL;
+		homv_apply_typed_into(HOMV_STRATEGY_SEQ, HOMV_TYPE_U8, chained ? chained : img, width, height, channels,
+		                      &cases[c].matrices[last], 1, HOMV_TYPE_F32, floats, stride * sizeof(float));
+		free(chained);
+		float min = INFINITY, max = -INFINITY;
+		for (size_t i = 0; i < values; i++) {
+			min = fminf(min, floats[i]);
+			max = fmaxf(max, floats[i]);
+		}
+
+		homv_normalize = true;
+		homv_apply_typed_into(HOMV_STRATEGY_SEQ, HOMV_TYPE_U8, img, width, height, channels, cases[c].matrices,
+		                      cases[c].count, HOMV_TYPE_U8, expected, stride);
+		uint8_t low = 255, high = 0;
+		for (size_t i = 0; i < values; i++) {
+			low = expected[i] < low ? expected[i] : low;
+			high = expected[i] > high ? expected[i] : high;
+			assert_true(fabs(expected[i] - (floats[i] - min) * 255.0 / (max - min)) <= 0.5 + 1e-3);
+		}
+		assert_int_equal(low, 0);
+		assert_int_equal(high, 255);
+
+		for (homv_strategy strategy = HOMV_STRATEGY_ROWS; strategy < HOMV_STRATEGY_MAX; strategy++) {
+			homv_apply_typed_into(strategy, HOMV_TYPE_U8, img, width, height, channels, cases[c].matrices,
+			                      cases[c].count, HOMV_TYPE_U8, output, stride);
+			assert_memory_equal(output, expected, values);
+		}
+		homv_normalize = false;
+	}
+
+	// Normalization is only for 8-bit output, other types are rejected
+	homv_normalize = true;
+	assert_false(homv_apply_typed_into(HOMV_STRATEGY_ROWS, HOMV_TYPE_U8, img, width, height, channels, &chain[1], 1,
+	                                   HOMV_TYPE_F32, floats, stride * sizeof(float)));
+	assert_false(homv_apply_typed_into(HOMV_STRATEGY_ROWS, HOMV_TYPE_U8, img, width, height, channels, &chain[1], 1,
+	                                   HOMV_TYPE_I16, floats, stride * sizeof(int16_t)));
+	homv_normalize = false;
+
+	homv_mx_free(gauss);
+	free(output);
+	free(expected);
+	free(floats);
+	free(img);
+}
+
+static void test_unpadded_method(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	// Blocks narrower than kernel radius have only border columns
+	area_width = area_height = 5;
+
+	size_t sizes[] = {3, 15};
+	for (size_t size = 0; size < sizeof(sizes) / sizeof(sizes[0]); size++) {
+		homv_matrix *matrix = homv_mx_get_random_matrix(sizes[size]);
+		uint8_t *image_reflected = homv_reflect_image(img, width, height, channels, matrix->size);
+		uint8_t *first_output = homv_apply_seq(image_reflected, width, height, channels, *matrix);
+		uint8_t *fft_output = homv_apply_fft(image_reflected, width, height, channels, *matrix);
+
+		for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_MAX; strategy++) {
+			uint8_t *second_output = homv_apply(strategy, img, width, height, channels, *matrix);
+			uint8_t *expected = strategy == HOMV_STRATEGY_FFT ? fft_output : first_output;
+			for (ssize_t i = 0; i < width * height * channels; i++) {
+				assert_int_equal(expected[i], second_output[i]);
+			}
+			free(second_output);
+		}
+
+		homv_mx_free(matrix);
+		free(image_reflected);
+		free(first_output);
+		free(fft_output);
+	}
+
+	free(img);
+}
+
+static void test_apply_into(void **state) {
+	(void)state;
+
+	int width, height, channels;
+	uint8_t *img = stbi_load("./input/sticker.jpg", &width, &height, &channels, 0);
+	assert_non_null(img);
+	homv_matrix matrix = homv_matrices[HOMV_MATRIX_OUTLINE];
+	size_t row_size = (size_t)width * channels;
+	size_t output_stride = row_size + 7;
+	uint8_t *output = malloc(height * output_stride);
+
+	for (homv_strategy strategy = HOMV_STRATEGY_SEQ; strategy < HOMV_STRATEGY_MAX; strategy++) {
+		uint8_t *expected = homv_apply(strategy, img, width, height, channels, matrix);
+		memset(output, 0xAB, height * output_stride);
+		// Second call reuses plan and scratch buffers of the first one
+		for (size_t run = 0; run < 2; run++) {
+			homv_apply_into(strategy, img, width, height, channels, matrix, output, output_stride);
+		}
+
+		for (ssize_t y = 0; y < height; y++) {
+			assert_memory_equal(output + y * output_stride, expected + y * row_size, row_size);
+			for (size_t i = row_size; i < output_stride; i++) {
+				assert_int_equal(output[y * output_stride + i], 0xAB);
+			}
+		}
+		free(expected);
+	}
+
+	free(output);
+	free(img);
+}
+
+static void test_row_specializations(void **state) {
+	(void)state;
+
+	// Specialized (3 and 9 taps with 1, 3, 4 channels) and generic row functions give the same sums as tap by tap
+	size_t count = 1000;
+	size_t taps_list[] = {3, 9, 11};
+	size_t strides[] = {1, 3, 4, 2};
+	uint8_t *src = malloc(count + 11 * 4);
+	for (size_t i = 0; i < count + 11 * 4; i++) {
+		src[i] = (uint8_t)rand();
+	}
+	float *first = malloc(count * sizeof(float));
+	float *second = malloc(count * sizeof(float));
+	int16_t *first_i16 = malloc(count * sizeof(int16_t));
+	int16_t *second_i16 = malloc(count * sizeof(int16_t));
+
+	for (homv_isa isa = HOMV_ISA_SCALAR; isa < HOMV_ISA_MAX; isa++) {
+		if (!homv_simd_select(isa)) {
+			continue;
+		}
+		for (size_t t = 0; t < sizeof(taps_list) / sizeof(taps_list[0]); t++) {
+			for (size_t s = 0; s < sizeof(strides) / sizeof(strides[0]); s++) {
+				size_t taps = taps_list[t], stride = strides[s];
+				float weights[11];
+				int16_t weights_i16[11];
+				for (size_t tap = 0; tap < taps; tap++) {
+					weights[tap] = (float)rand() / RAND_MAX - 0.5f;
+					weights_i16[tap] = (int16_t)(rand() % 7 - 3);
+				}
+
+				memset(first, 0, count * sizeof(float));
+				memset(second, 0, count * sizeof(float));
+				memset(first_i16, 0, count * sizeof(int16_t));
+				memset(second_i16, 0, count * sizeof(int16_t));
+				for (size_t tap = 0; tap < taps; tap++) {
+					homv_simd->madd_u8(first, src + tap * stride, weights[tap], count);
+					homv_simd->madd_i16(first_i16, src + tap * stride, weights_i16[tap], count);
+				}
+				homv_simd->madd_row_u8(second, src, weights, taps, stride, count);
+				homv_simd->madd_row_i16(second_i16, src, weights_i16, taps, stride, count);
+
+				assert_memory_equal(first, second, count * sizeof(float));
+				assert_memory_equal(first_i16, second_i16, count * sizeof(int16_t));
+			}
+		}
+	}
+	homv_simd_select(HOMV_ISA_AUTO);
+
+	free(src);
+	free(first);
+	free(second);
+	free(first_i16);
+	free(second_i16);
+}
+
+static void test_block_rows(void **state) {
+	(void)state;
+
+	// Block of rows gives the same values as rows convolved one by one with row functions
+	size_t count = 1000, taps = 5, stride = 3;
+	const uint8_t *src[HOMV_SIMD_BLOCK_ROWS + 4];
+	uint8_t *lines = malloc((HOMV_SIMD_BLOCK_ROWS + 4) * (count + 4 * stride));
+	for (size_t line = 0; line < HOMV_SIMD_BLOCK_ROWS + 4; line++) {
+		for (size_t i = 0; i < count + 4 * stride; i++) {
+			lines[line * (count + 4 * stride) + i] = (uint8_t)rand();
+		}
+		src[line] = lines + line * (count + 4 * stride);
+	}
+	float weights[25];
+	int16_t weights_i16[25];
+	for (size_t i = 0; i < taps * taps; i++) {
+		weights[i] = (float)rand() / RAND_MAX - 0.4f;
+		weights_i16[i] = (int16_t)(rand() % 5 - 2);
+	}
+	uint8_t *block = malloc(HOMV_SIMD_BLOCK_ROWS * count);
+	uint8_t *block_i16 = malloc(HOMV_SIMD_BLOCK_ROWS * count);
+	uint8_t *single = malloc(count);
+	float *acc = malloc(count * sizeof(float));
+	int16_t *acc_i16 = malloc(count * sizeof(int16_t));
+
+	for (homv_isa isa = HOMV_ISA_SCALAR; isa < HOMV_ISA_MAX; isa++) {
+		if (!homv_simd_select(isa)) {
+			continue;
+		}
+		uint8_t *dst[HOMV_SIMD_BLOCK_ROWS], *dst_i16[HOMV_SIMD_BLOCK_ROWS];
+		for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+			dst[row] = block + row * count;
+			dst_i16[row] = block_i16 + row * count;
+		}
+		homv_simd->convolve_u8(dst, src, weights, taps, stride, HOMV_SIMD_BLOCK_ROWS, count);
+		homv_simd->convolve_i16(dst_i16, src, weights_i16, taps, stride, 9362, HOMV_SIMD_BLOCK_ROWS, count);
+
+		for (size_t row = 0; row < HOMV_SIMD_BLOCK_ROWS; row++) {
+			memset(acc, 0, count * sizeof(float));
+			memset(acc_i16, 0, count * sizeof(int16_t));
+			for (size_t ky = 0; ky < taps; ky++) {
+				homv_simd->madd_row_u8(acc, src[row + ky], weights + ky * taps, taps, stride, count);
+				homv_simd->madd_row_i16(acc_i16, src[row + ky], weights_i16 + ky * taps, taps, stride, count);
+			}
+			homv_simd->store_u8(single, acc, count);
+			assert_memory_equal(dst[row], single, count);
+			homv_simd->store_i16(single, acc_i16, 9362, count);
+			assert_memory_equal(dst_i16[row], single, count);
+
+			uint8_t *one_row[1] = {single};
+			homv_simd->convolve_u8(one_row, src + row, weights, taps, stride, 1, count);
+			assert_memory_equal(dst[row], single, count);
+		}
+	}
+	homv_simd_select(HOMV_ISA_AUTO);
+
+	free(lines);
+	free(block);
+	free(block_i16);
+	free(single);
+	free(acc);
+	free(acc_i16);
+}
+
 int main(void) {
 	const struct CMUnitTest tests[] = {
 			cmocka_unit_test(test_rows_method),
 			cmocka_unit_test(test_cols_method),
 			cmocka_unit_test(test_pixels_method),
 			cmocka_unit_test(test_area_method),
+			cmocka_unit_test(test_separable_plan),
+			cmocka_unit_test(test_separable_method),
+			cmocka_unit_test(test_low_rank_plan),
+			cmocka_unit_test(test_low_rank_method),
+			cmocka_unit_test(test_fft_method),
+			cmocka_unit_test(test_isa_variants),
+			cmocka_unit_test(test_integer_plan),
+			cmocka_unit_test(test_integer_method),
+			cmocka_unit_test(test_sparse_method),
+			cmocka_unit_test(test_symmetric_method),
+			cmocka_unit_test(test_kernel_fits),
+			cmocka_unit_test(test_box_method),
+			cmocka_unit_test(test_gauss_method),
+			cmocka_unit_test(test_winograd_method),
+			cmocka_unit_test(test_chain_method),
+			cmocka_unit_test(test_compose_plan),
+			cmocka_unit_test(test_compose_method),
+			cmocka_unit_test(test_fanout_method),
+			cmocka_unit_test(test_gradient_method),
+			cmocka_unit_test(test_alpha_method),
+			cmocka_unit_test(test_gray_method),
+			cmocka_unit_test(test_wide_method),
+			cmocka_unit_test(test_float_method),
+			cmocka_unit_test(test_signed_method),
+			cmocka_unit_test(test_normalize_method),
+			cmocka_unit_test(test_unpadded_method),
+			cmocka_unit_test(test_apply_into),
+			cmocka_unit_test(test_row_specializations),
+			cmocka_unit_test(test_block_rows),
 	};
 
 	return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,72 @@
+// clang-format off
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+// clang-format on
+
+#include "homv_pool.h"
+
+static void test_pool_reuse(void **state) {
+	(void)state;
+
+	homv_pool_stats before = homv_pool_get_stats();
+	uint8_t *first = homv_pool_alloc(1000);
+	assert_non_null(first);
+	homv_pool_free(first);
+
+	// 1000 and 1010 bytes are in the same size class
+	uint8_t *second = homv_pool_alloc(1010);
+	assert_ptr_equal(first, second);
+	homv_pool_stats after = homv_pool_get_stats();
+	assert_int_equal(after.misses - before.misses, 1);
+	assert_int_equal(after.hits - before.hits, 1);
+	assert_true(after.peak_bytes >= 1010);
+
+	homv_pool_free(second);
+	homv_pool_clear();
+	assert_int_equal(homv_pool_get_stats().retained_bytes, 0);
+}
+
+static void test_pool_limit(void **state) {
+	(void)state;
+
+	size_t limit = homv_pool_limit;
+	homv_pool_limit = 0;
+	homv_pool_free(homv_pool_alloc(4096));
+	assert_int_equal(homv_pool_get_stats().retained_bytes, 0);
+
+	homv_pool_stats before = homv_pool_get_stats();
+	homv_pool_free(homv_pool_alloc(4096));
+	assert_int_equal(homv_pool_get_stats().misses - before.misses, 1);
+	homv_pool_limit = limit;
+}
+
+static void test_pool_realloc(void **state) {
+	(void)state;
+
+	uint8_t *buffer = homv_pool_realloc(NULL, 64);
+	for (size_t i = 0; i < 64; i++) {
+		buffer[i] = (uint8_t)i;
+	}
+	buffer = homv_pool_realloc(buffer, 100000);
+	for (size_t i = 0; i < 64; i++) {
+		assert_int_equal(buffer[i], i);
+	}
+
+	homv_pool_free(buffer);
+	homv_pool_free(NULL);
+	homv_pool_clear();
+}
+
+int main(void) {
+	const struct CMUnitTest tests[] = {
+			cmocka_unit_test(test_pool_reuse),
+			cmocka_unit_test(test_pool_limit),
+			cmocka_unit_test(test_pool_realloc),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}